@@ -18,6 +18,7 @@
 #include "wordUtils.h"
 
 #define N_WORKERS 2 // default number of workers
+#define USAGE "Usage: %s [-n n_workers] [--sample rate] [--seed seed] [--stream] [--ndjson] [--rules rules_file] file1.txt file2.txt ...\n"
 #define CLOCK_MONOTONIC 1 // for clock_gettime
 
 /**
@@ -53,10 +54,6 @@ void *worker(void *id) {
     uint8_t workerId = *((uint8_t *)id);
 
     struct ChunkData chunkData;
-    int ptr;
-    char *currentChar = (char *) malloc(MAX_CHAR_LENGTH * sizeof(char));
-    int consOcc[26];
-    bool detMultCons;
 
     while (true) {
         chunkData.nWords = 0;
@@ -70,20 +67,12 @@ void *worker(void *id) {
             break;
         }
 
-        ptr = 0;
-        detMultCons = false;
-        memset(consOcc, 0, 26 * sizeof(int));
-
-        char* word = (char *) malloc(MAX_CHAR_LENGTH * sizeof(char));
-
-        while (extractCharFromChunk(chunkData.chunk, currentChar, &ptr) != -1) {
-            processChar(word, currentChar, &chunkData.inWord, &chunkData.nWords, &chunkData.nWordsWMultCons, consOcc, &detMultCons);
-        }
+        processChunk(chunkData.chunk, chunkData.chunkSize, &chunkData.inWord, &chunkData.nWords, &chunkData.nWordsWMultCons);
 
         // update shared data
         saveResults(&chunkData);
 
-        memset(chunkData.chunk, 0, MAX_CHUNK_SIZE);
+        free(chunkData.chunk);
     }
 
     return (void*) EXIT_SUCCESS;
@@ -109,49 +98,103 @@ int main(int argc, char *argv[]) {
     int nThreads = N_WORKERS;
     int nFiles;
     char **fileNames;
+    double sampleRate = 0;
+    uint64_t seed = (uint64_t) time(NULL);
+    bool streaming = false;
+    int outputFormat = OUTPUT_TEXT;
+    char *rulesPath = NULL;
+
+    static struct option longOptions[] = {
+        {"sample", required_argument, NULL, 's'},
+        {"seed", required_argument, NULL, 'S'},
+        {"stream", no_argument, NULL, 'r'},
+        {"ndjson", no_argument, NULL, 'j'},
+        {"rules", required_argument, NULL, 'R'},
+        {NULL, 0, NULL, 0}
+    };
+
+    // informative messages go to stderr in NDJSON mode, so that stdout only contains the results
+    FILE *info = stdout;
 
     // process command line options
     int opt;
     do {
-        opt = getopt(argc, argv, "n:");
+        opt = getopt_long(argc, argv, "n:", longOptions, NULL);
         switch (opt) {
             case 'n':
                 nThreads = atoi(optarg);
                 if (nThreads < 1) {
                     fprintf(stderr, "[MAIN] Invalid number of worker threads\n");
-                    fprintf(stderr, "Usage: %s [-n n_workers] file1.txt file2.txt ...\n", cmd_name);
+                    fprintf(stderr, USAGE, cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                sampleRate = atof(optarg);
+                if (sampleRate <= 0 || sampleRate > 1) {
+                    fprintf(stderr, "[MAIN] Invalid sampling rate (must be in ]0, 1])\n");
+                    fprintf(stderr, USAGE, cmd_name);
                     return EXIT_FAILURE;
                 }
                 break;
+            case 'S':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                streaming = true;
+                break;
+            case 'j':
+                streaming = true;
+                outputFormat = OUTPUT_NDJSON;
+                break;
+            case 'R':
+                rulesPath = optarg;
+                break;
             case -1:
+                if (outputFormat == OUTPUT_NDJSON) {
+                    info = stderr;
+                }
                 if (optind < argc) {
                     // process remaining arguments
                     nFiles = argc - optind;
-                    printf("Number of files: %d\n", nFiles);
+                    fprintf(info, "Number of files: %d\n", nFiles);
                     fileNames = (char **)malloc((nFiles + 1) * sizeof(char *));
                     for (int i = optind; i < argc; i++) {
                         fileNames[i - optind] = argv[i];
                     }
                 }
                 else {
-                    fprintf(stderr, "Usage: %s [-n n_workers] file1.txt file2.txt ...\n", cmd_name);
+                    fprintf(stderr, USAGE, cmd_name);
                     exit(EXIT_FAILURE);
                 }
                 break;
             default:
-                fprintf(stderr, "Usage: %s [-n n_workers] file1.txt file2.txt ...\n", cmd_name);
+                fprintf(stderr, USAGE, cmd_name);
                 exit(EXIT_FAILURE);
         }
     } while (opt != -1);
 
-    printf("Number of workers: %d\n\n", nThreads);
+    fprintf(info, "Number of workers: %d\n", nThreads);
+    if (sampleRate > 0) {
+        fprintf(info, "Sampling rate: %g (seed %llu)\n", sampleRate, (unsigned long long) seed);
+    }
+    fprintf(info, "\n");
 
-    initializeCharMeaning();
+    if (loadTokenRules(rulesPath) != 0) {
+        fprintf(stderr, "[MAIN] Invalid tokenizer rules\n");
+        return EXIT_FAILURE;
+    }
     pthread_t threads[nThreads];
 
     get_delta_time();
 
     initSharedData(nFiles, fileNames);
+    if (sampleRate > 0) {
+        initSampling(sampleRate, seed);
+    }
+    if (streaming) {
+        initStreaming(outputFormat);
+    }
 
     // create nThreads threads
     for (int i = 0; i < nThreads; i++) {
@@ -165,6 +208,6 @@ int main(int argc, char *argv[]) {
 
     printResults(nFiles);
 
-    printf("Elapsed time: %f\n", get_delta_time());
+    fprintf(info, "Elapsed time: %f\n", get_delta_time());
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,63 @@
+# Usage: ./sampling.sh
+# Description: Compiles the source code, runs the word counting program in exact mode and in sampling mode for several
+#              sampling rates and seeds, and outputs, for each file, the mean estimate, the mean absolute relative error
+#              and the fraction of runs whose 95% confidence interval contains the exact total in a "sampleResults.txt"
+#              file.
+# Example: ./sampling.sh
+
+OUTPUT_FILE="sampleResults.txt"
+FILES="data/text0.txt data/text1.txt data/text2.txt data/text3.txt data/text4.txt"
+SAMPLE_RATES="0.25 0.5 0.75"
+SEEDS=$(seq 1 50)
+N_THREADS=2
+
+# Create the output file
+rm -f $OUTPUT_FILE
+touch $OUTPUT_FILE
+
+# Compile the source code
+gcc -Wall -O3 -o bmprog1 multiEqualConsonants.c wordUtils.c shared.c tokenRules.c -lm
+
+# Exact totals ("file words multCons" per line)
+./bmprog1 -n $N_THREADS $FILES | awk '
+  /^File name:/ { file = $3 }
+  /^Total number of words:/ { words = $5 }
+  /^Total number of words with/ { print file, words, $NF }' > exact.tmp
+
+for rate in $SAMPLE_RATES; do
+  echo "Running program with sampling rate $rate..."
+  for seed in $SEEDS; do
+    # sampled estimates ("file words wordsHalfWidth multCons multConsHalfWidth" per line, -1 if the CI is undefined)
+    ./bmprog1 -n $N_THREADS --sample $rate --seed $seed $FILES | awk '
+      /^File name:/ { file = $3 }
+      /^Estimated number of words:/ { words = $5; wordsHw = ($6 == "+/-") ? $7 : -1 }
+      /^Estimated number of words with/ {
+        for (i = 1; i <= NF; i++) if ($i == "consonant:") { multCons = $(i + 1); multConsHw = ($(i + 2) == "+/-") ? $(i + 3) : -1 }
+        print file, words, wordsHw, multCons, multConsHw }'
+  done > sampled.tmp
+
+  echo "Sampling rate: $rate; Runs: $(echo $SEEDS | wc -w)" >> $OUTPUT_FILE
+  awk '
+    NR == FNR { exactWords[$1] = $2; exactMultCons[$1] = $3; order[++nFiles] = $1; next }
+    {
+      n[$1]++; sumWords[$1] += $2; sumMultCons[$1] += $4
+      errWords[$1] += ($2 > exactWords[$1] ? $2 - exactWords[$1] : exactWords[$1] - $2) / exactWords[$1]
+      errMultCons[$1] += ($4 > exactMultCons[$1] ? $4 - exactMultCons[$1] : exactMultCons[$1] - $4) / exactMultCons[$1]
+      if ($3 >= 0) { withCi[$1]++; if ($2 - $3 <= exactWords[$1] && exactWords[$1] <= $2 + $3) covWords[$1]++ }
+      if ($5 >= 0) { if ($4 - $5 <= exactMultCons[$1] && exactMultCons[$1] <= $4 + $5) covMultCons[$1]++ }
+    }
+    END {
+      printf "%-16s %-28s %-30s %-10s\n", "File", "Words (exact/mean/error)", "MultCons (exact/mean/error)", "CI coverage (words/multCons)"
+      for (i = 1; i <= nFiles; i++) {
+        f = order[i]
+        cov = withCi[f] > 0 ? sprintf("%.2f/%.2f (%d runs)", covWords[f] / withCi[f], covMultCons[f] / withCi[f], withCi[f]) : "n/a"
+        printf "%-16s %6d/%8.1f/%5.1f%%       %6d/%8.1f/%5.1f%%         %s\n", f,
+          exactWords[f], sumWords[f] / n[f], 100 * errWords[f] / n[f],
+          exactMultCons[f], sumMultCons[f] / n[f], 100 * errMultCons[f] / n[f], cov
+      }
+    }' exact.tmp sampled.tmp >> $OUTPUT_FILE
+  echo "" >> $OUTPUT_FILE
+done
+
+# Clean-up
+rm -f bmprog1 exact.tmp sampled.tmp
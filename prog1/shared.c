@@ -9,9 +9,15 @@
  *  \author João Fonseca - March 2024
  *  \author Rafael Gonçalves - March 2024
  */
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "shared.h"
 #include "wordUtils.h"
 
+#define ALIGN_WINDOW_SIZE 64 // number of bytes read at a time when searching for a word boundary
+
 /** \brief Structure that represents the final results of each file */
 struct SharedFileData *sharedFileData;
 
@@ -30,23 +36,229 @@ void initSharedData(int _nFiles, char **fileNames) {
         sharedFileData[i].nWords = 0;
         sharedFileData[i].nWordsWMultCons = 0;
         sharedFileData[i].fp = NULL;
+        sharedFileData[i].fd = -1;
+        sharedFileData[i].fileSize = 0;
+        sharedFileData[i].nChunks = 0;
+        sharedFileData[i].nSampledChunks = 0;
+        sharedFileData[i].pendingChunks = 0;
+        sharedFileData[i].sampledBytes = 0;
+        sharedFileData[i].sumSqBytes = 0;
+        sharedFileData[i].sumSqWords = 0;
+        sharedFileData[i].sumSqWordsWMultCons = 0;
+        sharedFileData[i].sumBytesWords = 0;
+        sharedFileData[i].sumBytesWordsWMultCons = 0;
     }
 
     monitor = (struct Monitor){
         0, // currentFile
+        0, // currentChunk
         _nFiles, // nFiles
+        0, // sampleRate
+        0, // rngState
+        false, // streaming
+        OUTPUT_TEXT, // outputFormat
         sharedFileData, // filesResults
         PTHREAD_MUTEX_INITIALIZER, // mutex
         PTHREAD_COND_INITIALIZER // cond
     };
 }
 
+/** \brief Enables the sampling mode, where only a random subset of the chunks of each file is processed.
+ *
+ *  Must be called after initSharedData and before the worker threads are created.
+ *
+ *  \param rate fraction of chunks to be processed (0 < rate <= 1)
+ *  \param seed seed of the random generator that selects the chunks
+ */
+void initSampling(double rate, uint64_t seed) {
+    monitor.sampleRate = rate;
+    monitor.rngState = seed;
+}
+
+/** \brief Enables the streaming mode, where the results of each file are printed as soon as its last chunk is saved.
+ *
+ *  Must be called after initSharedData and before the worker threads are created.
+ *
+ *  \param format format of the results (OUTPUT_TEXT or OUTPUT_NDJSON)
+ */
+void initStreaming(int format) {
+    monitor.streaming = true;
+    monitor.outputFormat = format;
+}
+
+static void printFileResults(const struct SharedFileData *file);
+
+/** \brief Generates a uniform random number in [0, 1) (splitmix64), to be called with the monitor locked.
+ *
+ *  \return random number
+ */
+static double nextRandom(void) {
+    uint64_t z = (monitor.rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (double) (z >> 11) * 0x1.0p-53;
+}
+
+/** \brief Finds the first word boundary at or after a given offset of a file.
+ *
+ *  The boundary is the first character not allowed in a word, which is the same criterion used by retrieveData to
+ *  extend a chunk until a word is complete. Continuation bytes of a multi-byte character are skipped.
+ *
+ *  \param fd file descriptor
+ *  \param offset offset where the search starts
+ *  \param fileSize size of the file
+ *  \return offset of the boundary (fileSize if there is none)
+ */
+static off_t findWordBoundary(int fd, off_t offset, off_t fileSize) {
+    if (offset == 0) {
+        return 0;
+    }
+
+    char window[ALIGN_WINDOW_SIZE + MAX_CHAR_LENGTH];
+    char UTF8Char[MAX_CHAR_LENGTH];
+
+    while (offset < fileSize) {
+        ssize_t nRead = pread(fd, window, ALIGN_WINDOW_SIZE + MAX_CHAR_LENGTH - 1, offset);
+        if (nRead <= 0) {
+            perror("Error reading file");
+            pthread_exit(NULL);
+        }
+        int pos = 0;
+
+        // skip continuation bytes of a character that started before the offset
+        while (pos < nRead && lengthCharUtf8(window[pos]) == 0) {
+            pos++;
+        }
+
+        while (pos < ALIGN_WINDOW_SIZE && pos < nRead) {
+            int charSize = lengthCharUtf8(window[pos]);
+            if (charSize == 0 || pos + charSize > nRead) {
+                break;
+            }
+            memcpy(UTF8Char, window + pos, charSize);
+            UTF8Char[charSize] = '\0';
+            if (isCharNotAllowedInWordUtf8(UTF8Char)) {
+                return offset + pos;
+            }
+            pos += charSize;
+        }
+        offset += pos > 0 ? pos : 1;
+    }
+    return fileSize;
+}
+
+/** \brief Retrieves a randomly sampled chunk of data, guaranteeing mutual exclusion while selecting it.
+ *
+ *  Each file is split into MAX_CHUNK_SIZE chunks, whose limits are moved to the next word boundary. Every chunk is
+ *  selected with probability sampleRate (at least one chunk is selected per non-empty file) and only the selected byte
+ *  ranges are read, outside of the critical section.
+ *
+ *  \param chunkData pointer to the chunk data structure
+ */
+static void retrieveSampledData(struct ChunkData *chunkData) {
+    int fileIndex = -1;
+    long chunkIndex = 0;
+    bool completed = false; // a file without chunks was completed
+    struct SharedFileData completedFile;
+
+    if (pthread_mutex_lock(&monitor.mutex) != 0) {
+        perror("Error: could not lock mutex");
+        pthread_exit(NULL);
+    }
+
+    while (monitor.currentFile < monitor.nFiles && fileIndex == -1 && !completed) {
+        struct SharedFileData *file = &sharedFileData[monitor.currentFile];
+
+        // open file
+        if (file->fd == -1) {
+            struct stat st;
+            if ((file->fd = open(file->fileName, O_RDONLY)) == -1 || fstat(file->fd, &st) == -1) {
+                perror("Error opening file");
+                pthread_exit(NULL);
+            }
+            file->fileSize = st.st_size;
+            file->nChunks = (st.st_size + MAX_CHUNK_SIZE - 1) / MAX_CHUNK_SIZE;
+        }
+
+        // select the next sampled chunk of the current file
+        while (monitor.currentChunk < file->nChunks) {
+            long candidate = monitor.currentChunk++;
+            bool isLast = monitor.currentChunk == file->nChunks;
+            if (nextRandom() < monitor.sampleRate || (isLast && file->nSampledChunks == 0)) {
+                fileIndex = monitor.currentFile;
+                chunkIndex = candidate;
+                file->nSampledChunks++;
+                file->pendingChunks++;
+                break;
+            }
+        }
+
+        // every chunk of the current file was considered
+        if (monitor.currentChunk == file->nChunks) {
+            if (file->pendingChunks == 0) {
+                close(file->fd);
+                completed = monitor.streaming;
+                completedFile = *file;
+            }
+            monitor.currentFile++;
+            monitor.currentChunk = 0;
+        }
+    }
+
+    if (pthread_mutex_unlock(&monitor.mutex) != 0) {
+        perror("Error: could not unlock mutex");
+        pthread_exit(NULL);
+    }
+
+    if (completed) {
+        printFileResults(&completedFile);
+        if (fileIndex == -1) {
+            retrieveSampledData(chunkData);
+            return;
+        }
+    }
+
+    if (fileIndex == -1) {
+        return;
+    }
+
+    // read the byte range of the chunk, aligned to word boundaries
+    struct SharedFileData *file = &sharedFileData[fileIndex];
+    off_t start = findWordBoundary(file->fd, chunkIndex * MAX_CHUNK_SIZE, file->fileSize);
+    off_t end = findWordBoundary(file->fd, (chunkIndex + 1) * (off_t) MAX_CHUNK_SIZE, file->fileSize);
+    if (end < start) {
+        end = start;
+    }
+
+    off_t allocSize = end - start > MAX_CHUNK_SIZE ? end - start : MAX_CHUNK_SIZE;
+    chunkData->chunk = (char *)malloc((allocSize + 1) * sizeof(char)); // +1 for null terminator
+    chunkData->chunkSize = 0;
+    while (chunkData->chunkSize < end - start) {
+        ssize_t nRead = pread(file->fd, chunkData->chunk + chunkData->chunkSize, end - start - chunkData->chunkSize,
+                              start + chunkData->chunkSize);
+        if (nRead <= 0) {
+            perror("Error reading file");
+            pthread_exit(NULL);
+        }
+        chunkData->chunkSize += nRead;
+    }
+    chunkData->chunk[chunkData->chunkSize] = '\0';
+    chunkData->fileIndex = fileIndex;
+    chunkData->finished = false;
+}
+
 /** \brief Retrieves a chunk of data from the current file, guaranteeing mutual exclusion.
  *
  *  \param workerId worker id
  *  \param chunkData pointer to the chunk data structure
  */
 void retrieveData(uint8_t workerId, struct ChunkData *chunkData) {
+    if (monitor.sampleRate > 0) {
+        retrieveSampledData(chunkData);
+        return;
+    }
+
     if (pthread_mutex_lock(&monitor.mutex) != 0) {
         perror("Error: could not lock mutex");
         pthread_exit(NULL);
@@ -69,6 +281,7 @@ void retrieveData(uint8_t workerId, struct ChunkData *chunkData) {
         chunkData->chunkSize = fread(chunkData->chunk, 1, MAX_CHUNK_SIZE, sharedFileData[fileIndex].fp);
         chunkData->fileIndex = fileIndex;
         chunkData->finished = false;
+        sharedFileData[fileIndex].pendingChunks++;
 
         // if chunk size is less than MAX_CHUNK_SIZE, then it is the last chunk
         if (chunkData->chunkSize < MAX_CHUNK_SIZE) {
@@ -116,28 +329,179 @@ void retrieveData(uint8_t workerId, struct ChunkData *chunkData) {
  *  \param chunkData pointer to the chunk data structure
  */
 void saveResults(struct ChunkData *chunkData) {
+    struct SharedFileData *file = &sharedFileData[chunkData->fileIndex];
+    struct SharedFileData completedFile;
+    bool completed = false;
+
     if (pthread_mutex_lock(&monitor.mutex) != 0) {
         perror("Error: could not lock mutex");
         pthread_exit(NULL);
     }
 
-    sharedFileData[chunkData->fileIndex].nWords += chunkData->nWords;
-    sharedFileData[chunkData->fileIndex].nWordsWMultCons += chunkData->nWordsWMultCons;
+    file->nWords += chunkData->nWords;
+    file->nWordsWMultCons += chunkData->nWordsWMultCons;
+
+    if (monitor.sampleRate > 0) {
+        double bytes = chunkData->chunkSize;
+        file->sampledBytes += bytes;
+        file->sumSqBytes += bytes * bytes;
+        file->sumSqWords += (double) chunkData->nWords * chunkData->nWords;
+        file->sumSqWordsWMultCons += (double) chunkData->nWordsWMultCons * chunkData->nWordsWMultCons;
+        file->sumBytesWords += bytes * chunkData->nWords;
+        file->sumBytesWordsWMultCons += bytes * chunkData->nWordsWMultCons;
+    }
+
+    // the file is complete once all its chunks were retrieved and their results saved
+    file->pendingChunks--;
+    if (chunkData->fileIndex < monitor.currentFile && file->pendingChunks == 0) {
+        if (monitor.sampleRate > 0) {
+            close(file->fd);
+        }
+        completed = monitor.streaming;
+        completedFile = *file;
+    }
 
     if (pthread_mutex_unlock(&monitor.mutex) != 0) {
         perror("Error: could not unlock mutex");
         pthread_exit(NULL);
     }
+
+    // print outside of the critical section, so that other workers are not held up
+    if (completed) {
+        printFileResults(&completedFile);
+    }
 }
 
-/** \brief Prints the final results of each file.
+/** \brief Returns the two-sided 95% quantile of the Student's t distribution.
+ *
+ *  \param df degrees of freedom
+ *  \return quantile
+ */
+static double studentT95(long df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df <= 30) {
+        return table[df - 1];
+    }
+    return df <= 120 ? 2.042 - (df - 30) * (2.042 - 1.980) / 90 : 1.960;
+}
+
+/** \brief Extrapolates the total of a per-chunk count from the sampled chunks of a file.
+ *
+ *  Conditional on the number of sampled chunks, the sample is a simple random sample of the chunks of the file. The
+ *  total is estimated with the ratio estimator fileSize * (sum / sampledBytes), which accounts for chunks of different
+ *  sizes (the last one and those extended to a word boundary), and the finite population correction is applied to its
+ *  standard error.
+ *
+ *  \param file pointer to the results of the file
+ *  \param sum sum of the count over the sampled chunks
+ *  \param sumSq sum of the squared count over the sampled chunks
+ *  \param sumBytesCount sum of the chunk size times the count over the sampled chunks
+ *  \param halfWidth where the half width of the 95% confidence interval will be stored (-1 if it cannot be estimated)
+ *  \return estimated total
+ */
+static double estimateTotal(const struct SharedFileData *file, double sum, double sumSq, double sumBytesCount,
+                            double *halfWidth) {
+    long n = file->nSampledChunks;
+    *halfWidth = n < file->nChunks ? -1 : 0;
+    if (n == 0 || file->sampledBytes == 0) {
+        return 0;
+    }
+    double ratio = sum / file->sampledBytes;
+    if (n > 1 && n < file->nChunks) {
+        // variance of the residuals count - ratio * bytes
+        double residuals = sumSq - 2 * ratio * sumBytesCount + ratio * ratio * file->sumSqBytes;
+        double variance = fmax(residuals, 0) / (n - 1);
+        double fpc = 1.0 - (double) n / file->nChunks;
+        *halfWidth = studentT95(n - 1) * file->nChunks * sqrt(variance * fpc / n);
+    }
+    return ratio * file->fileSize;
+}
+
+/** \brief Prints a string as a JSON string literal.
+ *
+ *  \param out output stream
+ *  \param str string to be printed
+ */
+static void printJsonString(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char *) str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/** \brief Prints the results of a file, in the output format of the monitor.
+ *
+ *  The whole record is printed while holding the lock of stdout, so that records printed concurrently by several
+ *  workers do not interleave, and stdout is flushed so that consumers receive it immediately.
+ *
+ *  \param file pointer to the results of the file
+ */
+static void printFileResults(const struct SharedFileData *file) {
+    bool ndjson = monitor.outputFormat == OUTPUT_NDJSON;
+    flockfile(stdout);
+
+    if (monitor.sampleRate > 0) {
+        double wordsHalfWidth, multConsHalfWidth;
+        double words = estimateTotal(file, file->nWords, file->sumSqWords, file->sumBytesWords, &wordsHalfWidth);
+        double multCons = estimateTotal(file, file->nWordsWMultCons, file->sumSqWordsWMultCons,
+                                        file->sumBytesWordsWMultCons, &multConsHalfWidth);
+        if (ndjson) {
+            printf("{\"file\":");
+            printJsonString(stdout, file->fileName);
+            printf(",\"sampledChunks\":%ld,\"chunks\":%ld,\"words\":%.0f,\"wordsWithMultCons\":%.0f",
+                   file->nSampledChunks, file->nChunks, words, multCons);
+            if (wordsHalfWidth < 0) {
+                printf(",\"wordsCI95\":null,\"wordsWithMultConsCI95\":null}\n");
+            } else {
+                printf(",\"wordsCI95\":%.0f,\"wordsWithMultConsCI95\":%.0f}\n", wordsHalfWidth, multConsHalfWidth);
+            }
+        } else {
+            printf("File name: %s\n", file->fileName);
+            printf("Sampled chunks: %ld of %ld\n", file->nSampledChunks, file->nChunks);
+            if (wordsHalfWidth < 0) {
+                printf("Estimated number of words: %.0f (95%% CI undefined, single chunk sampled)\n", words);
+                printf("Estimated number of words with at least two instances of the same consonant: %.0f "
+                       "(95%% CI undefined, single chunk sampled)\n\n", multCons);
+            } else {
+                printf("Estimated number of words: %.0f +/- %.0f (95%% CI)\n", words, wordsHalfWidth);
+                printf("Estimated number of words with at least two instances of the same consonant: %.0f +/- %.0f "
+                       "(95%% CI)\n\n", multCons, multConsHalfWidth);
+            }
+        }
+    } else if (ndjson) {
+        printf("{\"file\":");
+        printJsonString(stdout, file->fileName);
+        printf(",\"words\":%d,\"wordsWithMultCons\":%d}\n", file->nWords, file->nWordsWMultCons);
+    } else {
+        printf("File name: %s\n", file->fileName);
+        printf("Total number of words: %d\n", file->nWords);
+        printf("Total number of words with at least two instances of the same consonant: %d\n\n", file->nWordsWMultCons);
+    }
+
+    fflush(stdout);
+    funlockfile(stdout);
+}
+
+/** \brief Prints the final results of each file (nothing in streaming mode, they were already printed).
+ *
+ *  In sampling mode, the totals are extrapolated from the sampled chunks and printed with their 95% confidence interval.
  *
  *  \param _nFiles number of files
  */
 void printResults(int _nFiles) {
+    if (monitor.streaming) {
+        return;
+    }
     for (int i = 0; i < _nFiles; i++) {
-        printf("File name: %s\n", sharedFileData[i].fileName);
-        printf("Total number of words: %d\n", sharedFileData[i].nWords);
-        printf("Total number of words with at least two instances of the same consonant: %d\n\n", sharedFileData[i].nWordsWMultCons);
+        printFileResults(&sharedFileData[i]);
     }
-}
\ No newline at end of file
+}
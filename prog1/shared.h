@@ -13,8 +13,11 @@
 #include <stdbool.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 #define MAX_CHUNK_SIZE 4096
+#define OUTPUT_TEXT 0 // human readable results
+#define OUTPUT_NDJSON 1 // one JSON object per line and per file
 
 /** \brief Structure that represents the final results of each file */
 struct SharedFileData {
@@ -22,6 +25,17 @@ struct SharedFileData {
     int nWords;
     int nWordsWMultCons;
     FILE *fp;
+    int fd; // file descriptor used in sampling mode
+    off_t fileSize; // size of the file in bytes (sampling mode)
+    long nChunks; // number of MAX_CHUNK_SIZE chunks in the file (sampling mode)
+    long nSampledChunks; // number of chunks that were sampled (sampling mode)
+    int pendingChunks; // number of chunks retrieved whose results were not saved yet
+    double sampledBytes; // sum of the sizes of the sampled chunks (sampling mode)
+    double sumSqBytes; // sum of the squared sizes of the sampled chunks (sampling mode)
+    double sumSqWords; // sum of the squared number of words per sampled chunk (sampling mode)
+    double sumSqWordsWMultCons; // sum of the squared number of words with equal consonants per sampled chunk (sampling mode)
+    double sumBytesWords; // sum of the size times the number of words per sampled chunk (sampling mode)
+    double sumBytesWordsWMultCons; // sum of the size times the number of words with equal consonants per sampled chunk (sampling mode)
 };
 
 /** \brief Structure that represents the monitor to control the access to the shared data */
@@ -38,7 +52,12 @@ struct ChunkData {
 /** \brief Structure that represents the monitor to control the access to the shared data */
 struct Monitor {
     int currentFile;
+    long currentChunk; // next chunk to be considered in the current file (sampling mode)
     int nFiles;
+    double sampleRate; // fraction of chunks to be processed (0 disables sampling)
+    uint64_t rngState; // state of the chunk sampling random generator
+    bool streaming; // print the results of each file as soon as it is complete
+    int outputFormat; // format of the results (OUTPUT_TEXT or OUTPUT_NDJSON)
     struct SharedFileData *filesResults;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
@@ -51,6 +70,23 @@ struct Monitor {
  */
 extern void initSharedData(int _nFiles, char **fileNames);
 
+/** \brief Enables the sampling mode, where only a random subset of the chunks of each file is processed.
+ *
+ *  Must be called after initSharedData and before the worker threads are created.
+ *
+ *  \param rate fraction of chunks to be processed (0 < rate <= 1)
+ *  \param seed seed of the random generator that selects the chunks
+ */
+extern void initSampling(double rate, uint64_t seed);
+
+/** \brief Enables the streaming mode, where the results of each file are printed as soon as its last chunk is saved.
+ *
+ *  Must be called after initSharedData and before the worker threads are created.
+ *
+ *  \param format format of the results (OUTPUT_TEXT or OUTPUT_NDJSON)
+ */
+extern void initStreaming(int format);
+
 /** \brief Retrieves a chunk of data from the current file, guaranteeing mutual exclusion.
  *
  *  \param workerId worker id
@@ -59,12 +95,16 @@ extern void initSharedData(int _nFiles, char **fileNames);
 extern void retrieveData(uint8_t workerId, struct ChunkData *chunkData);
 
 /** \brief Saves the partial results of a chunk in the shared data, guaranteeing mutual exclusion.
+ *
+ *  In streaming mode, the results of the file are printed outside of the critical section if this was its last chunk.
  *
  *  \param chunkData pointer to the chunk data structure
  */
 extern void saveResults(struct ChunkData *chunkData);
 
-/** \brief Prints the final results of each file.
+/** \brief Prints the final results of each file (nothing in streaming mode, they were already printed).
+ *
+ *  In sampling mode, the totals are extrapolated from the sampled chunks and printed with their 95% confidence interval.
  *
  *  \param _nFiles number of files
  */
@@ -0,0 +1,308 @@
+/**
+ *  \file tokenRules.c (implementation file)
+ *
+ *  \brief Assignment 1.1: count words with multiple equal consonants.
+ *
+ *  This file contains the implementation of the loading of the tokenizer rules and their compilation into the dense
+ *  lookup table used by the word counting loop.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "tokenRules.h"
+
+#define MAX_RULE_LINE 4096 // max number of bytes of a line of the rules file
+#define MAX_TOKEN_CHARS 64 // max number of characters of a token
+
+/** \brief Dense table with the class (CLASS_* flags and consonant slot) of each code point */
+uint8_t charClass[MAX_RULES_CODEPOINT + 1];
+
+/** \brief Number of consonants defined by the rules */
+int nConsonants;
+
+/** \brief Character of a token, after resolving escapes */
+struct TokenChar {
+    uint32_t codepoint;
+    bool escaped; // escaped characters are never operators ('-' of a range, '>' of a fold pair)
+};
+
+/** \brief Rules being compiled */
+struct Rules {
+    uint8_t baseClass[MAX_RULES_CODEPOINT + 1]; // class of each code point, before folding
+    uint32_t foldTo[MAX_RULES_CODEPOINT + 1]; // code point each code point behaves as (itself if not folded)
+    int nConsonants;
+    int lineNumber;
+};
+
+/**
+ * \brief Decodes one UTF-8 character of a string.
+ *
+ * \param str String positioned at the character to be decoded.
+ * \param codepoint Where the code point will be stored.
+ *
+ * \return Number of bytes of the character, 0 if it is not valid UTF-8.
+ */
+static int decodeUtf8(const unsigned char *str, uint32_t *codepoint) {
+    if (str[0] < 0x80) {
+        *codepoint = str[0];
+        return 1;
+    }
+    int length = (str[0] & 0xE0) == 0xC0 ? 2 : (str[0] & 0xF0) == 0xE0 ? 3 : (str[0] & 0xF8) == 0xF0 ? 4 : 0;
+    if (length == 0) {
+        return 0;
+    }
+    *codepoint = str[0] & (0x7F >> length);
+    for (int i = 1; i < length; i++) {
+        if ((str[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+        *codepoint = (*codepoint << 6) | (str[i] & 0x3F);
+    }
+    return length;
+}
+
+/**
+ * \brief Splits a token into characters, resolving escapes.
+ *
+ * \param rules Rules being compiled (for error messages).
+ * \param token Token (null-terminated).
+ * \param chars Where the characters will be stored.
+ *
+ * \return Number of characters, -1 if the token is invalid.
+ */
+static int splitToken(struct Rules *rules, const char *token, struct TokenChar *chars) {
+    const unsigned char *ptr = (const unsigned char *) token;
+    int n = 0;
+
+    while (*ptr != '\0') {
+        if (n == MAX_TOKEN_CHARS) {
+            fprintf(stderr, "[RULES] Line %d: token too long\n", rules->lineNumber);
+            return -1;
+        }
+        if (*ptr == '\\') {
+            ptr++;
+            switch (*ptr) {
+                case 's': chars[n].codepoint = ' '; break;
+                case 't': chars[n].codepoint = '\t'; break;
+                case 'n': chars[n].codepoint = '\n'; break;
+                case 'r': chars[n].codepoint = '\r'; break;
+                case '\\': case '#': case '-': case '>':
+                    chars[n].codepoint = *ptr;
+                    break;
+                case 'u': {
+                    char hex[5] = {0};
+                    char *hexEnd;
+                    strncpy(hex, (const char *) ptr + 1, 4);
+                    chars[n].codepoint = strtoul(hex, &hexEnd, 16);
+                    if (strlen(hex) != 4 || *hexEnd != '\0') {
+                        fprintf(stderr, "[RULES] Line %d: invalid escape \\u%s\n", rules->lineNumber, hex);
+                        return -1;
+                    }
+                    ptr += 4;
+                    break;
+                }
+                default:
+                    fprintf(stderr, "[RULES] Line %d: invalid escape in token %s\n", rules->lineNumber, token);
+                    return -1;
+            }
+            chars[n].escaped = true;
+            ptr++;
+        } else {
+            int length = decodeUtf8(ptr, &chars[n].codepoint);
+            if (length == 0) {
+                fprintf(stderr, "[RULES] Line %d: invalid UTF-8 in token %s\n", rules->lineNumber, token);
+                return -1;
+            }
+            chars[n].escaped = false;
+            ptr += length;
+        }
+        if (chars[n].codepoint > MAX_RULES_CODEPOINT) {
+            fprintf(stderr, "[RULES] Line %d: code point U+%X is above U+%X\n", rules->lineNumber,
+                    chars[n].codepoint, MAX_RULES_CODEPOINT);
+            return -1;
+        }
+        n++;
+    }
+    return n;
+}
+
+/**
+ * \brief Parses a character or a range of characters (X-Y).
+ *
+ * \param rules Rules being compiled (for error messages).
+ * \param chars Characters of the (part of the) token.
+ * \param n Number of characters.
+ * \param first Where the first code point of the range will be stored.
+ * \param last Where the last code point of the range will be stored.
+ *
+ * \return 0 on success, -1 if it is not a character nor a range.
+ */
+static int parseRange(struct Rules *rules, const struct TokenChar *chars, int n, uint32_t *first, uint32_t *last) {
+    if (n == 1) {
+        *first = *last = chars[0].codepoint;
+        return 0;
+    }
+    if (n == 3 && chars[1].codepoint == '-' && !chars[1].escaped && chars[0].codepoint <= chars[2].codepoint) {
+        *first = chars[0].codepoint;
+        *last = chars[2].codepoint;
+        return 0;
+    }
+    fprintf(stderr, "[RULES] Line %d: expected a character or a range X-Y\n", rules->lineNumber);
+    return -1;
+}
+
+/**
+ * \brief Applies one token of a rule.
+ *
+ * \param rules Rules being compiled.
+ * \param key Key of the rule.
+ * \param token Token (null-terminated).
+ *
+ * \return 0 on success, -1 if the token is invalid.
+ */
+static int applyToken(struct Rules *rules, const char *key, const char *token) {
+    struct TokenChar chars[MAX_TOKEN_CHARS];
+    uint32_t first, last;
+    int n = splitToken(rules, token, chars);
+    if (n <= 0) {
+        return -1;
+    }
+
+    if (strcmp(key, "fold") == 0) {
+        int separator = -1;
+        for (int i = 0; i < n && separator == -1; i++) {
+            if (chars[i].codepoint == '>' && !chars[i].escaped) {
+                separator = i;
+            }
+        }
+        uint32_t dstFirst, dstLast;
+        if (separator == -1) {
+            fprintf(stderr, "[RULES] Line %d: expected SRC>DST in fold rule\n", rules->lineNumber);
+            return -1;
+        }
+        if (parseRange(rules, chars, separator, &first, &last) != 0
+            || parseRange(rules, chars + separator + 1, n - separator - 1, &dstFirst, &dstLast) != 0) {
+            return -1;
+        }
+        if (dstFirst != dstLast && dstLast - dstFirst != last - first) {
+            fprintf(stderr, "[RULES] Line %d: fold ranges must have the same length\n", rules->lineNumber);
+            return -1;
+        }
+        for (uint32_t cp = first; cp <= last; cp++) {
+            rules->foldTo[cp] = dstFirst == dstLast ? dstFirst : dstFirst + (cp - first);
+        }
+        return 0;
+    }
+
+    if (parseRange(rules, chars, n, &first, &last) != 0) {
+        return -1;
+    }
+    for (uint32_t cp = first; cp <= last; cp++) {
+        if (strcmp(key, "start") == 0) {
+            rules->baseClass[cp] |= CLASS_START;
+        } else if (strcmp(key, "delimiters") == 0) {
+            rules->baseClass[cp] |= CLASS_DELIMITER;
+        } else if (strcmp(key, "consonants") == 0) {
+            if ((rules->baseClass[cp] & CLASS_CONSONANT_MASK) != 0) {
+                continue;
+            }
+            if (rules->nConsonants == MAX_CONSONANTS) {
+                fprintf(stderr, "[RULES] Line %d: more than %d consonants\n", rules->lineNumber, MAX_CONSONANTS);
+                return -1;
+            }
+            rules->baseClass[cp] |= ++rules->nConsonants;
+        } else {
+            fprintf(stderr, "[RULES] Line %d: unknown rule %s\n", rules->lineNumber, key);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief Applies one line of the rules.
+ *
+ * \param rules Rules being compiled.
+ * \param line Line (null-terminated, modified).
+ *
+ * \return 0 on success, -1 if the line is invalid.
+ */
+static int applyLine(struct Rules *rules, char *line) {
+    // remove the comment (an unescaped '#' at the start of a token)
+    for (char *ptr = line; *ptr != '\0'; ptr++) {
+        if (*ptr == '\\' && ptr[1] != '\0') {
+            ptr++;
+        } else if (*ptr == '#' && (ptr == line || strchr(" \t=", ptr[-1]) != NULL)) {
+            *ptr = '\0';
+            break;
+        }
+    }
+
+    char *equals = strchr(line, '=');
+    char *key = strtok(line, " \t\r\n=");
+    if (key == NULL) {
+        return 0; // empty line
+    }
+    if (equals == NULL || key > equals) {
+        fprintf(stderr, "[RULES] Line %d: expected key = tokens\n", rules->lineNumber);
+        return -1;
+    }
+
+    char *savePtr;
+    for (char *token = strtok_r(equals + 1, " \t\r\n", &savePtr); token != NULL; token = strtok_r(NULL, " \t\r\n", &savePtr)) {
+        if (applyToken(rules, key, token) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief Loads the tokenizer rules and compiles them into the charClass table.
+ *
+ * \param rulesPath path to the rules file (NULL for the built-in default rules).
+ *
+ * \return 0 on success, -1 if the rules could not be read or are invalid (an error message is printed).
+ */
+int loadTokenRules(const char *rulesPath) {
+    FILE *file = rulesPath == NULL ? fmemopen((void *) DEFAULT_TOKEN_RULES, strlen(DEFAULT_TOKEN_RULES), "r")
+                                   : fopen(rulesPath, "r");
+    if (file == NULL) {
+        perror("Error opening rules file");
+        return -1;
+    }
+
+    struct Rules *rules = (struct Rules *) calloc(1, sizeof(struct Rules));
+    if (rules == NULL) {
+        perror("Error allocating the rules");
+        fclose(file);
+        return -1;
+    }
+    for (uint32_t cp = 0; cp <= MAX_RULES_CODEPOINT; cp++) {
+        rules->foldTo[cp] = cp;
+    }
+
+    char line[MAX_RULE_LINE];
+    int status = 0;
+    while (status == 0 && fgets(line, MAX_RULE_LINE, file) != NULL) {
+        rules->lineNumber++;
+        status = applyLine(rules, line);
+    }
+    fclose(file);
+
+    if (status == 0) {
+        // a character behaves as the one it is folded to, and a delimiter never starts a word
+        for (uint32_t cp = 0; cp <= MAX_RULES_CODEPOINT; cp++) {
+            uint8_t class = rules->baseClass[rules->foldTo[cp]];
+            charClass[cp] = (class & CLASS_DELIMITER) ? (class & ~CLASS_START) : class;
+        }
+        nConsonants = rules->nConsonants;
+    }
+
+    free(rules);
+    return status;
+}
@@ -0,0 +1,57 @@
+/**
+ *  \file tokenRules.h (interface file)
+ *
+ *  \brief Assignment 1.1: count words with multiple equal consonants.
+ *
+ *  This file defines the tokenizer rules (delimiters, word-start characters, consonants and folding pairs) and the dense
+ *  lookup table they are compiled into, so that the word counting loop only needs one table access per character.
+ *
+ *  Rules file format (UTF-8 text, one "key = tokens" rule per line, '#' starts a comment):
+ *  - start = characters that start a word
+ *  - delimiters = characters that are not allowed in a word
+ *  - consonants = characters that are counted as consonants
+ *  - fold = SRC>DST pairs, a character SRC behaves as the character DST (e.g. case folding or accent removal)
+ *
+ *  Tokens are separated by whitespace and are either a single character, a range X-Y of characters or, in fold rules,
+ *  a pair of characters or of ranges with the same length. The escapes \s (space), \t, \n, \r, \\, \#, \- and \uXXXX
+ *  can be used anywhere in a token. A delimiter wins over a word-start character. Only characters of the Basic
+ *  Multilingual Plane (up to U+FFFF) can be used.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+#ifndef TOKEN_RULES_H
+#define TOKEN_RULES_H
+
+#include <stdint.h>
+
+#define MAX_RULES_CODEPOINT 0xFFFF // largest code point that can be used in the rules
+#define MAX_CONSONANTS 63 // max number of consonants (slot 0 means "not a consonant")
+
+#define CLASS_CONSONANT_MASK 0x3F // consonant slot (1..MAX_CONSONANTS) of a character
+#define CLASS_START 0x40 // the character starts a word
+#define CLASS_DELIMITER 0x80 // the character is not allowed in a word
+
+// Rules for Portuguese words (built-in default)
+#define DEFAULT_TOKEN_RULES \
+    "start = 0-9 a-z _ \\u00C0-\\u00FF\n" \
+    "delimiters = \\s \\t \\n \\r \\- \" [ ] ( ) . , : ; ? ! \\u201C \\u201D \\u2013 \\u2026\n" \
+    "consonants = b c d f g h j k l m n p q r s t v w x y z\n" \
+    "fold = A-Z>a-z \\u00C0-\\u00D6>\\u00E0-\\u00F6 \\u00C7>c \\u00E7>c\n"
+
+/** \brief Dense table with the class (CLASS_* flags and consonant slot) of each code point */
+extern uint8_t charClass[MAX_RULES_CODEPOINT + 1];
+
+/** \brief Number of consonants defined by the rules */
+extern int nConsonants;
+
+/**
+ * \brief Loads the tokenizer rules and compiles them into the charClass table.
+ *
+ * \param rulesPath path to the rules file (NULL for the built-in default rules).
+ *
+ * \return 0 on success, -1 if the rules could not be read or are invalid (an error message is printed).
+ */
+extern int loadTokenRules(const char *rulesPath);
+
+#endif /* TOKEN_RULES_H */
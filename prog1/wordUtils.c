@@ -10,9 +10,6 @@
  */
 #include "wordUtils.h"
 
-/** \brief Array that stores the meaning of each single-byte character (1. start of the word, 2. single-byte delimiter) */
-int charMeaning[256];
-
 /**
  * \brief Returns the number of bytes of a UTF-8 character given its first byte.
  * 
@@ -32,39 +29,35 @@ int lengthCharUtf8(char firstByte) {
 }
 
 /**
- * \brief Converts a UTF-8 character to lowercase and removes accents.
+ * \brief Decodes the code point of a multi-byte UTF-8 character.
+ * 
+ * \param charUtf8 The UTF-8 character.
+ * \param length The number of bytes of the character (2 to 4).
  * 
- * \param charUtf8 The UTF-8 character to be normalized.
+ * \return The code point.
  */
-void normalizeCharUtf8(char *charUtf8) {
-    // Convert to lowercase
-    if (charUtf8[0] >= (char) 0x41 && charUtf8[0] <= (char) 0x5A) { // A-Z
-        charUtf8[0] += 0x20; // a-z
-    } else if (charUtf8[0] == (char) 0xC3 && charUtf8[1] >= (char) 0x80 && charUtf8[1] <= (char) 0x96) { // À-Ö 
-        charUtf8[1] += 0x20; // à-ö
-    }
-
-    // Remove accents
-    if (charUtf8[0] == (char) 0xC3 && (charUtf8[1] == (char) 0xA7 || charUtf8[1] == (char) 0x87)) {
-        charUtf8[0] = 0x63;
-        charUtf8[1] = 0x00;
+static inline uint32_t decodeCharUtf8(const unsigned char *charUtf8, int length) {
+    uint32_t codepoint = charUtf8[0] & (0x7F >> length);
+    for (int i = 1; i < length; i++) {
+        codepoint = (codepoint << 6) | (charUtf8[i] & 0x3F);
     }
+    return codepoint;
 }
 
 /**
- * \brief Initializes the charMeaning array.
+ * \brief Returns the class of a UTF-8 character in the tokenizer rules (see tokenRules.h).
+ * 
+ * \param charUtf8 The UTF-8 character.
+ * 
+ * \return The class of the character (0 if it is not valid UTF-8 or is not covered by the rules).
  */
-void initializeCharMeaning() {
-    memset(charMeaning, 0, 256 * sizeof(int));
-
-    for (int i = 0; i < strlen(START_CHARS); i++) {
-        charMeaning[(unsigned char) START_CHARS[i]] = 1;
-    }
-
-    for (int i = 0; i < strlen(SINGLE_BYTE_DELIMITERS); i++) {
-        charMeaning[(unsigned char) SINGLE_BYTE_DELIMITERS[i]] = 2;
-
+uint8_t classOfCharUtf8(const char *charUtf8) {
+    int length = lengthCharUtf8(charUtf8[0]);
+    if (length <= 1) {
+        return length == 1 ? charClass[(unsigned char) charUtf8[0]] : 0;
     }
+    uint32_t codepoint = decodeCharUtf8((const unsigned char *) charUtf8, length);
+    return codepoint <= MAX_RULES_CODEPOINT ? charClass[codepoint] : 0;
 }
 
 /**
@@ -75,7 +68,7 @@ void initializeCharMeaning() {
  * \return 1 if the character is the start of a word, 0 otherwise.
  */
 int isCharStartOfWordUtf8(const char *charUtf8) {
-    return charMeaning[(unsigned char) charUtf8[0]] == 1;
+    return (classOfCharUtf8(charUtf8) & CLASS_START) != 0;
 }
 
 /**
@@ -86,18 +79,7 @@ int isCharStartOfWordUtf8(const char *charUtf8) {
  * \return 1 if the character is not allowed in a word, 0 otherwise.
  */
 int isCharNotAllowedInWordUtf8(const char *charUtf8) {
-
-    if (
-        // multi byte delimiter
-        (charUtf8[0] == (char) 0xE2 && charUtf8[1] == (char) 0x80 && charUtf8[2] == (char) 0x9C) // “
-        || (charUtf8[0] == (char) 0xE2 && charUtf8[1] == (char) 0x80 && charUtf8[2] == (char) 0x9D) // ”
-        || (charUtf8[0] == (char) 0xE2 && charUtf8[1] == (char) 0x80 && charUtf8[2] == (char) 0x93) // –
-        || (charUtf8[0] == (char) 0xE2 && charUtf8[1] == (char) 0x80 && charUtf8[2] == (char) 0xA6) // …
-    ) {
-        return 1;
-    }
-    // single byte delimiter
-    return charUtf8[1] == (char) 0x00 && charMeaning[(unsigned char) charUtf8[0]] == 2;
+    return (classOfCharUtf8(charUtf8) & CLASS_DELIMITER) != 0;
 }
 
 /**
@@ -158,98 +140,59 @@ char extractCharFromFile(FILE *textFile, char *UTF8Char, uint8_t *charSize, uint
         }
         // Add null terminator
         UTF8Char[*charSize] = '\0';
-        normalizeCharUtf8(UTF8Char);
 
         return 1;
     }
 }
 
 /**
- * \brief Extracts a UTF-8 character from a chunk of text.
- * 
- * \param chunk Array of characters (chunk).
- * \param UTF8Char Where the extracted character will be stored.
- * \param ptr Pointer to the position in the chunk.
+ * \brief Counts the words, and those with equal consonants, of a chunk of text.
  * 
- * \return The extracted character.
- */
-char extractCharFromChunk(char *chunk, char *UTF8Char, int *ptr) {
-    char c;
-
-    // Determine number of bytes of the UTF-8 character
-    c = chunk[*ptr]; // Byte #1
-
-    if (c == '\0') {
-        memset(UTF8Char, 0, MAX_CHAR_LENGTH);
-        return -1;
-    }
-    else {
-        int charLength = lengthCharUtf8(c);
-
-        if (charLength == 0) {
-            printf("Invalid UTF-8 character\n");
-            memset(UTF8Char, 0, MAX_CHAR_LENGTH);
-        }
-
-        else {
-            // Add the first byte to the UTF-8 character
-            UTF8Char[0] = c;
-            (*ptr)++;
-
-            // Read the remaining bytes
-            for (int i = 1; i < charLength; i++) {
-                c = chunk[*ptr]; // Byte #2, #3, #4
-                if (c == EOF) {
-                    printf("Error reading char: EOF\n");
-                    memset(UTF8Char, 0, MAX_CHAR_LENGTH);
-                }
-                else {
-                    UTF8Char[i] = c;
-                }
-                (*ptr)++;
-            }
-
-            // Add null terminator
-            UTF8Char[charLength] = '\0';
-            normalizeCharUtf8(UTF8Char);
-        }
-
-        return 1;
-    }
-}
-
-/**
- * \brief Processes a character to determine if it is part of a word.
+ * Every character is classified with a single access to the charClass table, which already takes folding into account.
  * 
- * \param currentChar (Pointer) The character being processed.
+ * \param chunk Array of characters (chunk).
+ * \param chunkSize Number of bytes of the chunk.
  * \param inWord (Pointer) Whether the program is currently processing a word.
  * \param nWords (Pointer) Number of words found.
  * \param nWordsWMultCons (Pointer) Number of words with equal consonants found.
- * \param consOcc Array that stores the number of occurrences of each consonant in the words.
- * \param detMultCons (Pointer) Indicates if the current word has equal consonants.
  */
-void processChar(char* word, char *UTF8Char, bool *inWord, int *nWords, int *nWordsWMultCons, int consOcc[], bool *detMultCons) {
-    if (*inWord && isCharNotAllowedInWordUtf8(UTF8Char)) {
-        *inWord = false;
-        memset(consOcc, 0, 26 * sizeof(int));
-        memset(word, 0, MAX_CHAR_LENGTH);
-    }
-    else if (!(*inWord) && isCharStartOfWordUtf8(UTF8Char)) {
-        *inWord = true;
-        *detMultCons = false;
-        (*nWords)++;
-        strcpy(word, UTF8Char);
-    }
-    else if (*inWord) {
-        strcat(word, UTF8Char);
-    }
+void processChunk(const char *chunk, int chunkSize, bool *inWord, int *nWords, int *nWordsWMultCons) {
+    const unsigned char *ptr = (const unsigned char *) chunk;
+    const unsigned char *end = ptr + chunkSize;
+    int consOcc[MAX_CONSONANTS + 1] = {0}; // occurrences of each consonant slot in the current word
+    bool detMultCons = false; // the current word has equal consonants
+
+    while (ptr < end) {
+        uint8_t class;
+
+        if (*ptr < 0x80) {
+            class = charClass[*ptr++];
+        } else {
+            int length = lengthCharUtf8((char) *ptr);
+            if (length == 0 || ptr + length > end) {
+                // invalid or truncated UTF-8 character
+                ptr++;
+                continue;
+            }
+            uint32_t codepoint = decodeCharUtf8(ptr, length);
+            class = codepoint <= MAX_RULES_CODEPOINT ? charClass[codepoint] : 0;
+            ptr += length;
+        }
 
-    if (strchr(CONSONANTS, UTF8Char[0]) != NULL) {
-        consOcc[UTF8Char[0] - 'a']++;
+        if (*inWord && (class & CLASS_DELIMITER)) {
+            *inWord = false;
+            memset(consOcc, 0, (nConsonants + 1) * sizeof(int));
+        }
+        else if (!(*inWord) && (class & CLASS_START)) {
+            *inWord = true;
+            detMultCons = false;
+            (*nWords)++;
+        }
 
-        if (!(*detMultCons) && consOcc[UTF8Char[0] - 'a'] > 1) {
+        int consonant = class & CLASS_CONSONANT_MASK;
+        if (consonant != 0 && ++consOcc[consonant] > 1 && !detMultCons) {
             (*nWordsWMultCons)++;
-            *detMultCons = true;
+            detMultCons = true;
         }
     }
-}
\ No newline at end of file
+}
@@ -13,15 +13,9 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "tokenRules.h"
 
-// For Portuguese words, we don't have to consider some special characters
-#define START_CHARS "0123456789abcdefghijklmnopqrstuvwxyzàáâãäåæçèéêëìíîïðñòóôõöøùúûüýÿ_"
-#define SINGLE_BYTE_DELIMITERS " \t\n\r-\"[]().,:;?!–"
 #define MAX_CHAR_LENGTH 5 // max number of bytes of a UTF-8 character + null terminator
-#define CONSONANTS "bcdfghjklmnpqrstvwxyz"
-
-/** \brief Array that stores the meaning of each single-byte character (1. start of the word, 2. single-byte delimiter) */
-extern int charMeaning[256];
 
 /**
  * \brief Returns the number of bytes of a UTF-8 character given its first byte.
@@ -31,16 +25,13 @@ extern int charMeaning[256];
 extern int lengthCharUtf8(char firstByte);
 
 /**
- * \brief Converts a UTF-8 character to lowercase and removes accents.
+ * \brief Returns the class of a UTF-8 character in the tokenizer rules (see tokenRules.h).
  * 
- * \param charUtf8 The UTF-8 character to be normalized.
- */
-extern void normalizeCharUtf8(char *charUtf8);
-
-/**
- * \brief Initializes the charMeaning array.
+ * \param charUtf8 The UTF-8 character.
+ * 
+ * \return The class of the character (0 if it is not valid UTF-8 or is not covered by the rules).
  */
-extern void initializeCharMeaning();
+extern uint8_t classOfCharUtf8(const char *charUtf8);
 
 /**
  * \brief Checks if a character is the start of a word.
@@ -73,24 +64,14 @@ extern int isCharNotAllowedInWordUtf8(const char *charUtf8);
 extern char extractCharFromFile(FILE *textFile, char *UTF8Char, uint8_t *charSize, uint8_t *removePos);
 
 /**
- * \brief Extracts a UTF-8 character from a chunk of text.
+ * \brief Counts the words, and those with equal consonants, of a chunk of text.
  * 
- * \param chunk Array of characters (chunk).
- * \param UTF8Char Where the extracted character will be stored.
- * \param ptr Pointer to the position in the chunk.
+ * Every character is classified with a single access to the charClass table, which already takes folding into account.
  * 
- * \return The extracted character.
- */
-extern char extractCharFromChunk(char *chunk, char *UTF8Char, int *ptr);
-
-/**
- * \brief Processes a character to determine if it is part of a word.
- * 
- * \param currentChar (Pointer) The character being processed.
+ * \param chunk Array of characters (chunk).
+ * \param chunkSize Number of bytes of the chunk.
  * \param inWord (Pointer) Whether the program is currently processing a word.
  * \param nWords (Pointer) Number of words found.
  * \param nWordsWMultCons (Pointer) Number of words with equal consonants found.
- * \param consOcc Array that stores the number of occurrences of each consonant in the words.
- * \param detMultCons (Pointer) Indicates if the current word has equal consonants.
  */
-extern void processChar(char *word, char *currentChar, bool *inWord, int *nWords, int *nWordsWMultCons, int consOcc[], bool *detMultCons);
+extern void processChunk(const char *chunk, int chunkSize, bool *inWord, int *nWords, int *nWordsWMultCons);
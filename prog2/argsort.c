@@ -0,0 +1,311 @@
+/**
+ *  \file argsort.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the indirect sort (argsort) and of the parallel permutation.
+ *
+ *  Each phase forks one task per chunk of the array and continues with the next phase, like the sample sort.
+ *  The state shared by the tasks of an argsort (or of a permutation) lives in a single structure, freed by the last
+ *  phase.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "steal.h"
+#include "argsort.h"
+
+/** \brief Phase of the argsort: fork the packing of each chunk */
+#define PACKS_PHASE 0
+
+/** \brief Phase of the argsort: pack the elements of a chunk with their indices */
+#define PACK_PHASE 1
+
+/** \brief Phase of the argsort: run the sort of the packed array */
+#define SORT_PHASE 2
+
+/** \brief Phase of the argsort: fork the unpacking of each chunk */
+#define UNPACKS_PHASE 3
+
+/** \brief Phase of the argsort: unpack the indices of a chunk */
+#define UNPACK_PHASE 4
+
+/** \brief Phase of the argsort and of the permutation: free the state */
+#define FINISH_PHASE 5
+
+/** \brief Phase of the permutation: fork the permutation of each chunk */
+#define PERMUTES_PHASE 6
+
+/** \brief Phase of the permutation: copy the elements of a chunk of the destination from the source */
+#define PERMUTE_PHASE 7
+
+/** \brief State shared by the tasks of an argsort (or of a permutation, from arr to out) */
+typedef struct {
+    const char *arr;
+    int size;
+    int elem_type;
+    int direction;
+    int *perm;
+    char *packed;
+    int packed_size;
+    int packed_type;
+    steal_task_t *sort;
+    char *out;
+    size_t elem_size;
+    int n_chunks;
+} argsort_t;
+
+static void run_argsort_job(steal_pool_t *pool, steal_task_t *header);
+
+/**
+ *  \brief Gets the type of the words into which the elements of a type are packed with their index.
+ *
+ *  \param elem_type type of the elements (ELEM_* of const.h)
+ *
+ *  \return ELEM_INT64 for the 32-bit keys, ELEM_PAIR for the 64-bit ones
+ */
+int argsort_packed_type(int elem_type) {
+    return kernel_ops(elem_type)->elem_size == 4 ? ELEM_INT64 : ELEM_PAIR;
+}
+
+/**
+ *  \brief Maps a 32-bit key to an unsigned integer in the same order (the total order, for floats).
+ *
+ *  \param bits bits of the key
+ *  \param elem_type ELEM_INT32, ELEM_UINT32 or ELEM_FLOAT
+ *
+ *  \return unsigned integer in the order of the key
+ */
+static inline uint32_t order_key32(uint32_t bits, int elem_type) {
+    if (elem_type == ELEM_INT32) {
+        return bits ^ 0x80000000u;
+    }
+    if (elem_type == ELEM_FLOAT) {
+        // negative floats are in the opposite order of their bits
+        return bits ^ (bits >> 31 ? 0xFFFFFFFFu : 0x80000000u);
+    }
+    return bits;
+}
+
+/**
+ *  \brief Maps a 64-bit key to a signed integer in the same order (the total order, for doubles).
+ *
+ *  \param elem ELEM_INT64, ELEM_DOUBLE or ELEM_RECORD element
+ *  \param elem_type type of the element
+ *
+ *  \return signed integer in the order of the key
+ */
+static inline int64_t order_key64(const char *elem, int elem_type) {
+    if (elem_type == ELEM_RECORD) {
+        return ((const record_t *) elem)->key;
+    }
+    uint64_t bits;
+    memcpy(&bits, elem, sizeof(bits));
+    if (elem_type == ELEM_DOUBLE) {
+        // unsigned total order, then shifted to the signed one
+        bits ^= bits >> 63 ? UINT64_C(0xFFFFFFFFFFFFFFFF) : UINT64_C(0x8000000000000000);
+        bits ^= UINT64_C(0x8000000000000000);
+    }
+    return (int64_t) bits;
+}
+
+/**
+ *  \brief Packs the elements of a chunk with their indices, and fills the extra words after the last element.
+ *
+ *  \param argsort state of the argsort
+ *  \param low first position of the chunk
+ *  \param high position after the last one of the chunk
+ */
+static void pack_chunk(const argsort_t *argsort, int low, int high) {
+    int descending = argsort->direction == DESCENDING;
+    int end = high < argsort->size ? high : argsort->size;
+    if (argsort->packed_type == ELEM_INT64) {
+        int64_t *words = (int64_t *) argsort->packed;
+        for (int i = low; i < end; i++) {
+            uint32_t bits;
+            memcpy(&bits, argsort->arr + (size_t) i * 4, sizeof(bits));
+            // the key is shifted back to the signed order of the word, the index complemented in descending order
+            uint64_t key = order_key32(bits, argsort->elem_type) ^ 0x80000000u;
+            words[i] = (int64_t) (key << 32 | (descending ? ~(uint32_t) i : (uint32_t) i));
+        }
+        // no element is packed into the last word of the order: its index would be 2^32 - 1
+        for (int i = end > low ? end : low; i < high; i++) {
+            words[i] = descending ? INT64_MIN : INT64_MAX;
+        }
+    } else {
+        record_t *records = (record_t *) argsort->packed;
+        size_t elem_size = kernel_ops(argsort->elem_type)->elem_size;
+        uint64_t mask = descending ? UINT64_MAX : 0;
+        // the index is complemented in descending order, like in the words
+        for (int i = low; i < end; i++) {
+            records[i] = (record_t) {order_key64(argsort->arr + (size_t) i * elem_size, argsort->elem_type),
+                                     (uint64_t) i ^ mask};
+        }
+        // the extra records tie with the last key at most, and their indices sort them after it
+        for (int i = end > low ? end : low; i < high; i++) {
+            records[i] = (record_t) {descending ? INT64_MIN : INT64_MAX, (uint64_t) i ^ mask};
+        }
+    }
+}
+
+/**
+ *  \brief Unpacks the indices of a chunk of the sorted words.
+ *
+ *  \param argsort state of the argsort
+ *  \param low first position of the chunk
+ *  \param high position after the last one of the chunk
+ */
+static void unpack_chunk(const argsort_t *argsort, int low, int high) {
+    if (argsort->packed_type == ELEM_INT64) {
+        const int64_t *words = (const int64_t *) argsort->packed;
+        uint32_t mask = argsort->direction == DESCENDING ? 0xFFFFFFFFu : 0;
+        for (int i = low; i < high; i++) {
+            argsort->perm[i] = (int) ((uint32_t) words[i] ^ mask);
+        }
+    } else {
+        const record_t *records = (const record_t *) argsort->packed;
+        uint64_t mask = argsort->direction == DESCENDING ? UINT64_MAX : 0;
+        for (int i = low; i < high; i++) {
+            argsort->perm[i] = (int) (records[i].row_id ^ mask);
+        }
+    }
+}
+
+/**
+ *  \brief Copies the elements of a chunk of the destination of a permutation from the source.
+ *
+ *  Inlined with a constant element size, so the copy of each element is a single load and store.
+ *
+ *  \param argsort state of the permutation
+ *  \param low first position of the chunk
+ *  \param high position after the last one of the chunk
+ *  \param elem_size number of bytes of an element
+ */
+static inline void permute_elems(const argsort_t *argsort, int low, int high, size_t elem_size) {
+    for (int i = low; i < high; i++) {
+        memcpy(argsort->out + (size_t) i * elem_size, argsort->arr + (size_t) argsort->perm[i] * elem_size, elem_size);
+    }
+}
+
+/**
+ *  \brief Executes a fork/join task of an argsort or of a permutation.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header header of the fork/join task
+ */
+static void run_argsort_job(steal_pool_t *pool, steal_task_t *header) {
+    steal_phase_t *job = (steal_phase_t *) header;
+    argsort_t *argsort = (argsort_t *) job->state;
+    // the packing covers the extra words, the unpacking and the permutation only the elements
+    int n = job->phase == PACK_PHASE ? argsort->packed_size : argsort->size;
+    int chunk = (n + argsort->n_chunks - 1) / argsort->n_chunks;
+    int low = (int) ((long long) job->index * chunk < n ? job->index * chunk : n);
+    int high = n - low < chunk ? n : low + chunk;
+
+    if (job->phase == PACKS_PHASE) {
+        steal_fork_phase(pool, header, PACK_PHASE, argsort->n_chunks, SORT_PHASE);
+    } else if (job->phase == PACK_PHASE) {
+        pack_chunk(argsort, low, high);
+        steal_done(pool, header);
+    } else if (job->phase == SORT_PHASE) {
+        steal_task_t *sort = argsort->sort;
+        steal_fork(pool, header, steal_phase_job(run_argsort_job, argsort, UNPACKS_PHASE, 0), &sort, 1);
+    } else if (job->phase == UNPACKS_PHASE) {
+        steal_fork_phase(pool, header, UNPACK_PHASE, argsort->n_chunks, FINISH_PHASE);
+    } else if (job->phase == UNPACK_PHASE) {
+        unpack_chunk(argsort, low, high);
+        steal_done(pool, header);
+    } else if (job->phase == PERMUTES_PHASE) {
+        steal_fork_phase(pool, header, PERMUTE_PHASE, argsort->n_chunks, FINISH_PHASE);
+    } else if (job->phase == PERMUTE_PHASE) {
+        if (argsort->elem_size == 4) {
+            permute_elems(argsort, low, high, 4);
+        } else if (argsort->elem_size == 8) {
+            permute_elems(argsort, low, high, 8);
+        } else if (argsort->elem_size == 16) {
+            permute_elems(argsort, low, high, 16);
+        } else {
+            permute_elems(argsort, low, high, argsort->elem_size);
+        }
+        steal_done(pool, header);
+    } else {
+        // finish phase
+        free(argsort->packed);
+        free(argsort);
+        steal_done(pool, header);
+    }
+    free(header);
+}
+
+/**
+ *  \brief Allocates the root task of the argsort of an array.
+ *
+ *  The task runs the sort task as a child, and frees the packed array when it completes.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the argsort
+ *  \param sort task that sorts the packed array (left to the caller if there is no memory for the argsort)
+ *  \param packed packed array (packed_size words of argsort_packed_type(elem_type), allocated with malloc)
+ *  \param packed_size number of words of the packed array (at least size)
+ *  \param arr array whose indices are sorted (not modified)
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *  \param perm array of size indices where the indices of the elements are stored, in the order of the sort
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the argsort
+ */
+steal_task_t *new_argsort_job(steal_pool_t *pool, steal_task_t *sort, void *packed, int packed_size, const void *arr,
+                              int size, int elem_type, int direction, int *perm) {
+    argsort_t *argsort = (argsort_t *) calloc(1, sizeof(argsort_t));
+    if (argsort == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the argsort\n");
+        return NULL;
+    }
+    argsort->arr = (const char *) arr;
+    argsort->size = size;
+    argsort->elem_type = elem_type;
+    argsort->direction = direction;
+    argsort->perm = perm;
+    argsort->packed = (char *) packed;
+    argsort->packed_size = packed_size;
+    argsort->packed_type = argsort_packed_type(elem_type);
+    argsort->sort = sort;
+    argsort->n_chunks = steal_chunk_count(pool, packed_size);
+    return steal_phase_job(run_argsort_job, argsort, PACKS_PHASE, 0);
+}
+
+/**
+ *  \brief Allocates the root task of the permutation of an array: dst[i] = src[perm[i]], in chunks.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the permutation
+ *  \param perm indices of the elements of the source, in the order of the destination
+ *  \param src source array (not modified)
+ *  \param dst destination array (size elements, must not overlap the source)
+ *  \param size number of elements in the arrays
+ *  \param elem_size number of bytes of an element (any)
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the permutation
+ */
+steal_task_t *new_permute_job(steal_pool_t *pool, const int *perm, const void *src, void *dst, int size,
+                              size_t elem_size) {
+    argsort_t *argsort = (argsort_t *) calloc(1, sizeof(argsort_t));
+    if (argsort == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the permutation\n");
+        return NULL;
+    }
+    argsort->arr = (const char *) src;
+    argsort->size = size;
+    argsort->perm = (int *) perm;
+    argsort->out = (char *) dst;
+    argsort->elem_size = elem_size;
+    argsort->n_chunks = steal_chunk_count(pool, size);
+    return steal_phase_job(run_argsort_job, argsort, PERMUTES_PHASE, 0);
+}
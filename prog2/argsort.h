@@ -0,0 +1,79 @@
+/**
+ *  \file argsort.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the indirect sort (argsort), that computes the indices that sort an array
+ *  instead of sorting it, and of the parallel permutation that applies them to other arrays (columns).
+ *
+ *  Each element is packed with its index into a word that one of the sorts of the library sorts as it is, so the
+ *  SIMD kernels still apply:
+ *  - 32-bit keys (ELEM_INT32, ELEM_UINT32, ELEM_FLOAT) are mapped to unsigned integers in the same order and packed
+ *    with their index into a 64-bit integer (ELEM_INT64), the key in the upper half; in descending order the index is
+ *    complemented, so equal keys keep the order of their indices in both directions, and every word is distinct
+ *  - 64-bit keys (ELEM_INT64, ELEM_DOUBLE, ELEM_RECORD) do not fit in a word with their index, so they are mapped to
+ *    signed integers in the same order and packed with their index, complemented in the same way, into a record
+ *    ordered by its key and then by its index (ELEM_PAIR), so the records are distinct too (the radix sort only sorts
+ *    the keys, but it is stable, and the records are packed in the order of their indices)
+ *
+ *  The argsort is a chain of fork/join tasks of the work-stealing scheduler: pack the array in chunks, run the sort of
+ *  the packed words, and unpack the indices in chunks.
+ *  The packed array may be longer than the array (the bitonic sort needs a power of 2): the extra words hold the last
+ *  key of the order and an index past the end, so they are sorted after all the elements and never unpacked.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef ARGSORT_H
+#define ARGSORT_H
+
+#include <stddef.h>
+
+#include "steal.h"
+
+/**
+ *  \brief Gets the type of the words into which the elements of a type are packed with their index.
+ *
+ *  \param elem_type type of the elements (ELEM_* of const.h)
+ *
+ *  \return ELEM_INT64 for the 32-bit keys, ELEM_PAIR for the 64-bit ones
+ */
+int argsort_packed_type(int elem_type);
+
+/**
+ *  \brief Allocates the root task of the argsort of an array.
+ *
+ *  The task runs the sort task as a child, and frees the packed array when it completes.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the argsort
+ *  \param sort task that sorts the packed array (left to the caller if there is no memory for the argsort)
+ *  \param packed packed array (packed_size words of argsort_packed_type(elem_type), allocated with malloc)
+ *  \param packed_size number of words of the packed array (at least size)
+ *  \param arr array whose indices are sorted (not modified)
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *  \param perm array of size indices where the indices of the elements are stored, in the order of the sort
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the argsort
+ */
+steal_task_t *new_argsort_job(steal_pool_t *pool, steal_task_t *sort, void *packed, int packed_size, const void *arr,
+                              int size, int elem_type, int direction, int *perm);
+
+/**
+ *  \brief Allocates the root task of the permutation of an array: dst[i] = src[perm[i]], in chunks.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the permutation
+ *  \param perm indices of the elements of the source, in the order of the destination
+ *  \param src source array (not modified)
+ *  \param dst destination array (size elements, must not overlap the source)
+ *  \param size number of elements in the arrays
+ *  \param elem_size number of bytes of an element (any)
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the permutation
+ */
+steal_task_t *new_permute_job(steal_pool_t *pool, const int *perm, const void *src, void *dst, int size,
+                              size_t elem_size);
+
+#endif /* ARGSORT_H */
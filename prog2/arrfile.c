@@ -0,0 +1,133 @@
+/**
+ *  \file arrfile.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the operations on the files of elements.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "arrfile.h"
+
+/**
+ *  \brief Reads the header of a file of elements.
+ *
+ *  The element type is not validated.
+ *
+ *  \param fd file descriptor of the file
+ *  \param header where the header will be stored
+ *
+ *  \return EXIT_SUCCESS if the header was read, EXIT_FAILURE otherwise
+ */
+int read_array_header(int fd, array_header_t *header) {
+    uint32_t words[2] = {0, 0};
+    if (pread_fully(fd, words, sizeof(uint32_t), 0) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    if (words[0] != TYPED_FILE_MAGIC) {
+        header->typed = 0;
+        header->elem_type = ELEM_INT32;
+        header->count = (uint64_t) (int32_t) words[0];
+        header->size = sizeof(int);
+        return EXIT_SUCCESS;
+    }
+    uint64_t count;
+    if (pread_fully(fd, words, sizeof(words), 0) != EXIT_SUCCESS
+        || pread_fully(fd, &count, sizeof(count), sizeof(words)) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    header->typed = 1;
+    header->elem_type = (int) words[1];
+    header->count = count;
+    header->size = sizeof(words) + sizeof(count);
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Writes the header of a file of elements, in the same format as another one.
+ *
+ *  \param fd file descriptor of the file
+ *  \param header header to be written (typed, elem_type and count)
+ *
+ *  \return EXIT_SUCCESS if the header was written, EXIT_FAILURE otherwise
+ */
+int write_array_header(int fd, const array_header_t *header) {
+    if (!header->typed) {
+        int size = (int) header->count;
+        return pwrite_fully(fd, &size, sizeof(size), 0);
+    }
+    uint32_t words[2] = {TYPED_FILE_MAGIC, (uint32_t) header->elem_type};
+    uint64_t count = header->count;
+    if (pwrite_fully(fd, words, sizeof(words), 0) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    return pwrite_fully(fd, &count, sizeof(count), sizeof(words));
+}
+
+/**
+ *  \brief Reads a block of a file, retrying short reads.
+ *
+ *  \param fd file descriptor of the file
+ *  \param buf buffer where the block will be stored
+ *  \param bytes number of bytes of the block
+ *  \param offset offset of the block in the file
+ *
+ *  \return EXIT_SUCCESS if the whole block was read, EXIT_FAILURE otherwise
+ */
+int pread_fully(int fd, void *buf, size_t bytes, off_t offset) {
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t n = pread(fd, (char *) buf + done, bytes - done, offset + (off_t) done);
+        if (n <= 0) {
+            return EXIT_FAILURE;
+        }
+        done += n;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Writes a block of a file, retrying short writes.
+ *
+ *  \param fd file descriptor of the file
+ *  \param buf block to be written
+ *  \param bytes number of bytes of the block
+ *  \param offset offset of the block in the file
+ *
+ *  \return EXIT_SUCCESS if the whole block was written, EXIT_FAILURE otherwise
+ */
+int pwrite_fully(int fd, const void *buf, size_t bytes, off_t offset) {
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t n = pwrite(fd, (const char *) buf + done, bytes - done, offset + (off_t) done);
+        if (n <= 0) {
+            return EXIT_FAILURE;
+        }
+        done += n;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Checks if two file descriptors refer to the same file (same device and inode, also through links).
+ *
+ *  \param fd first file descriptor
+ *  \param other_fd second file descriptor
+ *
+ *  \return 1 if they refer to the same file, 0 otherwise (also if one of them cannot be checked)
+ */
+int same_file(int fd, int other_fd) {
+    struct stat st, other_st;
+    if (fstat(fd, &st) != 0 || fstat(other_fd, &other_st) != 0) {
+        return 0;
+    }
+    return st.st_dev == other_st.st_dev && st.st_ino == other_st.st_ino;
+}
@@ -0,0 +1,94 @@
+/**
+ *  \file arrfile.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the operations on the files of elements.
+ *
+ *  A file starts either with a typed header (TYPED_FILE_MAGIC, element type and number of elements, as 32-bit,
+ *  32-bit and 64-bit unsigned integers) or with the number of elements as a 32-bit integer, in which case the elements
+ *  are 32-bit integers. The elements follow the header.
+ *
+ *  Operations:
+ *  - read_array_header: reads the header of a file
+ *  - write_array_header: writes the header of a file
+ *  - pread_fully: reads a block of a file, retrying short reads
+ *  - pwrite_fully: writes a block of a file, retrying short writes
+ *  - same_file: checks if two file descriptors refer to the same file
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef ARRFILE_H
+#define ARRFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** \brief Header of a file of elements */
+typedef struct {
+    int typed;
+    int elem_type;
+    uint64_t count;
+    size_t size;
+} array_header_t;
+
+/**
+ *  \brief Reads the header of a file of elements.
+ *
+ *  The element type is not validated.
+ *
+ *  \param fd file descriptor of the file
+ *  \param header where the header will be stored
+ *
+ *  \return EXIT_SUCCESS if the header was read, EXIT_FAILURE otherwise
+ */
+int read_array_header(int fd, array_header_t *header);
+
+/**
+ *  \brief Writes the header of a file of elements, in the same format as another one.
+ *
+ *  \param fd file descriptor of the file
+ *  \param header header to be written (typed, elem_type and count)
+ *
+ *  \return EXIT_SUCCESS if the header was written, EXIT_FAILURE otherwise
+ */
+int write_array_header(int fd, const array_header_t *header);
+
+/**
+ *  \brief Reads a block of a file, retrying short reads.
+ *
+ *  \param fd file descriptor of the file
+ *  \param buf buffer where the block will be stored
+ *  \param bytes number of bytes of the block
+ *  \param offset offset of the block in the file
+ *
+ *  \return EXIT_SUCCESS if the whole block was read, EXIT_FAILURE otherwise
+ */
+int pread_fully(int fd, void *buf, size_t bytes, off_t offset);
+
+/**
+ *  \brief Writes a block of a file, retrying short writes.
+ *
+ *  \param fd file descriptor of the file
+ *  \param buf block to be written
+ *  \param bytes number of bytes of the block
+ *  \param offset offset of the block in the file
+ *
+ *  \return EXIT_SUCCESS if the whole block was written, EXIT_FAILURE otherwise
+ */
+int pwrite_fully(int fd, const void *buf, size_t bytes, off_t offset);
+
+/**
+ *  \brief Checks if two file descriptors refer to the same file (same device and inode, also through links).
+ *
+ *  \param fd first file descriptor
+ *  \param other_fd second file descriptor
+ *
+ *  \return 1 if they refer to the same file, 0 otherwise (also if one of them cannot be checked)
+ */
+int same_file(int fd, int other_fd);
+
+#endif /* ARRFILE_H */
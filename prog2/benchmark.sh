@@ -1,29 +1,113 @@
 # Usage: ./benchmark.sh
-# Description: Compiles the source code, runs the multithreaded bitonic sort program, and outputs the results in a
-#              "results" file, for each configuration of array sizes (32, 256K, 1M, 16M) and threads (1, 2, 4, 8).
-# Example: ./benchmark.sh
+# Description: Compiles the source code, generates the input files with genData, runs each configuration of the
+#              multithreaded bitonic sort program RUNS times, and outputs the median, minimum and maximum sort time
+#              of each configuration in a "results.csv" file, for the experiments:
+#              - distribution: each distribution and size (int32 elements), with THREADS threads
+#              - strong: a fixed array of STRONG_SIZE random int32 elements, for each number of threads
+#              - weak: WEAK_SIZE random int32 elements per thread, for each number of threads (powers of 2)
+#              - type: TYPED_SIZE random elements of each type, with THREADS threads
+#              Every experiment also runs the single-threaded baselines (qsort and the bitonic sort kernel), so
+#              that regressions show up. The parameters can be overridden from the environment.
+# Example: RUNS=9 SIZES="32 1048576 268435456" ./benchmark.sh
 
-OUTPUT_FILE="results.txt"
-FOLDER_NUMBERS="data"
-FILE_NUMBERS="datSeq32.bin datSeq256K.bin datSeq1M.bin datSeq16M.bin"
-N_THREADS="1 2 4 8"
+OUTPUT_FILE="results.csv"
+FOLDER_DATA="bmdata"
+RUNS=${RUNS:-5}
+THREADS=${THREADS:-8}
+N_THREADS=${N_THREADS:-"1 2 4 8 16"}
+DISTRIBUTIONS=${DISTRIBUTIONS:-"random sorted reverse few organpipe zipf"}
+SIZES=${SIZES:-"32 32768 1048576 16777216"}
+STRONG_SIZE=${STRONG_SIZE:-16777216}
+WEAK_SIZE=${WEAK_SIZE:-2097152}
+TYPED_SIZE=${TYPED_SIZE:-16777216}
+ELEM_TYPES=${ELEM_TYPES:-"int32 int64 uint32 float double record"}
+CONFIGS="lockstep:bitonic steal:bitonic steal:samplesort steal:mergesort steal:radix"
+BASELINES="qsort serial"
 
 # Create the output file
-rm -f $OUTPUT_FILE
-touch $OUTPUT_FILE
+echo "experiment,type,distribution,size,scheduler,algorithm,threads,runs,median_s,min_s,max_s,spread_pct,median_ns_per_elem" > $OUTPUT_FILE
+mkdir -p $FOLDER_DATA
 
 # Compile the source code
-gcc -Wall -O3 -o bmprog2 multiBitonic.c
-
-# Run the program for each configuration of threads and array sizes
-for file in $FILE_NUMBERS; do
-  for threads in $N_THREADS; do
-    echo "Running program with file $file and $threads threads..."
-    echo "File: $file; Threads: $threads" >> $OUTPUT_FILE
-    ./bmprog2 -f $FOLDER_NUMBERS/$file -n $threads | grep '^\[TIME\]' >> $OUTPUT_FILE
-    echo "" >> $OUTPUT_FILE
+gcc -Wall -O3 -o bmprog2 multiBitonic.c shared.c arrfile.c extsort.c stats.c memory.c pipeline.c topk.c verify.c bitonic.c steal.c samplesort.c radix.c presort.c merge.c mergesort.c argsort.c kernels.c
+gcc -Wall -O3 -o bmgenData genData.c kernels.c -lm
+
+# Prints the path of the input file of a type, distribution and size, generating it if it does not exist
+# Arguments: type distribution size
+input_file() {
+  local file=$FOLDER_DATA/$1.$2.$3.bin
+  if [ ! -f $file ]; then
+    ./bmgenData -t $1 -d $2 -n $3 -o $file > /dev/null
+  fi
+  echo $file
+}
+
+# Runs a configuration RUNS times and appends its line to the output file (the times are empty if a run failed)
+# Arguments: experiment type distribution size scheduler algorithm threads
+measure() {
+  local file=$(input_file $2 $3 $4)
+  echo "Running program with experiment $1, type $2, distribution $3, size $4, scheduler $5, algorithm $6 and $7 threads..."
+  for run in $(seq 1 $RUNS); do
+    ./bmprog2 -f $file -n $7 -s $5 -a $6 | awk '
+      /^\[TIME\] Time elapsed:/ { time = $4 }
+      /everything is OK/ { ok = 1 }
+      END { if (ok) print time; else print "failed" }'
+  done | sort -g | awk -v prefix="$1,$2,$3,$4,$5,$6,$7,$RUNS" -v size=$4 '
+    $1 == "failed" { failed = 1; next }
+    { times[n++] = $1 }
+    END {
+      if (failed || n == 0) { print prefix ",,,,,"; exit }
+      median = (n % 2) ? times[int(n / 2)] : (times[n / 2 - 1] + times[n / 2]) / 2
+      spread = median > 0 ? 100 * (times[n - 1] - times[0]) / median : 0
+      printf "%s,%.9f,%.9f,%.9f,%.1f,%.3f\n", prefix, median, times[0], times[n - 1], spread, 1.0e9 * median / size }' >> $OUTPUT_FILE
+}
+
+# Runs each configuration of scheduler and algorithm (the radix sort only on integer keys)
+# Arguments: experiment type distribution size threads
+measure_all() {
+  for config in $CONFIGS; do
+    local scheduler=${config%%:*}
+    local algorithm=${config##*:}
+    if [ $algorithm = radix ] && { [ $2 = float ] || [ $2 = double ]; }; then
+      continue
+    fi
+    measure $1 $2 $3 $4 $scheduler $algorithm $5
+  done
+}
+
+# Runs the single-threaded baselines
+# Arguments: experiment type distribution size
+measure_baselines() {
+  for baseline in $BASELINES; do
+    measure $1 $2 $3 $4 steal $baseline 1
+  done
+}
+
+# Distributions and sizes
+for distribution in $DISTRIBUTIONS; do
+  for size in $SIZES; do
+    measure_baselines distribution int32 $distribution $size
+    measure_all distribution int32 $distribution $size $THREADS
   done
 done
 
+# Strong scaling: fixed size, growing number of threads
+measure_baselines strong int32 random $STRONG_SIZE
+for threads in $N_THREADS; do
+  measure_all strong int32 random $STRONG_SIZE $threads
+done
+
+# Weak scaling: fixed size per thread, growing number of threads
+for threads in $N_THREADS; do
+  measure_baselines weak int32 random $((WEAK_SIZE * threads))
+  measure_all weak int32 random $((WEAK_SIZE * threads)) $threads
+done
+
+# Element types
+for type in $ELEM_TYPES; do
+  measure_baselines type $type random $TYPED_SIZE
+  measure_all type $type random $TYPED_SIZE $THREADS
+done
+
 # Clean-up
-rm -f bmprog2
+rm -rf bmprog2 bmgenData $FOLDER_DATA
@@ -0,0 +1,566 @@
+/**
+ *  \file bitonic.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the bitonic sort library (libbitonic.a).
+ *
+ *  Each sort is a tree of fork/join tasks of the work-stealing scheduler, rooted at a single sort task. A handle holds
+ *  the latch that is released when the whole tree completes.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "shared.h"
+#include "steal.h"
+#include "samplesort.h"
+#include "radix.h"
+#include "mergesort.h"
+#include "presort.h"
+#include "argsort.h"
+#include "bitonic.h"
+
+/** \brief Structure that represents a pool of worker threads that sorts arrays */
+struct bitonic_pool {
+    steal_pool_t steal;
+};
+
+/** \brief Structure that represents the handle of a submitted sort (or batch of sorts) */
+struct bitonic_handle {
+    steal_latch_t latch;
+    bitonic_pool_t *pool;
+};
+
+/**
+ *  \brief Fork/join task of the work-stealing scheduler: a task of one of the types of const.h on a range of the array.
+ */
+typedef struct {
+    steal_task_t header;
+    task_t task;
+} bitonic_job_t;
+
+static void run_bitonic_job(steal_pool_t *pool, steal_task_t *header);
+
+/**
+ *  \brief Allocates a fork/join task of the work-stealing scheduler.
+ *
+ *  \param task task to be executed
+ *
+ *  \return pointer to the fork/join task
+ */
+static steal_task_t *new_bitonic_job(task_t task) {
+    bitonic_job_t *job = (bitonic_job_t *) malloc(sizeof(bitonic_job_t));
+    if (job == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for a task\n");
+        exit(EXIT_FAILURE);
+    }
+    job->header.run = run_bitonic_job;
+    job->task = task;
+    return &job->header;
+}
+
+/**
+ *  \brief Executes a fork/join task of the work-stealing scheduler.
+ *
+ *  Ranges of up to STEAL_GRAIN_SIZE elements are processed sequentially, larger ones are split:
+ *  - a load task forks a load task for each half
+ *  - a sort task forks the sort of each half (ascending, descending), and continues with the merge of the range
+ *  - a merge task forks its first two levels split in two, and continues with a merge quarters task
+ *  - a merge level pair task forks a merge level pair task for each half of its slice
+ *  - a merge quarters task forks the merge of each quarter, from the level after the first two
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header header of the fork/join task
+ */
+static void run_bitonic_job(steal_pool_t *pool, steal_task_t *header) {
+    task_t *task = &((bitonic_job_t *) header)->task;
+    void *arr = task->arr;
+    const kernel_ops_t *ops = kernel_ops(task->elem_type);
+    int elem_type = task->elem_type;
+    int low_index = task->low_index;
+    int count = task->count;
+    int direction = task->direction;
+    int half = task->half;
+    int sub_count = count / 2;
+
+    if (count <= STEAL_GRAIN_SIZE) {
+        if (task->type == LOAD_TASK) {
+            touch_pages(arr, low_index, count, ops->elem_size);
+        } else if (task->type == SORT_TASK) {
+            ops->sort(arr, low_index, count, direction);
+        } else if (task->type == MERGE_TASK) {
+            ops->merge_levels(arr, low_index, count, half, direction);
+        } else if (task->type == MERGE_LEVEL_PAIR_TASK) {
+            ops->level_pair_slice(arr, low_index, count, half, direction);
+        }
+        steal_done(pool, header);
+        free(header);
+        return;
+    }
+
+    steal_task_t *children[4];
+    steal_task_t *continuation = NULL;
+    int n_children = 2;
+    if (task->type == SORT_TASK) {
+        children[0] = new_bitonic_job((task_t) {SORT_TASK, arr, low_index, sub_count, ASCENDING, 0, elem_type});
+        children[1] = new_bitonic_job((task_t) {SORT_TASK, arr, low_index + sub_count, sub_count, DESCENDING, 0,
+                                                elem_type});
+        continuation = new_bitonic_job((task_t) {MERGE_TASK, arr, low_index, count, direction, sub_count,
+                                                  elem_type});
+    } else if (task->type == MERGE_TASK) {
+        // a merge of a single bitonic block (count == 2 * half): its first two levels have half / 2 groups of four
+        int quarter = half / 2;
+        children[0] = new_bitonic_job((task_t) {MERGE_LEVEL_PAIR_TASK, arr, low_index, quarter / 2, direction, half,
+                                                elem_type});
+        children[1] = new_bitonic_job((task_t) {MERGE_LEVEL_PAIR_TASK, arr, low_index + quarter / 2, quarter / 2,
+                                                direction, half, elem_type});
+        continuation = new_bitonic_job((task_t) {MERGE_QUARTERS_TASK, arr, low_index, count, direction, half,
+                                                 elem_type});
+    } else if (task->type == MERGE_QUARTERS_TASK) {
+        int quarter = count / 4;
+        for (int i = 0; i < 4; i++) {
+            children[i] = new_bitonic_job((task_t) {MERGE_TASK, arr, low_index + i * quarter, quarter, direction,
+                                                    half / 4, elem_type});
+        }
+        n_children = 4;
+    } else {
+        // load or merge level pair task: split the range in two
+        children[0] = new_bitonic_job((task_t) {task->type, arr, low_index, sub_count, direction, half, elem_type});
+        children[1] = new_bitonic_job((task_t) {task->type, arr, low_index + sub_count, sub_count, direction,
+                                                half, elem_type});
+    }
+    steal_fork(pool, header, continuation, children, n_children);
+    free(header);
+}
+
+/**
+ *  \brief Creates a pool of worker threads.
+ *
+ *  Also selects the sort kernels according to the features of the CPU, if init_kernels was not called before.
+ *
+ *  \param n_workers number of worker threads (at least 1)
+ *
+ *  \return pointer to the pool, NULL if it could not be created
+ */
+bitonic_pool_t *bitonic_pool_create(int n_workers) {
+    if (n_workers < 1) {
+        fprintf(stderr, "[LIB] Invalid number of worker threads\n");
+        return NULL;
+    }
+    if (selected_kernels() == NULL) {
+        init_kernels(1);
+    }
+    bitonic_pool_t *pool = (bitonic_pool_t *) malloc(sizeof(bitonic_pool_t));
+    if (pool == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the pool\n");
+        return NULL;
+    }
+    if (steal_init(&pool->steal, n_workers) != EXIT_SUCCESS) {
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/**
+ *  \brief Allocates the root task of the sort of an array with an algorithm.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (at least 2, a power of 2 for the bitonic sort)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_BITONIC, ALGORITHM_SAMPLESORT, ALGORITHM_RADIX or ALGORITHM_MERGESORT
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the sort
+ */
+static steal_task_t *new_sort_job(bitonic_pool_t *pool, void *arr, int size, int elem_type, int algorithm,
+                                  int direction) {
+    if (algorithm == ALGORITHM_SAMPLESORT) {
+        return new_samplesort_job(&pool->steal, arr, size, elem_type, direction);
+    }
+    if (algorithm == ALGORITHM_RADIX) {
+        return new_radix_job(&pool->steal, arr, size, elem_type, direction);
+    }
+    if (algorithm == ALGORITHM_MERGESORT) {
+        return new_mergesort_job(&pool->steal, arr, size, elem_type, direction);
+    }
+    steal_task_t *sort = new_bitonic_job((task_t) {SORT_TASK, arr, 0, size, direction, 0, elem_type});
+    // larger arrays are scanned first, and only sorted if they are not sorted, reversed or a few sorted runs
+    steal_task_t *presort = size > STEAL_GRAIN_SIZE
+                            ? new_presort_job(&pool->steal, sort, arr, size, elem_type, direction)
+                            : NULL;
+    return presort != NULL ? presort : sort;
+}
+
+/**
+ *  \brief Submits the sort of several arrays with an algorithm, without waiting for them.
+ *
+ *  \param pool pointer to the pool
+ *  \param arrs arrays to be sorted
+ *  \param sizes number of elements in each array (0 or a power of 2 for the bitonic sort)
+ *  \param n_arrs number of arrays
+ *  \param elem_type type of the elements of the arrays (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the batch, NULL if a size, the type or the algorithm is not valid or there is no memory
+ */
+static bitonic_handle_t *submit_sorts(bitonic_pool_t *pool, void **arrs, const int *sizes, int n_arrs, int elem_type,
+                                      int algorithm, int direction) {
+    if (kernel_ops(elem_type) == NULL) {
+        fprintf(stderr, "[LIB] Unknown element type %d\n", elem_type);
+        return NULL;
+    }
+    if (algorithm != ALGORITHM_BITONIC && algorithm != ALGORITHM_SAMPLESORT && algorithm != ALGORITHM_RADIX
+        && algorithm != ALGORITHM_MERGESORT) {
+        fprintf(stderr, "[LIB] Unknown algorithm %d\n", algorithm);
+        return NULL;
+    }
+    if (algorithm == ALGORITHM_RADIX && !radix_supports(elem_type)) {
+        fprintf(stderr, "[LIB] The radix sort only sorts elements with an integer key\n");
+        return NULL;
+    }
+    for (int i = 0; i < n_arrs; i++) {
+        // bitonic sort only works on sizes that are powers of 2
+        if (sizes[i] < 0 || (algorithm == ALGORITHM_BITONIC && (sizes[i] & (sizes[i] - 1)) != 0)) {
+            fprintf(stderr, "[LIB] The size of the array must be a power of 2\n");
+            return NULL;
+        }
+    }
+    bitonic_handle_t *handle = (bitonic_handle_t *) malloc(sizeof(bitonic_handle_t));
+    steal_task_t **tasks = (steal_task_t **) malloc((n_arrs > 0 ? n_arrs : 1) * sizeof(steal_task_t *));
+    if (handle == NULL || tasks == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the handle\n");
+        free(handle);
+        free(tasks);
+        return NULL;
+    }
+    handle->pool = pool;
+
+    // arrays of 0 or 1 elements are already sorted
+    int n_tasks = 0;
+    for (int i = 0; i < n_arrs; i++) {
+        if (sizes[i] <= 1) {
+            continue;
+        }
+        tasks[n_tasks] = new_sort_job(pool, arrs[i], sizes[i], elem_type, algorithm, direction);
+        if (tasks[n_tasks] == NULL) {
+            // the sorts allocated so far own memory that only their tasks free, so they are run to completion
+            steal_submit(&pool->steal, tasks, n_tasks, &handle->latch);
+            steal_wait(&pool->steal, &handle->latch);
+            free(handle);
+            free(tasks);
+            return NULL;
+        }
+        n_tasks++;
+    }
+    steal_submit(&pool->steal, tasks, n_tasks, &handle->latch);
+    free(tasks);
+    return handle;
+}
+
+/**
+ *  \brief Submits the sort of several arrays, without waiting for them.
+ *
+ *  The arrays are sorted concurrently, and the handle completes when all of them are sorted.
+ *
+ *  \param pool pointer to the pool
+ *  \param arrs arrays to be sorted
+ *  \param sizes number of elements in each array (0 or a power of 2)
+ *  \param n_arrs number of arrays
+ *  \param elem_type type of the elements of the arrays (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the batch, NULL if a size or the type is not valid or there is no memory for the handle
+ */
+bitonic_handle_t *bitonic_submit_batch(bitonic_pool_t *pool, void **arrs, const int *sizes, int n_arrs,
+                                       int elem_type, int direction) {
+    return submit_sorts(pool, arrs, sizes, n_arrs, elem_type, ALGORITHM_BITONIC, direction);
+}
+
+/**
+ *  \brief Submits the sort of an array of 32-bit integers, without waiting for it.
+ *
+ *  The array is sorted in place, so it must not be accessed until the sort is complete.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (0 or a power of 2)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the sort, NULL if the size is not valid or there is no memory for the handle
+ */
+bitonic_handle_t *bitonic_submit(bitonic_pool_t *pool, int *arr, int size, int direction) {
+    return bitonic_submit_typed(pool, arr, size, ELEM_INT32, direction);
+}
+
+/**
+ *  \brief Submits the sort of an array of any element type, without waiting for it.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (0 or a power of 2)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the sort, NULL if the size or the type is not valid or there is no memory for the handle
+ */
+bitonic_handle_t *bitonic_submit_typed(bitonic_pool_t *pool, void *arr, int size, int elem_type, int direction) {
+    return submit_sorts(pool, &arr, &size, 1, elem_type, ALGORITHM_BITONIC, direction);
+}
+
+/**
+ *  \brief Submits the sort of an array with an algorithm, without waiting for it.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (0 or a power of 2 for the bitonic sort, any for the sample sort)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the sort, NULL if the size, the type or the algorithm is not valid or there is no memory
+ */
+bitonic_handle_t *bitonic_submit_algorithm(bitonic_pool_t *pool, void *arr, int size, int elem_type, int algorithm,
+                                           int direction) {
+    return submit_sorts(pool, &arr, &size, 1, elem_type, algorithm, direction);
+}
+
+/**
+ *  \brief Computes the auxiliary memory that the sort of an array with an algorithm allocates.
+ *
+ *  \param pool pointer to the pool
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return number of bytes allocated by the sort besides the array (0 for the in-place bitonic sort)
+ */
+size_t bitonic_aux_memory(bitonic_pool_t *pool, int size, int elem_type, int algorithm) {
+    if (algorithm == ALGORITHM_SAMPLESORT) {
+        return samplesort_memory(&pool->steal, size, elem_type);
+    }
+    if (algorithm == ALGORITHM_RADIX) {
+        return radix_memory(&pool->steal, size, elem_type);
+    }
+    if (algorithm == ALGORITHM_MERGESORT) {
+        return mergesort_memory(&pool->steal, size, elem_type);
+    }
+    return 0;
+}
+
+/**
+ *  \brief Computes the number of words of the packed array of the argsort of an array.
+ *
+ *  \param size number of elements in the array
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return size, or the next power of 2 for the bitonic sort, -1 if it does not fit in an int
+ */
+static int packed_size(int size, int algorithm) {
+    if (algorithm != ALGORITHM_BITONIC) {
+        return size;
+    }
+    int padded = 1;
+    while (padded < size) {
+        if (padded > INT_MAX / 2) {
+            return -1;
+        }
+        padded *= 2;
+    }
+    return padded;
+}
+
+/**
+ *  \brief Submits the argsort of an array, without waiting for it: the indices of its elements in sorted order.
+ *
+ *  The elements are packed with their indices and sorted by the algorithm (see argsort.h), so the sort is stable:
+ *  equal elements keep the order of their indices. The array is not modified, and the indices can be applied to
+ *  other arrays of the same size with bitonic_submit_permute.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array whose indices are sorted
+ *  \param size number of elements in the array (any, also for the bitonic sort)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_BITONIC, ALGORITHM_SAMPLESORT, ALGORITHM_RADIX or ALGORITHM_MERGESORT
+ *  \param direction DESCENDING or ASCENDING
+ *  \param perm array of size indices where the indices of the elements are stored, in the order of the sort
+ *
+ *  \return handle of the argsort, NULL if the size, the type or the algorithm is not valid or there is no memory
+ */
+bitonic_handle_t *bitonic_submit_argsort(bitonic_pool_t *pool, const void *arr, int size, int elem_type,
+                                         int algorithm, int direction, int *perm) {
+    if (kernel_ops(elem_type) == NULL) {
+        fprintf(stderr, "[LIB] Unknown element type %d\n", elem_type);
+        return NULL;
+    }
+    if (algorithm != ALGORITHM_BITONIC && algorithm != ALGORITHM_SAMPLESORT && algorithm != ALGORITHM_RADIX
+        && algorithm != ALGORITHM_MERGESORT) {
+        fprintf(stderr, "[LIB] Unknown algorithm %d\n", algorithm);
+        return NULL;
+    }
+    int n_packed = packed_size(size, algorithm);
+    if (size < 0 || n_packed < 0) {
+        fprintf(stderr, "[LIB] Invalid size %d of the argsort\n", size);
+        return NULL;
+    }
+    bitonic_handle_t *handle = (bitonic_handle_t *) malloc(sizeof(bitonic_handle_t));
+    if (handle == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the handle\n");
+        return NULL;
+    }
+    handle->pool = pool;
+    // arrays of 0 or 1 elements are already sorted
+    if (size <= 1) {
+        if (size == 1) {
+            perm[0] = 0;
+        }
+        steal_submit(&pool->steal, NULL, 0, &handle->latch);
+        return handle;
+    }
+    int packed_type = argsort_packed_type(elem_type);
+    void *packed = malloc((size_t) n_packed * kernel_ops(packed_type)->elem_size);
+    steal_task_t *sort = packed != NULL ? new_sort_job(pool, packed, n_packed, packed_type, algorithm, direction)
+                                        : NULL;
+    steal_task_t *argsort = sort != NULL ? new_argsort_job(&pool->steal, sort, packed, n_packed, arr, size, elem_type,
+                                                           direction, perm)
+                                         : NULL;
+    if (argsort == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the argsort\n");
+        if (sort != NULL) {
+            // the sort owns memory that only its tasks free, so it is run to completion
+            steal_run(&pool->steal, sort);
+        }
+        free(packed);
+        free(handle);
+        return NULL;
+    }
+    steal_submit(&pool->steal, &argsort, 1, &handle->latch);
+    return handle;
+}
+
+/**
+ *  \brief Submits the permutation of an array by the indices of an argsort, without waiting for it.
+ *
+ *  dst[i] = src[perm[i]]: the destination holds the elements of the source in the order of the argsort. The
+ *  permutations of several arrays (columns) can be submitted at once, and run concurrently.
+ *
+ *  \param pool pointer to the pool
+ *  \param perm indices of the elements of the source, in the order of the destination (see bitonic_submit_argsort)
+ *  \param src source array
+ *  \param dst destination array (size elements, must not overlap the source)
+ *  \param size number of elements in the arrays
+ *  \param elem_size number of bytes of an element (any, the arrays need not hold ELEM_* elements)
+ *
+ *  \return handle of the permutation, NULL if the size is not valid or there is no memory
+ */
+bitonic_handle_t *bitonic_submit_permute(bitonic_pool_t *pool, const int *perm, const void *src, void *dst, int size,
+                                         size_t elem_size) {
+    if (size < 0 || elem_size == 0) {
+        fprintf(stderr, "[LIB] Invalid size of the permutation\n");
+        return NULL;
+    }
+    bitonic_handle_t *handle = (bitonic_handle_t *) malloc(sizeof(bitonic_handle_t));
+    steal_task_t *permute = handle != NULL && size > 0
+                            ? new_permute_job(&pool->steal, perm, src, dst, size, elem_size)
+                            : NULL;
+    if (handle == NULL || (size > 0 && permute == NULL)) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the permutation\n");
+        free(handle);
+        return NULL;
+    }
+    handle->pool = pool;
+    steal_submit(&pool->steal, &permute, size > 0 ? 1 : 0, &handle->latch);
+    return handle;
+}
+
+/**
+ *  \brief Computes the auxiliary memory that the argsort of an array with an algorithm allocates.
+ *
+ *  \param pool pointer to the pool
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return number of bytes allocated by the argsort besides the array and the indices (packed array and sort)
+ */
+size_t bitonic_argsort_memory(bitonic_pool_t *pool, int size, int elem_type, int algorithm) {
+    int n_packed = packed_size(size, algorithm);
+    if (kernel_ops(elem_type) == NULL || size <= 1 || n_packed < 0) {
+        return 0;
+    }
+    int packed_type = argsort_packed_type(elem_type);
+    return (size_t) n_packed * kernel_ops(packed_type)->elem_size
+           + bitonic_aux_memory(pool, n_packed, packed_type, algorithm);
+}
+
+/**
+ *  \brief Checks if a sort is complete, without blocking.
+ *
+ *  \param handle handle of the sort
+ *
+ *  \return 1 if the sort is complete, 0 otherwise
+ */
+int bitonic_poll(bitonic_handle_t *handle) {
+    return steal_latch_done(&handle->latch);
+}
+
+/**
+ *  \brief Waits for a sort to complete, and frees its handle.
+ *
+ *  Should not be called by a worker thread of the pool.
+ *
+ *  \param handle handle of the sort
+ */
+void bitonic_wait(bitonic_handle_t *handle) {
+    steal_wait(&handle->pool->steal, &handle->latch);
+    free(handle);
+}
+
+/**
+ *  \brief Faults in the pages of an array in parallel, and waits for it.
+ *
+ *  Useful for memory that was just mapped, so that the page faults are not paid by the sort.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array whose pages are faulted in
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ */
+void bitonic_prefault(bitonic_pool_t *pool, void *arr, int size, int elem_type) {
+    if (size > 0 && kernel_ops(elem_type) != NULL) {
+        steal_run(&pool->steal, new_bitonic_job((task_t) {LOAD_TASK, arr, 0, size, 0, 0, elem_type}));
+    }
+}
+
+/**
+ *  \brief Gets the number of tasks stolen by the worker threads of a pool.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return number of tasks stolen since the pool was created
+ */
+long bitonic_pool_steals(bitonic_pool_t *pool) {
+    return steal_count(&pool->steal);
+}
+
+/**
+ *  \brief Terminates the worker threads of a pool and frees it.
+ *
+ *  The sorts submitted to the pool must be complete.
+ *
+ *  \param pool pointer to the pool
+ */
+void bitonic_pool_destroy(bitonic_pool_t *pool) {
+    steal_destroy(&pool->steal);
+    free(pool);
+}
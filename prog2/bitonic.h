@@ -0,0 +1,240 @@
+/**
+ *  \file bitonic.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the bitonic sort library (libbitonic.a).
+ *
+ *  A pool of worker threads is created once and sorts any number of arrays afterwards, so back-to-back sorts do not
+ *  pay for thread creation. The arrays are sorted in place, on the memory of the caller, by the work-stealing
+ *  scheduler. Submitting a sort does not block: it returns a handle that can be polled or waited for.
+ *
+ *  The arrays of the bitonic sort larger than STEAL_GRAIN_SIZE are scanned in parallel first (see presort.h): an array
+ *  that is already sorted is left as it is, one sorted in the opposite order is reversed, and one made of at most
+ *  PRESORT_MAX_RUNS sorted runs is merged, instead of being sorted.
+ *
+ *  Operations:
+ *  - bitonic_pool_create: creates a pool of worker threads
+ *  - bitonic_submit: submits the sort of an array of 32-bit integers
+ *  - bitonic_submit_typed: submits the sort of an array of any element type (ELEM_* of const.h)
+ *  - bitonic_submit_algorithm: submits the sort of an array with another algorithm (ALGORITHM_* of const.h)
+ *  - bitonic_aux_memory: computes the auxiliary memory of the sort of an array with an algorithm
+ *  - bitonic_submit_batch: submits the sort of several arrays, with a single handle
+ *  - bitonic_submit_argsort: submits the argsort of an array (the indices of its elements in sorted order)
+ *  - bitonic_submit_permute: submits the permutation of an array (column) by the indices of an argsort
+ *  - bitonic_argsort_memory: computes the auxiliary memory of the argsort of an array with an algorithm
+ *  - bitonic_poll: checks if a sort is complete
+ *  - bitonic_wait: waits for a sort to complete
+ *  - bitonic_prefault: faults in the pages of an array in parallel
+ *  - bitonic_pool_destroy: terminates the worker threads of a pool
+ *
+ *  Example:
+ *
+ *      bitonic_pool_t *pool = bitonic_pool_create(8);
+ *      bitonic_handle_t *handle = bitonic_submit(pool, arr, 1 << 20, ASCENDING);
+ *      ...
+ *      bitonic_wait(handle);
+ *      bitonic_pool_destroy(pool);
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef BITONIC_H
+#define BITONIC_H
+
+#include <stddef.h>
+
+#include "const.h"
+
+/** \brief Pool of worker threads that sorts arrays */
+typedef struct bitonic_pool bitonic_pool_t;
+
+/** \brief Handle of a submitted sort (or batch of sorts) */
+typedef struct bitonic_handle bitonic_handle_t;
+
+/**
+ *  \brief Creates a pool of worker threads.
+ *
+ *  Also selects the sort kernels according to the features of the CPU, if init_kernels was not called before.
+ *
+ *  \param n_workers number of worker threads (at least 1)
+ *
+ *  \return pointer to the pool, NULL if it could not be created
+ */
+bitonic_pool_t *bitonic_pool_create(int n_workers);
+
+/**
+ *  \brief Submits the sort of an array of 32-bit integers, without waiting for it.
+ *
+ *  The array is sorted in place, so it must not be accessed until the sort is complete.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (0 or a power of 2)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the sort, NULL if the size is not valid or there is no memory for the handle
+ */
+bitonic_handle_t *bitonic_submit(bitonic_pool_t *pool, int *arr, int size, int direction);
+
+/**
+ *  \brief Submits the sort of an array of any element type, without waiting for it.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (0 or a power of 2)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the sort, NULL if the size or the type is not valid or there is no memory for the handle
+ */
+bitonic_handle_t *bitonic_submit_typed(bitonic_pool_t *pool, void *arr, int size, int elem_type, int direction);
+
+/**
+ *  \brief Submits the sort of an array with an algorithm, without waiting for it.
+ *
+ *  ALGORITHM_SAMPLESORT and ALGORITHM_MERGESORT sort arrays of any size, with an auxiliary buffer as large as the
+ *  array. ALGORITHM_RADIX too, but only arrays of elements with an integer key (ELEM_INT32, ELEM_UINT32, ELEM_INT64 and
+ *  ELEM_RECORD).
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (0 or a power of 2 for the bitonic sort, any for the others)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the sort, NULL if the size, the type or the algorithm is not valid or there is no memory
+ */
+bitonic_handle_t *bitonic_submit_algorithm(bitonic_pool_t *pool, void *arr, int size, int elem_type, int algorithm,
+                                           int direction);
+
+/**
+ *  \brief Computes the auxiliary memory that the sort of an array with an algorithm allocates.
+ *
+ *  \param pool pointer to the pool
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return number of bytes allocated by the sort besides the array (0 for the in-place bitonic sort)
+ */
+size_t bitonic_aux_memory(bitonic_pool_t *pool, int size, int elem_type, int algorithm);
+
+/**
+ *  \brief Submits the sort of several arrays, without waiting for them.
+ *
+ *  The arrays are sorted concurrently, and the handle completes when all of them are sorted.
+ *
+ *  \param pool pointer to the pool
+ *  \param arrs arrays to be sorted
+ *  \param sizes number of elements in each array (0 or a power of 2)
+ *  \param n_arrs number of arrays
+ *  \param elem_type type of the elements of the arrays (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return handle of the batch, NULL if a size or the type is not valid or there is no memory for the handle
+ */
+bitonic_handle_t *bitonic_submit_batch(bitonic_pool_t *pool, void **arrs, const int *sizes, int n_arrs,
+                                       int elem_type, int direction);
+
+/**
+ *  \brief Submits the argsort of an array, without waiting for it: the indices of its elements in sorted order.
+ *
+ *  The elements are packed with their indices and sorted by the algorithm (see argsort.h), so the sort is stable:
+ *  equal elements keep the order of their indices. The array is not modified, and the indices can be applied to
+ *  other arrays of the same size with bitonic_submit_permute.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array whose indices are sorted
+ *  \param size number of elements in the array (any, also for the bitonic sort)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_BITONIC, ALGORITHM_SAMPLESORT, ALGORITHM_RADIX or ALGORITHM_MERGESORT
+ *  \param direction DESCENDING or ASCENDING
+ *  \param perm array of size indices where the indices of the elements are stored, in the order of the sort
+ *
+ *  \return handle of the argsort, NULL if the size, the type or the algorithm is not valid or there is no memory
+ */
+bitonic_handle_t *bitonic_submit_argsort(bitonic_pool_t *pool, const void *arr, int size, int elem_type,
+                                         int algorithm, int direction, int *perm);
+
+/**
+ *  \brief Submits the permutation of an array by the indices of an argsort, without waiting for it.
+ *
+ *  dst[i] = src[perm[i]]: the destination holds the elements of the source in the order of the argsort. The
+ *  permutations of several arrays (columns) can be submitted at once, and run concurrently.
+ *
+ *  \param pool pointer to the pool
+ *  \param perm indices of the elements of the source, in the order of the destination (see bitonic_submit_argsort)
+ *  \param src source array
+ *  \param dst destination array (size elements, must not overlap the source)
+ *  \param size number of elements in the arrays
+ *  \param elem_size number of bytes of an element (any, the arrays need not hold ELEM_* elements)
+ *
+ *  \return handle of the permutation, NULL if the size is not valid or there is no memory
+ */
+bitonic_handle_t *bitonic_submit_permute(bitonic_pool_t *pool, const int *perm, const void *src, void *dst, int size,
+                                         size_t elem_size);
+
+/**
+ *  \brief Computes the auxiliary memory that the argsort of an array with an algorithm allocates.
+ *
+ *  \param pool pointer to the pool
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return number of bytes allocated by the argsort besides the array and the indices (packed array and sort)
+ */
+size_t bitonic_argsort_memory(bitonic_pool_t *pool, int size, int elem_type, int algorithm);
+
+/**
+ *  \brief Checks if a sort is complete, without blocking.
+ *
+ *  \param handle handle of the sort
+ *
+ *  \return 1 if the sort is complete, 0 otherwise
+ */
+int bitonic_poll(bitonic_handle_t *handle);
+
+/**
+ *  \brief Waits for a sort to complete, and frees its handle.
+ *
+ *  Should not be called by a worker thread of the pool.
+ *
+ *  \param handle handle of the sort
+ */
+void bitonic_wait(bitonic_handle_t *handle);
+
+/**
+ *  \brief Faults in the pages of an array in parallel, and waits for it.
+ *
+ *  Useful for memory that was just mapped, so that the page faults are not paid by the sort.
+ *
+ *  \param pool pointer to the pool
+ *  \param arr array whose pages are faulted in
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ */
+void bitonic_prefault(bitonic_pool_t *pool, void *arr, int size, int elem_type);
+
+/**
+ *  \brief Gets the number of tasks stolen by the worker threads of a pool.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return number of tasks stolen since the pool was created
+ */
+long bitonic_pool_steals(bitonic_pool_t *pool);
+
+/**
+ *  \brief Terminates the worker threads of a pool and frees it.
+ *
+ *  The sorts submitted to the pool must be complete.
+ *
+ *  \param pool pointer to the pool
+ */
+void bitonic_pool_destroy(bitonic_pool_t *pool);
+
+#endif /* BITONIC_H */
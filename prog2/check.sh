@@ -0,0 +1,155 @@
+# Usage: sh check.sh (or make check)
+# Description: Sorts the input files of the data folder with the SIMD leaf kernels (AVX2, if the CPU supports them)
+#              and with the scalar ones (-S), on both schedulers, and compares each output file with the one of the
+#              qsort baseline, byte by byte. Then generates a file of each element type and distribution (genData) and
+#              checks every algorithm (-a), the top-K selection (-k), the external sort (-m) and the argsort (-A) on
+#              it, with numbers of worker threads that are not powers of 2 where the scheduler allows them. Exits with
+#              a non-zero status if an output differs or a run fails.
+#              PROG selects the binary, e.g. one built with -fsanitize=address, which also catches out-of-range accesses
+#              that leave the output intact.
+# Example: FILES="data/datSeq32.bin" sh check.sh
+#          TYPES="int64 record" DISTS=few sh check.sh
+#          PROG=./prog2_asan sh check.sh
+
+PROG=${PROG:-./prog2}
+FILES=${FILES:-"data/datSeq32.bin data/datSeq256K.bin"}
+THREADS=${THREADS:-4}
+TYPES=${TYPES:-"int32 int64 uint32 float double record"}
+DISTS=${DISTS:-"random few organpipe"}
+SIZE=${SIZE:-262144}
+TOP_K=${TOP_K:-1000}
+FOLDER_OUTPUT=$(mktemp -d)
+trap 'rm -rf $FOLDER_OUTPUT' EXIT
+
+failures=0
+
+# check NAME INPUT EXPECTED FLAGS...: sorts INPUT with FLAGS and compares the output with the file EXPECTED
+check() {
+  name=$1
+  input=$2
+  expected=$3
+  shift 3
+  output=$FOLDER_OUTPUT/output.bin
+  if $PROG -f $input "$@" -o $output > /dev/null && cmp -s $output $expected; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name"
+    failures=$((failures + 1))
+  fi
+}
+
+# check_run NAME FLAGS...: runs the program with FLAGS, which verifies its own result
+check_run() {
+  name=$1
+  shift
+  if $PROG "$@" > /dev/null; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name"
+    failures=$((failures + 1))
+  fi
+}
+
+# check_top NAME INPUT EXPECTED BYTES FLAGS...: selects the top-K of INPUT with FLAGS and compares the elements of the
+# output with the first BYTES bytes of the elements of the file EXPECTED (after the typed header of 16 bytes)
+check_top() {
+  name=$1
+  input=$2
+  expected=$3
+  bytes=$4
+  shift 4
+  output=$FOLDER_OUTPUT/output.bin
+  tail -c +17 $expected | head -c $bytes > $FOLDER_OUTPUT/top.bin
+  if $PROG -f $input "$@" -o $output > /dev/null && tail -c +17 $output | cmp -s - $FOLDER_OUTPUT/top.bin; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name"
+    failures=$((failures + 1))
+  fi
+}
+
+# baseline BASELINE INPUT: sorts INPUT with qsort into the file BASELINE
+baseline() {
+  if ! $PROG -f $2 -a qsort -o $1 > /dev/null; then
+    echo "FAIL $2 qsort"
+    failures=$((failures + 1))
+    return 1
+  fi
+}
+
+for file in $FILES; do
+  expected=$FOLDER_OUTPUT/qsort.bin
+  baseline $expected $file || continue
+  for scheduler in steal lockstep; do
+    check "$file $scheduler simd" $file $expected -n $THREADS -s $scheduler
+    check "$file $scheduler scalar" $file $expected -n $THREADS -s $scheduler -S
+  done
+done
+
+# more chunks than the array fills (4 per worker thread, 80 chunks of 52 elements for 4096 elements and 20 threads)
+small=$FOLDER_OUTPUT/small.bin
+./genData -o $small -n 4096 > /dev/null
+if baseline $FOLDER_OUTPUT/small.qsort.bin $small; then
+  for algorithm in radix samplesort mergesort bitonic; do
+    check "4096 elements $algorithm 20 threads" $small $FOLDER_OUTPUT/small.qsort.bin -n 20 -a $algorithm
+  done
+fi
+
+# every element type and distribution; the records of the distributions other than random have equal keys, whose
+# sorted order is not unique, so they are only checked by the parallel verification (order and checksum)
+for type in $TYPES; do
+  case $type in
+    int32 | uint32 | float) elem_size=4 ;;
+    int64 | double) elem_size=8 ;;
+    *) elem_size=16 ;;
+  esac
+  case $type in
+    float | double) algorithms="bitonic samplesort mergesort" ;;
+    *) algorithms="bitonic samplesort mergesort radix" ;;
+  esac
+  for dist in $DISTS; do
+    label="$SIZE $type $dist"
+    input=$FOLDER_OUTPUT/input.bin
+    if ! ./genData -o $input -n $SIZE -t $type -d $dist > /dev/null; then
+      echo "FAIL $label genData"
+      failures=$((failures + 1))
+      continue
+    fi
+
+    # the stable argsort has a single result, so every algorithm must write the same indices
+    indices=$FOLDER_OUTPUT/indices.bin
+    rm -f $indices
+    for algorithm in $algorithms; do
+      if [ -f $indices ]; then
+        check "$label argsort $algorithm 6 threads" $input $indices -A -a $algorithm -n 6
+      else
+        check_run "$label argsort $algorithm 6 threads" -f $input -A -a $algorithm -n 6 -o $indices
+      fi
+    done
+
+    output=$FOLDER_OUTPUT/output.bin
+    budget=$((SIZE * elem_size / 2))
+    if [ $type = record ] && [ $dist != random ]; then
+      for algorithm in $algorithms serial; do
+        check_run "$label $algorithm 3 threads" -f $input -a $algorithm -n 3 -V parallel -o $output
+      done
+      check_run "$label top-$TOP_K lockstep" -f $input -k $TOP_K -s lockstep -n 4 -o $output
+      check_run "$label external $budget bytes 5 threads" -f $input -m $budget -n 5 -o $output
+      continue
+    fi
+    expected=$FOLDER_OUTPUT/qsort.bin
+    baseline $expected $input || continue
+    for algorithm in $algorithms serial; do
+      check "$label $algorithm 3 threads" $input $expected -a $algorithm -n 3
+    done
+    check "$label lockstep" $input $expected -s lockstep -n $THREADS
+    check_top "$label top-$TOP_K lockstep" $input $expected $((TOP_K * elem_size)) -k $TOP_K -s lockstep -n 4
+    check "$label external $budget bytes 5 threads" $input $expected -m $budget -n 5
+  done
+done
+
+if [ $failures -gt 0 ]; then
+  echo "$failures check(s) failed"
+  exit 1
+fi
+echo "All checks passed"
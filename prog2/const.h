@@ -21,6 +21,139 @@
 /** \brief Ascending sort direction */
 #define ASCENDING 1
 
+/** \brief Number of elements of the blocks that fit in the L2 cache (bitonic merge blocking) */
+#define L2_BLOCK_SIZE (1 << 16)
+
+/** \brief Number of elements of the blocks that fit in the L1 cache (bitonic merge blocking) */
+#define L1_BLOCK_SIZE (1 << 12)
+
+/** \brief Number of elements below which the fork/join tasks of the work-stealing scheduler run sequentially */
+#define STEAL_GRAIN_SIZE L2_BLOCK_SIZE
+
+/** \brief Sort algorithm: bitonic sort */
+#define ALGORITHM_BITONIC 0
+
+/** \brief Sort algorithm: sample sort (buckets delimited by sampled splitters, each sorted by the bitonic kernels) */
+#define ALGORITHM_SAMPLESORT 1
+
+/** \brief Sort algorithm: LSD radix sort (integer keys only) */
+#define ALGORITHM_RADIX 2
+
+/** \brief Sort algorithm: qsort of the C library on the main thread (baseline of prog2, not run by the library) */
+#define ALGORITHM_QSORT 3
+
+/** \brief Sort algorithm: bitonic sort kernel on the main thread (baseline of prog2, not run by the library) */
+#define ALGORITHM_SERIAL 4
+
+/** \brief Sort algorithm: merge sort (one sorted run per worker thread, merged in rounds split by merge path) */
+#define ALGORITHM_MERGESORT 5
+
+/** \brief Maximum number of sorted runs that the pre-scan of the bitonic sort merges instead of sorting the array */
+#define PRESORT_MAX_RUNS 16
+
+/** \brief Number of elements the pre-scan checks between two checks of whether another chunk has given up */
+#define PRESORT_SCAN_BLOCK (1 << 12)
+
+/** \brief Number of samples per bucket taken to choose the splitters of the sample sort */
+#define SAMPLE_OVERSAMPLING 16
+
+/** \brief Maximum number of buckets of the sample sort */
+#define SAMPLE_MAX_BUCKETS 1024
+
+/** \brief Target number of elements of a bucket of the sample sort */
+#define SAMPLE_BUCKET_SIZE (1 << 14)
+
+/** \brief Number of bits of a digit of the radix sort */
+#define RADIX_BITS 11
+
+/** \brief Number of bytes of the write-combining buffer of each digit of the radix sort (a cache line) */
+#define RADIX_WC_BYTES 64
+
+/** \brief Number of elements below which the radix sort falls back to the bitonic kernels */
+#define RADIX_MIN_SIZE (1 << 12)
+
+/** \brief Alignment of the slices of the input file read by each thread into the output file (bytes) */
+#define READ_SLICE_ALIGN (1 << 16)
+
+/** \brief Number of bytes of the blocks read by the reader thread of the pipelined load (-P) */
+#define PIPELINE_READ_BLOCK (1 << 22)
+
+/** \brief Memory of the array: huge pages (-H) */
+#define ARRAY_HUGE 1
+
+/** \brief Memory of the array: pages interleaved across the NUMA nodes (-I) */
+#define ARRAY_INTERLEAVE 2
+
+/** \brief Size of the huge pages the mapping of the array is rounded up to */
+#define HUGE_PAGE_SIZE (1 << 21)
+
+/** \brief Number of elements sampled from each run of the external sort to split the final merge among the threads */
+#define EXT_SAMPLES_PER_RUN 256
+
+/** \brief Minimum number of bytes of the read and write buffers of the merge of the external sort */
+#define EXT_MIN_BLOCK (1 << 16)
+
+/** \brief Maximum number of bytes of the read and write buffers of the merge of the external sort */
+#define EXT_MAX_BLOCK (1 << 26)
+
+/** \brief Lockstep scheduler (a distributor thread assigns one task to each worker thread per phase) */
+#define SCHEDULER_LOCKSTEP 0
+
+/** \brief Work-stealing scheduler (recursive fork/join tasks on per-worker deques) */
+#define SCHEDULER_STEAL 1
+
+/** \brief Synchronization mode of the lockstep scheduler: mutex and condition variables */
+#define SYNC_COND 0
+
+/** \brief Synchronization mode of the lockstep scheduler: per-worker task slots and a spin/futex barrier */
+#define SYNC_SPIN 1
+
+/** \brief Number of iterations a thread spins at the barrier before parking on the futex */
+#define BARRIER_SPINS (1 << 12)
+
+/** \brief Verification of the sorted array: order checked by the main thread (default) */
+#define VERIFY_SERIAL 0
+
+/** \brief Verification of the sorted array: order and multiset checksum of the input and output, by several threads */
+#define VERIFY_PARALLEL 1
+
+/** \brief Verification of the sorted array: none (-V none, for production runs) */
+#define VERIFY_NONE 2
+
+/** \brief Maximum number of phases of the lockstep scheduler recorded by the statistics (-p, -T) */
+#define STATS_MAX_PHASES 1024
+
+/** \brief Number of pages of each task whose NUMA node is sampled by the statistics */
+#define STATS_NUMA_SAMPLES 64
+
+/** \brief Element type: 32-bit signed integer (the type of the files without a typed header) */
+#define ELEM_INT32 0
+
+/** \brief Element type: 64-bit signed integer */
+#define ELEM_INT64 1
+
+/** \brief Element type: 32-bit unsigned integer */
+#define ELEM_UINT32 2
+
+/** \brief Element type: IEEE 754 single precision float */
+#define ELEM_FLOAT 3
+
+/** \brief Element type: IEEE 754 double precision float */
+#define ELEM_DOUBLE 4
+
+/** \brief Element type: 16-byte record (64-bit key and 64-bit row id) */
+#define ELEM_RECORD 5
+
+/** \brief Number of element types of the files */
+#define N_ELEM_TYPES 6
+
+/** \brief Element type of the packed words of the argsort of 64-bit keys, not of the files: 16-byte record ordered by
+ *  its key, then by its row id */
+#define ELEM_PAIR 6
+
+/** \brief Magic number ("BSRT") of the files with a typed header (magic, element type, number of elements) */
+#define TYPED_FILE_MAGIC 0x54525342u
+
 /** \brief Represents a sort task */
 #define SORT_TASK 0
 
@@ -30,4 +163,23 @@
 /** \brief Represents a termination task */
 #define TERMINATION_TASK 2
 
+/** \brief Represents a load task (fault in a partition of the input array) */
+#define LOAD_TASK 3
+
+/** \brief Represents a merge level task (slice of one level of a bitonic merge split among the worker threads) */
+#define MERGE_LEVEL_TASK 4
+
+/** \brief Represents a merge level pair task (slice of two fused levels of a bitonic merge) */
+#define MERGE_LEVEL_PAIR_TASK 5
+
+/** \brief Represents a merge quarters task (continuation of a merge: merges the quarters of a block after its first two
+ *  levels) */
+#define MERGE_QUARTERS_TASK 6
+
+/** \brief Represents a top-K task (selects the top-K list of a partition of the array) */
+#define TOPK_TASK 7
+
+/** \brief Represents a top-K merge task (merges the top-K lists of two worker threads) */
+#define TOPK_MERGE_TASK 8
+
 #endif /* CONST_H */
@@ -0,0 +1,771 @@
+/**
+ *  \file extsort.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the external sort.
+ *
+ *  The runs are sorted by the work-stealing pool of the bitonic sort library, and the partitions of the final merge
+ *  by one thread per worker, each with its own loser tree and buffers, so the threads of the merge never synchronize
+ *  with each other. Each merge thread hands its full output blocks to its own writer thread, and merges the next
+ *  block into a second buffer while the previous one is written.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "bitonic.h"
+#include "arrfile.h"
+#include "extsort.h"
+
+/** \brief Sorted run of the temporary file */
+typedef struct {
+    uint64_t offset;
+    uint64_t count;
+} ext_run_t;
+
+/** \brief State of an external sort */
+typedef struct {
+    const kernel_ops_t *ops;
+    int direction;
+    int tmp_fd;
+    int out_fd;
+    size_t out_header_size;
+    ext_run_t *runs;
+    int n_runs;
+    char *samples;
+    int n_samples;
+    int n_parts;
+    uint64_t *bounds;
+    size_t block_bytes;
+} ext_sort_t;
+
+/** \brief Writer thread of the output blocks of a partition */
+typedef struct {
+    int out_fd;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    const char *block;
+    size_t bytes;
+    off_t offset;
+    int stop;
+    int status;
+} ext_writer_t;
+
+/** \brief Partition of the final merge, merged by a thread */
+typedef struct {
+    ext_sort_t *ext;
+    ext_writer_t writer;
+    int index;
+    int status;
+    int sorted;
+    uint64_t count;
+    char first[sizeof(record_t)];
+    char last[sizeof(record_t)];
+} ext_part_t;
+
+/** \brief Read cursor of the merge on the partition of a run */
+typedef struct {
+    char *buf;
+    uint64_t next;
+    uint64_t end;
+} ext_cursor_t;
+
+/**
+ *  \brief Gets the current time.
+ *
+ *  \return time in seconds
+ */
+static double get_time(void) {
+    struct timespec t;
+    if (clock_gettime(CLOCK_MONOTONIC, &t) != 0) {
+        fprintf(stderr, "[TIME] Could not get the time\n");
+        exit(EXIT_FAILURE);
+    }
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ *  \brief Checks if an element goes before another one in the order of the sort.
+ *
+ *  \param ext state of the sort
+ *  \param a first element
+ *  \param b second element
+ *
+ *  \return 1 if a goes strictly before b, 0 otherwise
+ */
+static inline int before(const ext_sort_t *ext, const void *a, const void *b) {
+    return ext->direction == ASCENDING ? ext->ops->less(a, b) : ext->ops->less(b, a);
+}
+
+/**
+ *  \brief Sorts a run in memory with the bitonic sort library.
+ *
+ *  The bitonic sort only sorts powers of 2, so a run of another size (the last one) is sorted as one run per bit of
+ *  its size, in a single batch.
+ *
+ *  \param ext state of the sort
+ *  \param pool pointer to the pool of worker threads
+ *  \param buf run
+ *  \param count number of elements of the run
+ *  \param offset index of the run in the temporary file
+ *  \param elem_type type of the elements (ELEM_* of const.h)
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return EXIT_SUCCESS if the run was sorted and recorded, EXIT_FAILURE otherwise
+ */
+static int sort_run(ext_sort_t *ext, bitonic_pool_t *pool, char *buf, int count, uint64_t offset, int elem_type,
+                    int algorithm) {
+    size_t elem_size = ext->ops->elem_size;
+    void *arrs[32];
+    int sizes[32];
+    int n_pieces = 0;
+    if (algorithm == ALGORITHM_BITONIC) {
+        int start = 0;
+        for (int bit = 30; bit >= 0; bit--) {
+            if (count & (1 << bit)) {
+                arrs[n_pieces] = buf + (size_t) start * elem_size;
+                sizes[n_pieces++] = 1 << bit;
+                start += 1 << bit;
+            }
+        }
+    } else {
+        arrs[n_pieces] = buf;
+        sizes[n_pieces++] = count;
+    }
+    bitonic_handle_t *handle = algorithm == ALGORITHM_BITONIC
+                               ? bitonic_submit_batch(pool, arrs, sizes, n_pieces, elem_type, ext->direction)
+                               : bitonic_submit_algorithm(pool, buf, count, elem_type, algorithm, ext->direction);
+    if (handle == NULL) {
+        return EXIT_FAILURE;
+    }
+    bitonic_wait(handle);
+
+    // record the runs and their samples
+    ext_run_t *runs = (ext_run_t *) realloc(ext->runs, (ext->n_runs + n_pieces) * sizeof(ext_run_t));
+    char *samples = (char *) realloc(ext->samples,
+                                     (size_t) (ext->n_samples + n_pieces * EXT_SAMPLES_PER_RUN) * elem_size);
+    if (runs != NULL) ext->runs = runs;
+    if (samples != NULL) ext->samples = samples;
+    if (runs == NULL || samples == NULL) {
+        fprintf(stderr, "[EXT] Could not allocate memory for the runs\n");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < n_pieces; i++) {
+        ext->runs[ext->n_runs++] = (ext_run_t) {offset + (uint64_t) ((char *) arrs[i] - buf) / elem_size,
+                                                (uint64_t) sizes[i]};
+        int n_samples = sizes[i] < EXT_SAMPLES_PER_RUN ? sizes[i] : EXT_SAMPLES_PER_RUN;
+        for (int j = 0; j < n_samples; j++) {
+            size_t index = (size_t) j * sizes[i] / n_samples;
+            memcpy(ext->samples + (size_t) ext->n_samples++ * elem_size, (char *) arrs[i] + index * elem_size,
+                   elem_size);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Reads the input file in runs, sorts them and writes them to the temporary file.
+ *
+ *  \param ext state of the sort
+ *  \param pool pointer to the pool of worker threads
+ *  \param in_fd file descriptor of the input file
+ *  \param header header of the input file
+ *  \param run_elems maximum number of elements of a run
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return EXIT_SUCCESS if the runs were written, EXIT_FAILURE otherwise
+ */
+static int make_runs(ext_sort_t *ext, bitonic_pool_t *pool, int in_fd, const array_header_t *header, int run_elems,
+                     int algorithm) {
+    size_t elem_size = ext->ops->elem_size;
+    char *buf = (char *) malloc((size_t) run_elems * elem_size);
+    if (buf == NULL) {
+        fprintf(stderr, "[EXT] Could not allocate memory for the runs\n");
+        return EXIT_FAILURE;
+    }
+    bitonic_prefault(pool, buf, run_elems, header->elem_type);
+    int status = EXIT_SUCCESS;
+    for (uint64_t done = 0; status == EXIT_SUCCESS && done < header->count; done += run_elems) {
+        int count = header->count - done < (uint64_t) run_elems ? (int) (header->count - done) : run_elems;
+        size_t bytes = (size_t) count * elem_size;
+        if (pread_fully(in_fd, buf, bytes, (off_t) (header->size + done * elem_size)) != EXIT_SUCCESS) {
+            fprintf(stderr, "[EXT] Could not read the input file\n");
+            status = EXIT_FAILURE;
+        } else if (sort_run(ext, pool, buf, count, done, header->elem_type, algorithm) != EXIT_SUCCESS) {
+            status = EXIT_FAILURE;
+        } else if (pwrite_fully(ext->tmp_fd, buf, bytes, (off_t) (done * elem_size)) != EXIT_SUCCESS) {
+            fprintf(stderr, "[EXT] Could not write the temporary file\n");
+            status = EXIT_FAILURE;
+        }
+    }
+    free(buf);
+    return status;
+}
+
+/**
+ *  \brief Finds the number of elements of a run that go before a splitter, by a binary search on the temporary file.
+ *
+ *  \param ext state of the sort
+ *  \param run run
+ *  \param splitter splitter
+ *  \param low lower bound of the result
+ *
+ *  \return number of elements of the run that go strictly before the splitter, UINT64_MAX if the file can't be read
+ */
+static uint64_t find_bound(ext_sort_t *ext, const ext_run_t *run, const void *splitter, uint64_t low) {
+    size_t elem_size = ext->ops->elem_size;
+    uint64_t high = run->count;
+    char elem[sizeof(record_t)];
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (pread_fully(ext->tmp_fd, elem, elem_size, (off_t) ((run->offset + mid) * elem_size)) != EXIT_SUCCESS) {
+            return UINT64_MAX;
+        }
+        if (before(ext, elem, splitter)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ *  \brief Splits the final merge into partitions of about the same size.
+ *
+ *  The samples of the runs are sorted, and n_parts - 1 of them, evenly spaced, become the splitters. Partition j of a
+ *  run holds its elements between splitters j - 1 and j, so the partitions of all the runs are merged independently
+ *  and written one after another.
+ *
+ *  \param ext state of the sort
+ *
+ *  \return EXIT_SUCCESS if the partitions were found, EXIT_FAILURE otherwise
+ */
+static int split_partitions(ext_sort_t *ext) {
+    size_t elem_size = ext->ops->elem_size;
+    int k = ext->n_runs;
+    ext->bounds = (uint64_t *) calloc((size_t) (ext->n_parts + 1) * k, sizeof(uint64_t));
+    if (ext->bounds == NULL) {
+        fprintf(stderr, "[EXT] Could not allocate memory for the partitions\n");
+        return EXIT_FAILURE;
+    }
+    ext->ops->sort(ext->samples, 0, ext->n_samples, ext->direction);
+    for (int r = 0; r < k; r++) {
+        ext->bounds[(size_t) ext->n_parts * k + r] = ext->runs[r].count;
+    }
+    for (int j = 1; j < ext->n_parts; j++) {
+        const char *splitter = ext->samples + (size_t) j * ext->n_samples / ext->n_parts * elem_size;
+        for (int r = 0; r < k; r++) {
+            uint64_t bound = find_bound(ext, &ext->runs[r], splitter, ext->bounds[(size_t) (j - 1) * k + r]);
+            if (bound == UINT64_MAX) {
+                fprintf(stderr, "[EXT] Could not read the temporary file\n");
+                return EXIT_FAILURE;
+            }
+            ext->bounds[(size_t) j * k + r] = bound;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Reads the next block of the partition of a run into the buffer of its cursor.
+ *
+ *  The kernel is asked to read the following block ahead (readahead), so that it is in the page cache by the time
+ *  this one is merged.
+ *
+ *  \param ext state of the sort
+ *  \param cursor cursor of the run
+ *  \param head set to the first element of the block
+ *  \param end set to the end of the block
+ *
+ *  \return EXIT_SUCCESS if the block was read, EXIT_FAILURE otherwise
+ */
+static int fill_cursor(ext_sort_t *ext, ext_cursor_t *cursor, const void **head, const void **end) {
+    size_t elem_size = ext->ops->elem_size;
+    uint64_t block = ext->block_bytes / elem_size;
+    uint64_t n = cursor->end - cursor->next < block ? cursor->end - cursor->next : block;
+    if (pread_fully(ext->tmp_fd, cursor->buf, n * elem_size, (off_t) (cursor->next * elem_size)) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    cursor->next += n;
+    *head = cursor->buf;
+    *end = cursor->buf + n * elem_size;
+    if (cursor->next < cursor->end) {
+        posix_fadvise(ext->tmp_fd, (off_t) (cursor->next * elem_size), (off_t) ext->block_bytes, POSIX_FADV_WILLNEED);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Checks if the head of a run goes before the head of another one in the loser tree.
+ *
+ *  An exhausted run goes after every other one.
+ *
+ *  \param ext state of the sort
+ *  \param heads next element of each run
+ *  \param ends end of the block of each run
+ *  \param a first run
+ *  \param b second run
+ *
+ *  \return 1 if run a wins, 0 if run b wins
+ */
+static inline int wins(const ext_sort_t *ext, const void **heads, const void **ends, int a, int b) {
+    if (heads[a] == ends[a]) return 0;
+    if (heads[b] == ends[b]) return 1;
+    return before(ext, heads[a], heads[b]);
+}
+
+/**
+ *  \brief Plays the matches of a subtree of the loser tree, storing the loser of each match in its node.
+ *
+ *  The k runs are the leaves k to 2k - 1 of an implicit tree whose internal nodes are 1 to k - 1. The tree is only
+ *  built this way, the matches of the merge are replayed by the loser_merge kernel of the element type.
+ *
+ *  \param ext state of the sort
+ *  \param heads next element of each run
+ *  \param ends end of the block of each run
+ *  \param tree losers of the internal nodes
+ *  \param k number of runs
+ *  \param node root of the subtree
+ *
+ *  \return winner of the subtree
+ */
+static int play(const ext_sort_t *ext, const void **heads, const void **ends, int *tree, int k, // NOLINT(*-no-recursion)
+                int node) {
+    if (node >= k) {
+        return node - k;
+    }
+    int a = play(ext, heads, ends, tree, k, 2 * node);
+    int b = play(ext, heads, ends, tree, k, 2 * node + 1);
+    if (wins(ext, heads, ends, a, b)) {
+        tree[node] = b;
+        return a;
+    }
+    tree[node] = a;
+    return b;
+}
+
+/**
+ *  \brief Writes the output blocks of a partition as the merge thread hands them over, one at a time.
+ *
+ *  \param arg pointer to the writer
+ *
+ *  \return NULL
+ */
+static void *write_blocks(void *arg) {
+    ext_writer_t *writer = (ext_writer_t *) arg;
+    pthread_mutex_lock(&writer->mutex);
+    for (;;) {
+        while (writer->block == NULL && !writer->stop) {
+            pthread_cond_wait(&writer->changed, &writer->mutex);
+        }
+        if (writer->block == NULL) {
+            break;
+        }
+        const char *block = writer->block;
+        size_t bytes = writer->bytes;
+        off_t offset = writer->offset;
+        pthread_mutex_unlock(&writer->mutex);
+        int status = pwrite_fully(writer->out_fd, block, bytes, offset);
+        pthread_mutex_lock(&writer->mutex);
+        writer->status |= status;
+        writer->block = NULL;
+        pthread_cond_broadcast(&writer->changed);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+    return NULL;
+}
+
+/**
+ *  \brief Hands a block over to the writer thread, once the previous one is written.
+ *
+ *  When this returns, the buffer of the previous block may be reused.
+ *
+ *  \param writer writer
+ *  \param block block (left untouched until the next block is handed over)
+ *  \param bytes number of bytes of the block
+ *  \param offset offset of the block in the output file
+ */
+static void submit_block(ext_writer_t *writer, const char *block, size_t bytes, off_t offset) {
+    pthread_mutex_lock(&writer->mutex);
+    while (writer->block != NULL) {
+        pthread_cond_wait(&writer->changed, &writer->mutex);
+    }
+    writer->block = block;
+    writer->bytes = bytes;
+    writer->offset = offset;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+/**
+ *  \brief Checks a block of the output of a partition and hands it over to the writer thread.
+ *
+ *  \param part partition
+ *  \param out block
+ *  \param n number of elements of the block
+ *  \param out_index index of the block in the output
+ */
+static void flush_output(ext_part_t *part, const char *out, int n, uint64_t out_index) {
+    ext_sort_t *ext = part->ext;
+    size_t elem_size = ext->ops->elem_size;
+    if (n == 0) {
+        return;
+    }
+    if (ext->ops->check(out, n, ext->direction) != -1 || (part->count > 0 && before(ext, out, part->last))) {
+        part->sorted = 0;
+    }
+    if (part->count == 0) {
+        memcpy(part->first, out, elem_size);
+    }
+    memcpy(part->last, out + (size_t) (n - 1) * elem_size, elem_size);
+    part->count += n;
+    submit_block(&part->writer, out, (size_t) n * elem_size, (off_t) (ext->out_header_size + out_index * elem_size));
+}
+
+/**
+ *  \brief Merges a partition of every run into its region of the output file.
+ *
+ *  The output is merged into two buffers in turn: a full one is handed over to the writer thread of the partition,
+ *  and the merge goes on in the other one while it is written.
+ *
+ *  \param arg pointer to the partition
+ *
+ *  \return NULL
+ */
+static void *merge_partition(void *arg) {
+    ext_part_t *part = (ext_part_t *) arg;
+    ext_sort_t *ext = part->ext;
+    int k = ext->n_runs;
+    int out_cap = (int) (ext->block_bytes / ext->ops->elem_size);
+    ext_cursor_t *cursors = (ext_cursor_t *) calloc(k, sizeof(ext_cursor_t));
+    const void **heads = (const void **) calloc(k, sizeof(void *));
+    const void **ends = (const void **) calloc(k, sizeof(void *));
+    int *tree = (int *) malloc(k * sizeof(int));
+    char *bufs = (char *) malloc((size_t) (k + 2) * ext->block_bytes);
+    ext_writer_t *writer = &part->writer;
+    *writer = (ext_writer_t) {.out_fd = ext->out_fd};
+    pthread_t writer_thread;
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    if (cursors == NULL || heads == NULL || ends == NULL || tree == NULL || bufs == NULL) {
+        fprintf(stderr, "[EXT] Could not allocate memory for the merge buffers\n");
+        part->status = EXIT_FAILURE;
+    } else if (pthread_create(&writer_thread, NULL, write_blocks, writer) != 0) {
+        fprintf(stderr, "[EXT] Could not create the writer thread of partition %d\n", part->index);
+        exit(EXIT_FAILURE);
+    } else {
+        char *outs[2] = {bufs + (size_t) k * ext->block_bytes, bufs + (size_t) (k + 1) * ext->block_bytes};
+        int current = 0;
+
+        // the partition starts after the previous partitions of every run
+        uint64_t out_index = 0;
+        part->status = EXIT_SUCCESS;
+        for (int r = 0; r < k; r++) {
+            uint64_t start = ext->bounds[(size_t) part->index * k + r];
+            out_index += start;
+            cursors[r].buf = bufs + (size_t) r * ext->block_bytes;
+            cursors[r].next = ext->runs[r].offset + start;
+            cursors[r].end = ext->runs[r].offset + ext->bounds[(size_t) (part->index + 1) * k + r];
+            if (cursors[r].next < cursors[r].end
+                && fill_cursor(ext, &cursors[r], &heads[r], &ends[r]) != EXIT_SUCCESS) {
+                part->status = EXIT_FAILURE;
+            }
+        }
+
+        // the kernel merges until the output buffer is full or the block of a run runs out, which is then refilled
+        int winner = play(ext, heads, ends, tree, k, 1);
+        int n_out = 0;
+        while (part->status == EXIT_SUCCESS && winner != -1) {
+            winner = ext->ops->loser_merge(heads, ends, tree, k, winner, outs[current], &n_out, out_cap,
+                                           ext->direction);
+            if (n_out == out_cap) {
+                flush_output(part, outs[current], n_out, out_index);
+                out_index += n_out;
+                n_out = 0;
+                current = 1 - current;
+            }
+            if (winner != -1 && heads[winner] == ends[winner] && cursors[winner].next < cursors[winner].end
+                && fill_cursor(ext, &cursors[winner], &heads[winner], &ends[winner]) != EXIT_SUCCESS) {
+                part->status = EXIT_FAILURE;
+            }
+        }
+        if (part->status == EXIT_SUCCESS) {
+            flush_output(part, outs[current], n_out, out_index);
+        }
+
+        // wait for the last block to be written
+        pthread_mutex_lock(&writer->mutex);
+        while (writer->block != NULL) {
+            pthread_cond_wait(&writer->changed, &writer->mutex);
+        }
+        writer->stop = 1;
+        pthread_cond_broadcast(&writer->changed);
+        pthread_mutex_unlock(&writer->mutex);
+        if (pthread_join(writer_thread, NULL) != 0) {
+            fprintf(stderr, "[EXT] Could not join the writer thread of partition %d\n", part->index);
+            exit(EXIT_FAILURE);
+        }
+        part->status |= writer->status;
+        if (part->status != EXIT_SUCCESS) {
+            fprintf(stderr, "[EXT] Could not merge partition %d\n", part->index);
+        }
+    }
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->changed);
+    free(cursors);
+    free(heads);
+    free(ends);
+    free(tree);
+    free(bufs);
+    return NULL;
+}
+
+/**
+ *  \brief Merges the runs into the output file, one partition per thread.
+ *
+ *  \param ext state of the sort
+ *
+ *  \return EXIT_SUCCESS if the output is sorted and was written, EXIT_FAILURE otherwise
+ */
+static int merge_runs(ext_sort_t *ext) {
+    if (split_partitions(ext) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    ext_part_t *parts = (ext_part_t *) calloc(ext->n_parts, sizeof(ext_part_t));
+    pthread_t *threads = (pthread_t *) malloc(ext->n_parts * sizeof(pthread_t));
+    if (parts == NULL || threads == NULL) {
+        fprintf(stderr, "[EXT] Could not allocate memory for the merge threads\n");
+        free(parts);
+        free(threads);
+        return EXIT_FAILURE;
+    }
+    for (int j = 0; j < ext->n_parts; j++) {
+        parts[j] = (ext_part_t) {.ext = ext, .index = j, .sorted = 1};
+        if (pthread_create(&threads[j], NULL, merge_partition, &parts[j]) != 0) {
+            fprintf(stderr, "[EXT] Could not create merge thread %d\n", j);
+            exit(EXIT_FAILURE);
+        }
+    }
+    int status = EXIT_SUCCESS;
+    int sorted = 1;
+    const ext_part_t *previous = NULL;
+    for (int j = 0; j < ext->n_parts; j++) {
+        if (pthread_join(threads[j], NULL) != 0) {
+            fprintf(stderr, "[EXT] Could not join merge thread %d\n", j);
+            exit(EXIT_FAILURE);
+        }
+        status |= parts[j].status;
+        sorted &= parts[j].sorted;
+        if (parts[j].count > 0) {
+            // the partitions must also be in order with each other
+            if (previous != NULL && before(ext, parts[j].first, previous->last)) {
+                sorted = 0;
+            }
+            previous = &parts[j];
+        }
+    }
+    free(parts);
+    free(threads);
+    if (status != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    if (!sorted) {
+        fprintf(stderr, "[MAIN] The output file is not sorted\n");
+        return EXIT_FAILURE;
+    }
+    printf("[MAIN] The array is sorted, everything is OK! :)\n");
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Computes the number of elements of the runs.
+ *
+ *  The largest power of 2 (so the bitonic sort sorts full runs) whose run and auxiliary memory fit in the budget, and
+ *  no larger than the input needs.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header header of the input file
+ *  \param budget number of bytes of memory the sort may use
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return number of elements of the runs, 0 if not even a run of 1 element fits
+ */
+static int run_size(bitonic_pool_t *pool, const array_header_t *header, size_t budget, int algorithm) {
+    size_t elem_size = kernel_ops(header->elem_type)->elem_size;
+    int run_elems = 1 << 30;
+    while (run_elems > 1 && (uint64_t) run_elems / 2 >= header->count) {
+        run_elems /= 2;
+    }
+    while (run_elems > 0 && (size_t) run_elems * elem_size
+                            + bitonic_aux_memory(pool, run_elems, header->elem_type, algorithm) > budget) {
+        run_elems /= 2;
+    }
+    return run_elems;
+}
+
+/**
+ *  \brief Computes the number of runs of the temporary file.
+ *
+ *  \param count number of elements of the input file
+ *  \param run_elems maximum number of elements of a run
+ *  \param algorithm ALGORITHM_* of const.h
+ *
+ *  \return number of runs (the last run is split into one run per bit of its size by the bitonic sort)
+ */
+static uint64_t run_count(uint64_t count, int run_elems, int algorithm) {
+    uint64_t rest = count % (uint64_t) run_elems;
+    return count / (uint64_t) run_elems + (algorithm == ALGORITHM_BITONIC ? (uint64_t) __builtin_popcountll(rest)
+                                                                          : rest > 0);
+}
+
+/**
+ *  \brief Sorts a file of elements into another file, within a memory budget.
+ *
+ *  Lifecycle:
+ *  - read the header of the input file and create the output and temporary files
+ *  - create a pool of worker threads and sort the runs (make_runs)
+ *  - split the merge into partitions and merge each one in its own thread (merge_runs)
+ *
+ *  \param in_path path to the input file
+ *  \param out_path path to the output file
+ *  \param budget number of bytes of memory the sort may use
+ *  \param n_workers number of worker threads
+ *  \param algorithm ALGORITHM_* of const.h that sorts the runs
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return EXIT_SUCCESS if the file was sorted, EXIT_FAILURE otherwise
+ */
+int external_sort(const char *in_path, const char *out_path, size_t budget, int n_workers, int algorithm,
+                  int direction) {
+    double start_time = get_time();
+
+    // read the header of the input file
+    int in_fd = open(in_path, O_RDONLY);
+    struct stat st;
+    array_header_t header;
+    if (in_fd == -1 || fstat(in_fd, &st) == -1 || read_array_header(in_fd, &header) != EXIT_SUCCESS) {
+        fprintf(stderr, "[EXT] Could not read the header of file %s\n", in_path);
+        if (in_fd != -1) close(in_fd);
+        return EXIT_FAILURE;
+    }
+    ext_sort_t ext = {.ops = kernel_ops(header.elem_type), .direction = direction, .tmp_fd = -1,
+                      .out_header_size = header.size};
+    if (ext.ops == NULL || header.elem_type >= N_ELEM_TYPES) {
+        fprintf(stderr, "[EXT] Unknown element type %d\n", header.elem_type);
+        close(in_fd);
+        return EXIT_FAILURE;
+    }
+    size_t elem_size = ext.ops->elem_size;
+    if ((uint64_t) st.st_size < header.size + header.count * elem_size) {
+        fprintf(stderr, "[EXT] The file is smaller than the size of the array\n");
+        close(in_fd);
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "[EXT] Array size: %llu\n", (unsigned long long) header.count);
+    fprintf(stdout, "[EXT] Element type: %s\n", ext.ops->name);
+    fprintf(stdout, "[EXT] Memory budget: %.1f MiB\n", budget / (1024.0 * 1024.0));
+
+    // create the output file, and the temporary file of the runs next to it (removed when closed); the output file is
+    // only truncated once it is known not to be the input file, which is read afterwards
+    ext.out_fd = open(out_path, O_WRONLY | O_CREAT, 0644);
+    if (ext.out_fd != -1 && same_file(in_fd, ext.out_fd)) {
+        fprintf(stderr, "[EXT] The output file %s is the input file\n", out_path);
+        close(ext.out_fd);
+        close(in_fd);
+        return EXIT_FAILURE;
+    }
+    size_t tmp_path_size = strlen(out_path) + sizeof(".runs.XXXXXX");
+    char *tmp_path = (char *) malloc(tmp_path_size);
+    if (tmp_path != NULL) {
+        snprintf(tmp_path, tmp_path_size, "%s.runs.XXXXXX", out_path);
+        ext.tmp_fd = mkstemp(tmp_path);
+        if (ext.tmp_fd != -1) unlink(tmp_path);
+        free(tmp_path);
+    }
+    if (ext.out_fd == -1 || ext.tmp_fd == -1 || ftruncate(ext.out_fd, 0) != 0
+        || write_array_header(ext.out_fd, &header) != EXIT_SUCCESS
+        || ftruncate(ext.out_fd, (off_t) (header.size + header.count * elem_size)) != 0) {
+        fprintf(stderr, "[EXT] Could not create the output file %s\n", out_path);
+        if (ext.out_fd != -1) close(ext.out_fd);
+        if (ext.tmp_fd != -1) close(ext.tmp_fd);
+        close(in_fd);
+        return EXIT_FAILURE;
+    }
+
+    bitonic_pool_t *pool = bitonic_pool_create(n_workers);
+    int status = pool != NULL ? EXIT_SUCCESS : EXIT_FAILURE;
+    int run_elems = pool != NULL ? run_size(pool, &header, budget, algorithm) : 0;
+    if (pool != NULL && run_elems == 0) {
+        fprintf(stderr, "[EXT] The memory budget is too small\n");
+        status = EXIT_FAILURE;
+    }
+    // the merge needs a read buffer per run and two write buffers of at least EXT_MIN_BLOCK bytes each
+    uint64_t n_blocks = run_elems > 0 ? run_count(header.count, run_elems, algorithm) + 2 : 0;
+    if (run_elems > 0 && n_blocks * EXT_MIN_BLOCK > budget) {
+        fprintf(stderr, "[EXT] The memory budget is too small to merge %llu runs (%.1f MiB needed)\n",
+                (unsigned long long) (n_blocks - 2), n_blocks * EXT_MIN_BLOCK / (1024.0 * 1024.0));
+        status = EXIT_FAILURE;
+    }
+
+    // sort the runs
+    if (status == EXIT_SUCCESS) {
+        status = make_runs(&ext, pool, in_fd, &header, run_elems, algorithm);
+    }
+    if (pool != NULL) {
+        bitonic_pool_destroy(pool);
+    }
+    close(in_fd);
+    double merge_time = get_time();
+    if (status == EXIT_SUCCESS) {
+        fprintf(stdout, "[EXT] Runs: %d (up to %d elements each)\n", ext.n_runs, run_elems);
+        fprintf(stdout, "[TIME] Run time: %.9f seconds\n", merge_time - start_time);
+    }
+
+    // merge the runs, with the budget split into a read buffer per run and two write buffers per thread; threads are
+    // dropped until the buffers fit in the budget with at least EXT_MIN_BLOCK bytes each (which one thread does)
+    if (status == EXIT_SUCCESS && ext.n_runs > 0) {
+        ext.n_parts = n_workers < ext.n_samples ? n_workers : ext.n_samples;
+        while (ext.n_parts > 1 && budget / (ext.n_parts * n_blocks) < EXT_MIN_BLOCK) {
+            ext.n_parts--;
+        }
+        size_t block = budget / (ext.n_parts * n_blocks);
+        block = block > EXT_MAX_BLOCK ? EXT_MAX_BLOCK : block;
+        ext.block_bytes = block / elem_size * elem_size;
+        fprintf(stdout, "[EXT] Merge threads: %d\n", ext.n_parts);
+        fprintf(stdout, "[EXT] Merge buffers: %zu KiB\n", ext.block_bytes / 1024);
+        status = merge_runs(&ext);
+    } else if (status == EXIT_SUCCESS) {
+        printf("[MAIN] The array is sorted, everything is OK! :)\n");
+    }
+    if (close(ext.out_fd) != 0 && status == EXIT_SUCCESS) {
+        fprintf(stderr, "[EXT] Could not write the output file %s\n", out_path);
+        status = EXIT_FAILURE;
+    }
+    close(ext.tmp_fd);
+    free(ext.runs);
+    free(ext.samples);
+    free(ext.bounds);
+
+    double end_time = get_time();
+    if (status == EXIT_SUCCESS) {
+        fprintf(stdout, "[TIME] Merge time: %.9f seconds\n", end_time - merge_time);
+        fprintf(stdout, "[TIME] Time elapsed: %.9f seconds\n", end_time - start_time);
+        fprintf(stdout, "[TIME] Time per element: %.3f ns\n",
+                header.count > 0 ? 1.0e9 * (end_time - start_time) / header.count : 0.0);
+    }
+    return status;
+}
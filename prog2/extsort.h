@@ -0,0 +1,42 @@
+/**
+ *  \file extsort.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the external sort, for files larger than the memory.
+ *
+ *  The sort has two phases:
+ *  - runs: the file is read in runs that fit in a memory budget, each run is sorted in memory by the bitonic sort
+ *    library and written to a temporary file
+ *  - merge: the output is split into one partition per worker thread by splitters sampled from the runs, and each
+ *    thread merges its partition of every run with a loser tree, through large read and write buffers, and its writer
+ *    thread writes the full write buffers to the region of the partition in the output file
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stddef.h>
+
+/**
+ *  \brief Sorts a file of elements into another file, within a memory budget.
+ *
+ *  The output file has the same header format as the input file. The temporary file of the runs is created next to
+ *  the output file and removed when the sort ends.
+ *
+ *  \param in_path path to the input file
+ *  \param out_path path to the output file
+ *  \param budget number of bytes of memory the sort may use
+ *  \param n_workers number of worker threads
+ *  \param algorithm ALGORITHM_* of const.h that sorts the runs
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return EXIT_SUCCESS if the file was sorted, EXIT_FAILURE otherwise
+ */
+int external_sort(const char *in_path, const char *out_path, size_t budget, int n_workers, int algorithm,
+                  int direction);
+
+#endif /* EXTSORT_H */
@@ -0,0 +1,275 @@
+/**
+ *  \file genData.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains a generator of input files with a typed header (TYPED_FILE_MAGIC, element type, number of
+ *  elements), followed by elements of the type drawn from a distribution.
+ *
+ *  Distributions:
+ *  - random: random bit patterns, so the float and double files also contain infinities, NaNs of both signs,
+ *    subnormals and both zeros
+ *  - sorted: the keys 0, 1, 2, ... in ascending order
+ *  - reverse: the keys in descending order
+ *  - few: random keys among GEN_FEW_UNIQUE values
+ *  - organpipe: the keys ascend up to the middle of the array and descend after it
+ *  - zipf: random ranks 1..n of a Zipf-like distribution with exponent 1 (rank 1 is the most frequent one)
+ *
+ *  The keys of the other distributions are integers, converted to the element type. The records get the key and their
+ *  index as row id.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "const.h"
+#include "kernels.h"
+
+/** \brief Number of elements written to the file at a time */
+#define GEN_CHUNK_SIZE (1 << 16)
+
+/** \brief Number of distinct keys of the few-unique distribution */
+#define GEN_FEW_UNIQUE 16
+
+/** \brief Distribution: random bit patterns */
+#define DIST_RANDOM 0
+
+/** \brief Distribution: ascending keys */
+#define DIST_SORTED 1
+
+/** \brief Distribution: descending keys */
+#define DIST_REVERSE 2
+
+/** \brief Distribution: few unique keys */
+#define DIST_FEW 3
+
+/** \brief Distribution: ascending then descending keys */
+#define DIST_ORGANPIPE 4
+
+/** \brief Distribution: Zipf-like ranks */
+#define DIST_ZIPF 5
+
+/** \brief Names of the distributions, indexed by DIST_* */
+static const char *distribution_names[] = {"random", "sorted", "reverse", "few", "organpipe", "zipf"};
+
+/**
+ *  \brief Prints the usage of the program.
+ *
+ *  \param cmd_name name of the command that started the program
+ */
+static void print_usage(char *cmd_name) {
+    fprintf(stderr, "Usage: %s REQUIRED OPTIONS\n"
+                    "REQUIRED:\n"
+                    "-o --- output file\n"
+                    "-n --- number of elements (power of 2)\n"
+                    "OPTIONS:\n"
+                    "-h --- print this help\n"
+                    "-t --- element type: int32 (default), int64, uint32, float, double or record\n"
+                    "-d --- distribution: random (default), sorted, reverse, few, organpipe or zipf\n"
+                    "-s --- seed of the pseudo-random generator (default is 1)\n", cmd_name);
+}
+
+/**
+ *  \brief Generates the next pseudo-random number (splitmix64).
+ *
+ *  \param state state of the generator
+ *
+ *  \return pseudo-random 64-bit number
+ */
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ *  \brief Generates the key of an element for the distributions other than random.
+ *
+ *  \param distribution DIST_* of the keys
+ *  \param index index of the element
+ *  \param count number of elements
+ *  \param state state of the generator
+ *
+ *  \return key of the element
+ */
+static int64_t next_key(int distribution, uint64_t index, uint64_t count, uint64_t *state) {
+    switch (distribution) {
+        case DIST_SORTED:
+            return (int64_t) index;
+        case DIST_REVERSE:
+            return (int64_t) (count - 1 - index);
+        case DIST_FEW:
+            return (int64_t) (next_random(state) % GEN_FEW_UNIQUE);
+        case DIST_ORGANPIPE:
+            return (int64_t) (index < count / 2 ? index : count - 1 - index);
+        default: {
+            // inverse of the continuous approximation of the CDF of the ranks, P(rank <= x) = ln(x) / ln(count)
+            double u = (double) (next_random(state) >> 11) * 0x1.0p-53;
+            uint64_t rank = (uint64_t) pow((double) count, u);
+            return (int64_t) (rank < 1 ? 1 : rank > count ? count : rank);
+        }
+    }
+}
+
+/**
+ *  \brief Stores a key as an element of a type.
+ *
+ *  \param dst where the element will be stored
+ *  \param elem_type type of the element (ELEM_* of const.h)
+ *  \param key key of the element
+ *  \param index index of the element (row id of the records)
+ */
+static void store_key(char *dst, int elem_type, int64_t key, uint64_t index) {
+    switch (elem_type) {
+        case ELEM_INT32: {
+            int32_t value = (int32_t) key;
+            memcpy(dst, &value, sizeof(value));
+            break;
+        }
+        case ELEM_INT64:
+            memcpy(dst, &key, sizeof(key));
+            break;
+        case ELEM_UINT32: {
+            uint32_t value = (uint32_t) key;
+            memcpy(dst, &value, sizeof(value));
+            break;
+        }
+        case ELEM_FLOAT: {
+            float value = (float) key;
+            memcpy(dst, &value, sizeof(value));
+            break;
+        }
+        case ELEM_DOUBLE: {
+            double value = (double) key;
+            memcpy(dst, &value, sizeof(value));
+            break;
+        }
+        default: {
+            record_t record = {key, index};
+            memcpy(dst, &record, sizeof(record));
+            break;
+        }
+    }
+}
+
+/**
+ *  \brief Main function of the program.
+ *
+ *  \param argc number of command line arguments
+ *  \param argv array of command line arguments
+ *
+ *  \return EXIT_SUCCESS if the file was generated, EXIT_FAILURE otherwise
+ */
+int main(int argc, char *argv[]) {
+    char *cmd_name = argv[0];
+    char *file_path = NULL;
+    long long size = -1;
+    int elem_type = ELEM_INT32;
+    int distribution = DIST_RANDOM;
+    uint64_t state = 1;
+
+    // process command line options
+    int opt;
+    while ((opt = getopt(argc, argv, "o:n:t:d:s:h")) != -1) {
+        switch (opt) {
+            case 'o':
+                file_path = optarg;
+                break;
+            case 'n':
+                size = atoll(optarg);
+                break;
+            case 't':
+                elem_type = -1;
+                for (int i = 0; i < N_ELEM_TYPES; i++) {
+                    if (strcmp(optarg, kernel_ops(i)->name) == 0) {
+                        elem_type = i;
+                    }
+                }
+                if (elem_type == -1) {
+                    fprintf(stderr, "[GEN] Invalid element type\n");
+                    print_usage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'd':
+                distribution = -1;
+                for (int i = 0; i < (int) (sizeof(distribution_names) / sizeof(distribution_names[0])); i++) {
+                    if (strcmp(optarg, distribution_names[i]) == 0) {
+                        distribution = i;
+                    }
+                }
+                if (distribution == -1) {
+                    fprintf(stderr, "[GEN] Invalid distribution\n");
+                    print_usage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                state = strtoull(optarg, NULL, 10);
+                break;
+            case 'h':
+                print_usage(cmd_name);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(cmd_name);
+                return EXIT_FAILURE;
+        }
+    }
+    if (file_path == NULL || size < 0 || (size & (size - 1)) != 0) {
+        fprintf(stderr, "[GEN] Output file and a power of 2 number of elements are required\n");
+        print_usage(cmd_name);
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(file_path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "[GEN] Could not open file %s\n", file_path);
+        return EXIT_FAILURE;
+    }
+    uint32_t header[2] = {TYPED_FILE_MAGIC, (uint32_t) elem_type};
+    uint64_t count = (uint64_t) size;
+    int status = fwrite(header, sizeof(header), 1, file) == 1 && fwrite(&count, sizeof(count), 1, file) == 1;
+
+    // write the elements in chunks
+    int elem_size = kernel_ops(elem_type)->elem_size;
+    char *chunk = (char *) malloc((size_t) GEN_CHUNK_SIZE * elem_size);
+    if (chunk == NULL) {
+        fprintf(stderr, "[GEN] Could not allocate memory for the elements\n");
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+    for (uint64_t index = 0; status && index < count; index += GEN_CHUNK_SIZE) {
+        int n = count - index < GEN_CHUNK_SIZE ? (int) (count - index) : GEN_CHUNK_SIZE;
+        for (int i = 0; distribution != DIST_RANDOM && i < n; i++) {
+            store_key(chunk + (size_t) i * elem_size, elem_type, next_key(distribution, index + i, count, &state),
+                      index + i);
+        }
+        for (int i = 0; distribution == DIST_RANDOM && i < n; i++) {
+            uint64_t bits = next_random(&state);
+            if (elem_type == ELEM_RECORD) {
+                record_t record = {(int64_t) bits, index + i};
+                memcpy(chunk + (size_t) i * elem_size, &record, sizeof(record));
+            } else {
+                // little-endian: the low bytes of the random number are the element
+                memcpy(chunk + (size_t) i * elem_size, &bits, elem_size);
+            }
+        }
+        status = fwrite(chunk, elem_size, n, file) == (size_t) n;
+    }
+    free(chunk);
+    if (fclose(file) != 0 || !status) {
+        fprintf(stderr, "[GEN] Could not write file %s\n", file_path);
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "[GEN] %lld elements of type %s (%s) written to %s\n", size, kernel_ops(elem_type)->name,
+            distribution_names[distribution], file_path);
+    return EXIT_SUCCESS;
+}
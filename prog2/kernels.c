@@ -0,0 +1,452 @@
+/**
+ *  \file kernels.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the sequential bitonic sort and merge kernels executed by the worker
+ *  threads.
+ *
+ *  The leaves of the sort and of the merge are in-register sorting networks built on AVX2 min/max and shuffles. A
+ *  block of 8 integers is held in one register: the compare-exchanges between registers are plain min/max, and those
+ *  inside a register pair each lane with a shuffled copy of the register and blend the min/max results. They are only
+ *  compiled for x86 (X86_KERNELS), elsewhere the scalar leaves are always selected.
+ *
+ *  The scalar kernels are instantiated from kernels_template.h for each element type: int32 (with the SIMD leaves),
+ *  int64, records, and uint32, float and double, which sort and merge ranges as order-preserving integer keys.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "kernels.h"
+
+/** \brief Whether the target is x86, whose CPUs may support the AVX2 leaf kernels */
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define X86_KERNELS 0
+#endif
+
+/** \brief Leaf kernel that sorts a block of SIMD_MIN_COUNT to SIMD_MAX_COUNT elements (NULL if not available) */
+static void (*sort_leaf)(int *arr, int count, int direction) = NULL;
+
+/** \brief Leaf kernel that merges a bitonic block of SIMD_MIN_COUNT to SIMD_MAX_COUNT elements (NULL if not available) */
+static void (*merge_leaf)(int *arr, int count, int direction) = NULL;
+
+/** \brief Name of the selected leaf kernels (NULL if init_kernels was not called) */
+static const char *kernels_name = NULL;
+
+#if X86_KERNELS
+
+/**
+ *  \brief Compare-exchanges each lane of a register with the same lane of a shuffled copy of it.
+ *
+ *  \param v register
+ *  \param p shuffled copy of the register
+ *  \param mask lanes that receive the maximum in ascending order (the minimum in descending order)
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+#define AVX2_LANE_CE(v, p, mask, direction) ((direction) == ASCENDING \
+    ? _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), mask) \
+    : _mm256_blend_epi32(_mm256_max_epi32(v, p), _mm256_min_epi32(v, p), mask))
+
+/**
+ *  \brief Merges a bitonic register of 8 integers (strides 4, 2 and 1).
+ *
+ *  \param v register
+ *  \param direction 0 for descending order, 1 for ascending order
+ *  \return merged register
+ */
+__attribute__((target("avx2"), always_inline))
+static inline __m256i avx2_merge8(__m256i v, int direction) {
+    v = AVX2_LANE_CE(v, _mm256_permute2x128_si256(v, v, 0x01), 0xF0, direction);
+    v = AVX2_LANE_CE(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)), 0xCC, direction);
+    v = AVX2_LANE_CE(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)), 0xAA, direction);
+    return v;
+}
+
+/**
+ *  \brief Sorts a register of 8 integers with a bitonic network.
+ *
+ *  The pairs are sorted in alternating directions, then the quadruples (ascending, descending) and finally the whole
+ *  register is merged in the desired order.
+ *
+ *  \param v register
+ *  \param direction 0 for descending order, 1 for ascending order
+ *  \return sorted register
+ */
+__attribute__((target("avx2"), always_inline))
+static inline __m256i avx2_sort8(__m256i v, int direction) {
+    __m256i p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0x66);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0x3C);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0x5A);
+    return avx2_merge8(v, direction);
+}
+
+/**
+ *  \brief Merges a bitonic sequence held in n_vectors registers.
+ *
+ *  \param v registers
+ *  \param n_vectors number of registers (1, 2, 4 or 8)
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+__attribute__((target("avx2"), always_inline))
+static inline void avx2_merge_vectors(__m256i *v, int n_vectors, int direction) {
+    for (int stride = n_vectors / 2; stride >= 1; stride /= 2) {
+        for (int i = 0; i < n_vectors; i += 2 * stride) {
+            for (int j = i; j < i + stride; j++) {
+                __m256i lo = _mm256_min_epi32(v[j], v[j + stride]);
+                __m256i hi = _mm256_max_epi32(v[j], v[j + stride]);
+                v[j] = direction == ASCENDING ? lo : hi;
+                v[j + stride] = direction == ASCENDING ? hi : lo;
+            }
+        }
+    }
+    for (int i = 0; i < n_vectors; i++) {
+        v[i] = avx2_merge8(v[i], direction);
+    }
+}
+
+/**
+ *  \brief Sorts a block of 8 * n_vectors integers in registers.
+ *
+ *  \param arr block to be sorted
+ *  \param n_vectors number of registers (1, 2, 4 or 8)
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+__attribute__((target("avx2"), always_inline))
+static inline void avx2_sort_block(int *arr, int n_vectors, int direction) {
+    __m256i v[SIMD_MAX_COUNT / 8];
+    for (int i = 0; i < n_vectors; i++) {
+        v[i] = _mm256_loadu_si256((__m256i *) (arr + 8 * i));
+        // a single register is sorted in the desired order, otherwise in alternating directions
+        v[i] = avx2_sort8(v[i], n_vectors == 1 ? direction : (i % 2 == 0 ? ASCENDING : DESCENDING));
+    }
+    for (int group = 2; group <= n_vectors; group *= 2) {
+        for (int i = 0; i < n_vectors; i += group) {
+            int sub_direction = group == n_vectors ? direction : ((i / group) % 2 == 0 ? ASCENDING : DESCENDING);
+            avx2_merge_vectors(v + i, group, sub_direction);
+        }
+    }
+    for (int i = 0; i < n_vectors; i++) {
+        _mm256_storeu_si256((__m256i *) (arr + 8 * i), v[i]);
+    }
+}
+
+/**
+ *  \brief Merges a bitonic block of 8 * n_vectors integers in registers.
+ *
+ *  \param arr block to be merged
+ *  \param n_vectors number of registers (1, 2, 4 or 8)
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+__attribute__((target("avx2"), always_inline))
+static inline void avx2_merge_block(int *arr, int n_vectors, int direction) {
+    __m256i v[SIMD_MAX_COUNT / 8];
+    for (int i = 0; i < n_vectors; i++) {
+        v[i] = _mm256_loadu_si256((__m256i *) (arr + 8 * i));
+    }
+    avx2_merge_vectors(v, n_vectors, direction);
+    for (int i = 0; i < n_vectors; i++) {
+        _mm256_storeu_si256((__m256i *) (arr + 8 * i), v[i]);
+    }
+}
+
+/**
+ *  \brief Sorts a block of SIMD_MIN_COUNT to SIMD_MAX_COUNT integers (power of 2) with AVX2.
+ *
+ *  \param arr block to be sorted
+ *  \param count number of elements in the block
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+__attribute__((target("avx2")))
+static void avx2_sort_leaf(int *arr, int count, int direction) {
+    // one specialization per size and direction, so that the networks are fully unrolled in registers
+    switch (count * 2 + direction) {
+        case 8 * 2 + ASCENDING: avx2_sort_block(arr, 1, ASCENDING); break;
+        case 8 * 2 + DESCENDING: avx2_sort_block(arr, 1, DESCENDING); break;
+        case 16 * 2 + ASCENDING: avx2_sort_block(arr, 2, ASCENDING); break;
+        case 16 * 2 + DESCENDING: avx2_sort_block(arr, 2, DESCENDING); break;
+        case 32 * 2 + ASCENDING: avx2_sort_block(arr, 4, ASCENDING); break;
+        case 32 * 2 + DESCENDING: avx2_sort_block(arr, 4, DESCENDING); break;
+        case 64 * 2 + ASCENDING: avx2_sort_block(arr, 8, ASCENDING); break;
+        default: avx2_sort_block(arr, 8, DESCENDING); break;
+    }
+}
+
+/**
+ *  \brief Merges a bitonic block of SIMD_MIN_COUNT to SIMD_MAX_COUNT integers (power of 2) with AVX2.
+ *
+ *  \param arr block to be merged
+ *  \param count number of elements in the block
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+__attribute__((target("avx2")))
+static void avx2_merge_leaf(int *arr, int count, int direction) {
+    switch (count * 2 + direction) {
+        case 8 * 2 + ASCENDING: avx2_merge_block(arr, 1, ASCENDING); break;
+        case 8 * 2 + DESCENDING: avx2_merge_block(arr, 1, DESCENDING); break;
+        case 16 * 2 + ASCENDING: avx2_merge_block(arr, 2, ASCENDING); break;
+        case 16 * 2 + DESCENDING: avx2_merge_block(arr, 2, DESCENDING); break;
+        case 32 * 2 + ASCENDING: avx2_merge_block(arr, 4, ASCENDING); break;
+        case 32 * 2 + DESCENDING: avx2_merge_block(arr, 4, DESCENDING); break;
+        case 64 * 2 + ASCENDING: avx2_merge_block(arr, 8, ASCENDING); break;
+        default: avx2_merge_block(arr, 8, DESCENDING); break;
+    }
+}
+
+#endif /* X86_KERNELS */
+
+/**
+ *  \brief Selects the leaf kernels according to the features of the CPU.
+ *
+ *  Should be called by the main thread before any sort or merge.
+ *
+ *  \param use_simd 0 to force the scalar kernels, otherwise the SIMD ones are used when the CPU supports them
+ *  \return name of the selected leaf kernels
+ */
+const char *init_kernels(int use_simd) {
+    sort_leaf = NULL;
+    merge_leaf = NULL;
+    kernels_name = "scalar";
+#if X86_KERNELS
+    __builtin_cpu_init();
+    if (use_simd && __builtin_cpu_supports("avx2")) {
+        sort_leaf = avx2_sort_leaf;
+        merge_leaf = avx2_merge_leaf;
+        kernels_name = "avx2";
+    }
+#else
+    (void) use_simd;
+#endif
+    return kernels_name;
+}
+
+/**
+ *  \brief Gets the name of the selected leaf kernels.
+ *
+ *  \return name of the selected leaf kernels, NULL if init_kernels was not called
+ */
+const char *selected_kernels(void) {
+    return kernels_name;
+}
+
+/** \brief Smaller of two 32-bit integers */
+static inline int32_t min_int32(int32_t a, int32_t b) { return a < b ? a : b; }
+
+/** \brief Larger of two 32-bit integers */
+static inline int32_t max_int32(int32_t a, int32_t b) { return a < b ? b : a; }
+
+/** \brief Smaller of two 64-bit integers */
+static inline int64_t min_int64(int64_t a, int64_t b) { return a < b ? a : b; }
+
+/** \brief Larger of two 64-bit integers */
+static inline int64_t max_int64(int64_t a, int64_t b) { return a < b ? b : a; }
+
+/**
+ *  \brief Maps the bits of a 32-bit unsigned integer to a signed integer with the same order.
+ *
+ *  The mapping flips the sign bit, and is its own inverse.
+ *
+ *  \param bits bits of the unsigned integer
+ *  \return integer key of the unsigned integer
+ */
+static inline int32_t uint32_order(int32_t bits) {
+    return (int32_t) ((uint32_t) bits ^ 0x80000000u);
+}
+
+/**
+ *  \brief Selects one of two records without a data-dependent branch.
+ *
+ *  \param a record selected if the condition holds
+ *  \param b record selected otherwise
+ *  \param condition 1 to select a, 0 to select b
+ *  \return selected record
+ */
+static inline record_t select_record(record_t a, record_t b, int condition) {
+    uint64_t mask = -(uint64_t) condition;
+    return (record_t) {(int64_t) ((uint64_t) b.key ^ (((uint64_t) a.key ^ (uint64_t) b.key) & mask)),
+                       b.row_id ^ ((a.row_id ^ b.row_id) & mask)};
+}
+
+/**
+ *  \brief Compares two records by their key, then by their row id, without a data-dependent branch.
+ *
+ *  \param a first record
+ *  \param b second record
+ *  \return 1 if a is ordered before b, 0 otherwise
+ */
+static inline int pair_less(record_t a, record_t b) {
+    // a single signed 128-bit comparison: key * 2^64 + row id
+    __int128 x = (__int128) ((unsigned __int128) (uint64_t) a.key << 64 | a.row_id);
+    __int128 y = (__int128) ((unsigned __int128) (uint64_t) b.key << 64 | b.row_id);
+    return x < y;
+}
+
+/**
+ *  \brief Maps the bits of a float to a signed integer with the same order as the IEEE 754 total order of floats.
+ *
+ *  Negative floats have their magnitude bits flipped, so that -NaN < -inf < ... < -0 < +0 < ... < +inf < +NaN. The
+ *  mapping is its own inverse, so the float kernels take the min/max of the keys and map it back to a float: the
+ *  compare-exchanges are integer operations, free of branches.
+ *
+ *  \param bits bits of the float
+ *  \return integer key of the float
+ */
+static inline int32_t float_order(int32_t bits) {
+    return bits ^ (int32_t) ((uint32_t) (bits >> 31) >> 1);
+}
+
+/**
+ *  \brief Maps the bits of a double to a signed integer with the same order as the IEEE 754 total order of doubles.
+ *
+ *  \param bits bits of the double
+ *  \return integer key of the double
+ */
+static inline int64_t double_order(int64_t bits) {
+    return bits ^ (int64_t) ((uint64_t) (bits >> 63) >> 1);
+}
+
+/**
+ *  \brief Prints a float from its bits.
+ *
+ *  \param stream stream to print to
+ *  \param bits bits of the float
+ */
+static void print_float_bits(FILE *stream, int32_t bits) {
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    fprintf(stream, "%g", (double) x);
+}
+
+/**
+ *  \brief Prints a double from its bits.
+ *
+ *  \param stream stream to print to
+ *  \param bits bits of the double
+ */
+static void print_double_bits(FILE *stream, int64_t bits) {
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    fprintf(stream, "%g", x);
+}
+
+#define KERNEL_CAT(name, suffix) name ## _ ## suffix
+#define KERNEL_XCAT(name, suffix) KERNEL_CAT(name, suffix)
+#define KERNEL_NAME(name) KERNEL_XCAT(name, KERNEL_SUFFIX)
+
+#define KERNEL_TYPE int
+#define KERNEL_SUFFIX int32
+#define KERNEL_TYPE_NAME "int32"
+#define KERNEL_LESS(a, b) ((a) < (b))
+#define KERNEL_PRINT(stream, x) fprintf(stream, "%d", x)
+#define KERNEL_LEAVES
+#include "kernels_template.h"
+
+#define KERNEL_TYPE int64_t
+#define KERNEL_SUFFIX int64
+#define KERNEL_TYPE_NAME "int64"
+#define KERNEL_LESS(a, b) ((a) < (b))
+#define KERNEL_PRINT(stream, x) fprintf(stream, "%" PRId64, x)
+#include "kernels_template.h"
+
+#define KERNEL_TYPE int32_t
+#define KERNEL_SUFFIX uint32
+#define KERNEL_TYPE_NAME "uint32"
+#define KERNEL_LESS(a, b) (uint32_order(a) < uint32_order(b))
+#define KERNEL_MIN(a, b) uint32_order(min_int32(uint32_order(a), uint32_order(b)))
+#define KERNEL_MAX(a, b) uint32_order(max_int32(uint32_order(a), uint32_order(b)))
+#define KERNEL_PRINT(stream, x) fprintf(stream, "%" PRIu32, (uint32_t) (x))
+#define KERNEL_KEY(x) uint32_order(x)
+#define KERNEL_KEY_OPS ops_int32
+#include "kernels_template.h"
+
+#define KERNEL_TYPE int32_t
+#define KERNEL_SUFFIX float
+#define KERNEL_TYPE_NAME "float"
+#define KERNEL_LESS(a, b) (float_order(a) < float_order(b))
+#define KERNEL_MIN(a, b) float_order(min_int32(float_order(a), float_order(b)))
+#define KERNEL_MAX(a, b) float_order(max_int32(float_order(a), float_order(b)))
+#define KERNEL_PRINT(stream, x) print_float_bits(stream, x)
+#define KERNEL_KEY(x) float_order(x)
+#define KERNEL_KEY_OPS ops_int32
+#include "kernels_template.h"
+
+#define KERNEL_TYPE int64_t
+#define KERNEL_SUFFIX double
+#define KERNEL_TYPE_NAME "double"
+#define KERNEL_LESS(a, b) (double_order(a) < double_order(b))
+#define KERNEL_MIN(a, b) double_order(min_int64(double_order(a), double_order(b)))
+#define KERNEL_MAX(a, b) double_order(max_int64(double_order(a), double_order(b)))
+#define KERNEL_PRINT(stream, x) print_double_bits(stream, x)
+#define KERNEL_KEY(x) double_order(x)
+#define KERNEL_KEY_OPS ops_int64
+#include "kernels_template.h"
+
+#define KERNEL_TYPE record_t
+#define KERNEL_SUFFIX record
+#define KERNEL_TYPE_NAME "record"
+#define KERNEL_LESS(a, b) ((a).key < (b).key)
+#define KERNEL_MIN(a, b) select_record(a, b, (a).key < (b).key)
+#define KERNEL_MAX(a, b) select_record(b, a, (a).key < (b).key)
+#define KERNEL_PRINT(stream, x) fprintf(stream, "(%" PRId64 ", %" PRIu64 ")", (x).key, (x).row_id)
+#include "kernels_template.h"
+
+#define KERNEL_TYPE record_t
+#define KERNEL_SUFFIX pair
+#define KERNEL_TYPE_NAME "pair"
+#define KERNEL_LESS(a, b) pair_less(a, b)
+#define KERNEL_MIN(a, b) select_record(a, b, pair_less(a, b))
+#define KERNEL_MAX(a, b) select_record(b, a, pair_less(a, b))
+#define KERNEL_PRINT(stream, x) fprintf(stream, "(%" PRId64 ", %" PRIu64 ")", (x).key, (x).row_id)
+#include "kernels_template.h"
+
+/**
+ *  \brief Gets the kernels of an element type.
+ *
+ *  \param elem_type element type (ELEM_* of const.h)
+ *  \return pointer to the kernels, NULL if the type is not valid
+ */
+const kernel_ops_t *kernel_ops(int elem_type) {
+    switch (elem_type) {
+        case ELEM_INT32: return &ops_int32;
+        case ELEM_INT64: return &ops_int64;
+        case ELEM_UINT32: return &ops_uint32;
+        case ELEM_FLOAT: return &ops_float;
+        case ELEM_DOUBLE: return &ops_double;
+        case ELEM_RECORD: return &ops_record;
+        case ELEM_PAIR: return &ops_pair;
+        default: return NULL;
+    }
+}
+
+/**
+ *  \brief Faults in the pages of a partition of an array, so that they become private to the process and are
+ *  first-touched by the calling thread.
+ *
+ *  \param arr array whose pages are faulted in
+ *  \param low_index index of the first element of the partition
+ *  \param count number of elements in the partition
+ *  \param elem_size number of bytes of an element
+ */
+void touch_pages(void *arr, int low_index, int count, int elem_size) {
+    volatile char *partition = (char *) arr + (size_t) low_index * elem_size;
+    size_t n_bytes = (size_t) count * elem_size;
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < n_bytes; i += page_size) {
+        partition[i] = partition[i];
+    }
+    if (n_bytes > 0) {
+        partition[n_bytes - 1] = partition[n_bytes - 1];
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ *  \file kernels.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the sequential bitonic sort and merge kernels executed by the worker threads,
+ *  and of the kernel that faults in the pages of the array.
+ *
+ *  The merge is iterative and cache-blocked, and the leaves of both the sort and the merge (blocks of
+ *  SIMD_MIN_COUNT to SIMD_MAX_COUNT elements) are handled by in-register sorting networks when the CPU supports
+ *  AVX2. The kernels are selected at runtime by init_kernels, with a scalar fallback.
+ *
+ *  The kernels are instantiated for each element type (see kernels_template.h) and reached through kernel_ops. The
+ *  SIMD leaves work on 32-bit integers: uint32 and float ranges are mapped to order-preserving int32 keys to use them.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/** \brief Smallest block handled by the SIMD sorting networks */
+#define SIMD_MIN_COUNT 8
+
+/** \brief Largest block handled by the SIMD sorting networks */
+#define SIMD_MAX_COUNT 64
+
+/**
+ *  \brief Selects the leaf kernels according to the features of the CPU.
+ *
+ *  Should be called by the main thread before any sort or merge.
+ *
+ *  \param use_simd 0 to force the scalar kernels, otherwise the SIMD ones are used when the CPU supports them
+ *  \return name of the selected leaf kernels
+ */
+const char *init_kernels(int use_simd);
+
+/**
+ *  \brief Gets the name of the selected leaf kernels.
+ *
+ *  \return name of the selected leaf kernels, NULL if init_kernels was not called
+ */
+const char *selected_kernels(void);
+
+/** \brief Record element: a 64-bit key and the row it belongs to (payload), sorted by key */
+typedef struct {
+    int64_t key;
+    uint64_t row_id;
+} record_t;
+
+/**
+ *  \brief Sequential kernels of an element type.
+ *
+ *  The arrays are untyped (void *) and the indexes are in elements of the type.
+ */
+typedef struct {
+    /** \brief name of the element type */
+    const char *name;
+    /** \brief number of bytes of an element */
+    int elem_size;
+    /** \brief sorts a range of an array of any size (low_index, count, direction) */
+    void (*sort)(void *arr, int low_index, int count, int direction);
+    /** \brief merges the bitonic blocks of 2 * half elements of a range of an array (low_index, count, half,
+     *  direction) */
+    void (*merge_levels)(void *arr, int low_index, int count, int half, int direction);
+    /** \brief performs a slice of one level of a bitonic merge (low_index, count, half, direction) */
+    void (*level_slice)(void *arr, int low_index, int count, int half, int direction);
+    /** \brief performs a slice of two fused levels of a bitonic merge (low_index, count, half, direction) */
+    void (*level_pair_slice)(void *arr, int low_index, int count, int half, int direction);
+    /** \brief classifies the elements of a range into the buckets delimited by a tree of splitters, with equality
+     *  buckets for the repeated splitters (low_index, count, tree, equal, log_buckets, direction, bucket_ids,
+     *  histogram) */
+    void (*classify)(const void *arr, int low_index, int count, const void *tree, const uint8_t *equal,
+                     int log_buckets, int direction, uint16_t *bucket_ids, int *histogram);
+    /** \brief returns the number of elements of the first run among the first k elements of the merge of two runs
+     *  (a, m, b, n, k, direction) */
+    int (*co_rank)(const void *a, int m, const void *b, int n, int k, int direction);
+    /** \brief merges the range low to high of the output of two sorted runs (a, m, b, n, low, high, out,
+     *  direction) */
+    void (*merge_range)(const void *a, int m, const void *b, int n, int low, int high, void *out, int direction);
+    /** \brief stores the breaks of the sorted runs of a range and flags its inversions, returns the number of breaks
+     *  stored (low_index, count, direction, breaks, max_breaks, inverted) */
+    int (*find_breaks)(const void *arr, int low_index, int count, int direction, int *breaks, int max_breaks,
+                       int *inverted);
+    /** \brief returns the index of the first element of a range greater than a bound in ascending order,
+     *  low_index + count if there is none (low_index, count, bound) */
+    int (*find_greater)(const void *arr, int low_index, int count, const void *bound);
+    /** \brief merges the heads of sorted blocks with a loser tree until the output is full or a block runs out,
+     *  returns the winner, -1 if every block is empty (heads, ends, tree, k, winner, out, n_out, out_cap,
+     *  direction) */
+    int (*loser_merge)(const void **heads, const void **ends, int *tree, int k, int winner, void *out, int *n_out,
+                       int out_cap, int direction);
+    /** \brief returns 1 if an element is ordered before another one in ascending order, 0 otherwise (a, b) */
+    int (*less)(const void *a, const void *b);
+    /** \brief returns the index of the first element out of order with the next one, -1 if sorted (count,
+     *  direction) */
+    int (*check)(const void *arr, int count, int direction);
+    /** \brief prints an element (index) */
+    void (*print)(FILE *stream, const void *arr, int index);
+} kernel_ops_t;
+
+/**
+ *  \brief Gets the kernels of an element type.
+ *
+ *  Floats and doubles are ordered by the IEEE 754 total order (-NaN < -inf < -0 < +0 < +inf < +NaN), so that every
+ *  input has a well-defined sorted order.
+ *
+ *  \param elem_type element type (ELEM_* of const.h)
+ *  \return pointer to the kernels, NULL if the type is not valid
+ */
+const kernel_ops_t *kernel_ops(int elem_type);
+
+/**
+ *  \brief Faults in the pages of a partition of an array, so that they become private to the process and are
+ *  first-touched by the calling thread.
+ *
+ *  \param arr array whose pages are faulted in
+ *  \param low_index index of the first element of the partition
+ *  \param count number of elements in the partition
+ *  \param elem_size number of bytes of an element
+ */
+void touch_pages(void *arr, int low_index, int count, int elem_size);
+
+#endif /* KERNELS_H */
@@ -0,0 +1,713 @@
+/**
+ *  \file kernels_template.h (implementation template)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the sequential bitonic sort and merge kernels for one element type. It is included by kernels.c
+ *  once per element type, with the following macros defined:
+ *  - KERNEL_TYPE: element type
+ *  - KERNEL_SUFFIX: suffix of the names of the kernels of the type
+ *  - KERNEL_TYPE_NAME: name of the type (string)
+ *  - KERNEL_LESS(a, b): whether element a is ordered before element b (ascending order)
+ *  - KERNEL_MIN(a, b), KERNEL_MAX(a, b): (optional) smaller and larger of elements a and b, selected with KERNEL_LESS
+ *    if not defined
+ *  - KERNEL_PRINT(stream, x): prints element x
+ *  - KERNEL_KEY(x), KERNEL_KEY_OPS: (optional) involution that maps an element to an integer key with the same order,
+ *    and kernels of the key type, which do the sorts and merges of ranges (the slices of levels still compare-exchange
+ *    with KERNEL_MIN and KERNEL_MAX, in a single pass)
+ *  - KERNEL_LEAVES: (optional) the type is int and the SIMD leaf kernels are used
+ *
+ *  The comparison is expanded inline in every kernel, so the compare-exchanges compile down to direct compare and
+ *  select instructions. The kernels of each type are exported through a kernel_ops_t table named ops_SUFFIX.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+/** \brief Number of elements of the blocks that fit in the L2 cache, for the element type */
+#define KERNEL_L2_BLOCK (L2_BLOCK_SIZE * (int) sizeof(int) / (int) sizeof(KERNEL_TYPE))
+
+/** \brief Number of elements of the blocks that fit in the L1 cache, for the element type */
+#define KERNEL_L1_BLOCK (L1_BLOCK_SIZE * (int) sizeof(int) / (int) sizeof(KERNEL_TYPE))
+
+#ifndef KERNEL_MIN
+#define KERNEL_MIN(a, b) (KERNEL_LESS(a, b) ? (a) : (b))
+#endif
+
+#ifndef KERNEL_MAX
+#define KERNEL_MAX(a, b) (KERNEL_LESS(a, b) ? (b) : (a))
+#endif
+
+/**
+ *  \brief Compare-exchanges each element of a run with the element of another run in the same position.
+ *
+ *  The compare-exchange uses min/max instead of a data-dependent branch, so the loops are branchless and
+ *  vectorizable.
+ *
+ *  \param lo run that receives the minimums in ascending order (the maximums in descending order)
+ *  \param hi run that receives the maximums in ascending order (the minimums in descending order)
+ *  \param count number of elements of each run
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static inline void KERNEL_NAME(compare_exchange_runs)(KERNEL_TYPE *lo, KERNEL_TYPE *hi, int count,
+                                                      int direction) {
+    if (direction == ASCENDING) {
+        for (int i = 0; i < count; i++) {
+            KERNEL_TYPE a = lo[i], b = hi[i];
+            lo[i] = KERNEL_MIN(a, b);
+            hi[i] = KERNEL_MAX(a, b);
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            KERNEL_TYPE a = lo[i], b = hi[i];
+            lo[i] = KERNEL_MAX(a, b);
+            hi[i] = KERNEL_MIN(a, b);
+        }
+    }
+}
+
+/**
+ *  \brief Performs one level of compare-exchanges of a bitonic merge.
+ *
+ *  The range is made of consecutive blocks of 2 * half elements, and each element of the first half of a block is
+ *  compare-exchanged with the element half positions ahead.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param half stride of the compare-exchanges
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static inline void KERNEL_NAME(bitonic_level)(KERNEL_TYPE *arr, int low_index, int count, int half,
+                                              int direction) {
+    for (KERNEL_TYPE *block = arr + low_index; block < arr + low_index + count; block += 2 * half) {
+        KERNEL_NAME(compare_exchange_runs)(block, block + half, half, direction);
+    }
+}
+
+/**
+ *  \brief Performs a slice of one level of compare-exchanges of a bitonic merge.
+ *
+ *  Each element of the slice is compare-exchanged with the element half positions ahead, so that a level whose
+ *  blocks are too large for a single thread can be split among several ones.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the slice
+ *  \param count number of elements in the slice (at most half, within the first half of a block)
+ *  \param half stride of the compare-exchanges
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(bitonic_level_slice)(void *arr, int low_index, int count, int half, int direction) {
+    KERNEL_TYPE *slice = (KERNEL_TYPE *) arr + low_index;
+    KERNEL_NAME(compare_exchange_runs)(slice, slice + half, count, direction);
+}
+
+/**
+ *  \brief Compare-exchanges four runs with the compare-exchanges of two consecutive levels of a bitonic merge.
+ *
+ *  Each group of four elements (one per run, in the same position) is loaded once and goes through the
+ *  compare-exchanges of both levels: (p0, p2) and (p1, p3), then (p0, p1) and (p2, p3).
+ *
+ *  \param p0 first run
+ *  \param p1 second run
+ *  \param p2 third run
+ *  \param p3 fourth run
+ *  \param count number of elements of each run
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static inline void KERNEL_NAME(compare_exchange_quads)(KERNEL_TYPE *p0, KERNEL_TYPE *p1, KERNEL_TYPE *p2,
+                                                       KERNEL_TYPE *p3, int count, int direction) {
+    for (int i = 0; i < count; i++) {
+        KERNEL_TYPE a = p0[i], b = p1[i], c = p2[i], d = p3[i];
+        // level half: (a, c) and (b, d)
+        KERNEL_TYPE ac_min = KERNEL_MIN(a, c), ac_max = KERNEL_MAX(a, c);
+        KERNEL_TYPE bd_min = KERNEL_MIN(b, d), bd_max = KERNEL_MAX(b, d);
+        if (direction == ASCENDING) {
+            // level half / 2: (a, b) and (c, d)
+            p0[i] = KERNEL_MIN(ac_min, bd_min);
+            p1[i] = KERNEL_MAX(ac_min, bd_min);
+            p2[i] = KERNEL_MIN(ac_max, bd_max);
+            p3[i] = KERNEL_MAX(ac_max, bd_max);
+        } else {
+            p0[i] = KERNEL_MAX(ac_max, bd_max);
+            p1[i] = KERNEL_MIN(ac_max, bd_max);
+            p2[i] = KERNEL_MAX(ac_min, bd_min);
+            p3[i] = KERNEL_MIN(ac_min, bd_min);
+        }
+    }
+}
+
+/**
+ *  \brief Performs two consecutive levels (strides half and half / 2) of a bitonic merge in a single pass.
+ *
+ *  Each group of four elements i, i + half / 2, i + half, i + 3 * half / 2 is loaded once and goes through the
+ *  compare-exchanges of both levels, which halves the memory traffic of the streaming levels.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param half stride of the first level (at least 2)
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static inline void KERNEL_NAME(bitonic_level_pair)(KERNEL_TYPE *arr, int low_index, int count, int half,
+                                                   int direction) {
+    int quarter = half / 2;
+    for (KERNEL_TYPE *block = arr + low_index; block < arr + low_index + count; block += 2 * half) {
+        KERNEL_NAME(compare_exchange_quads)(block, block + quarter, block + half, block + half + quarter, quarter,
+                                            direction);
+    }
+}
+
+/**
+ *  \brief Performs a slice of two consecutive levels (strides half and half / 2) of a bitonic merge in a single pass.
+ *
+ *  Each element of the slice is the first of a group of four elements, half / 2 positions apart.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the slice
+ *  \param count number of elements in the slice (at most half / 2, within the first quarter of a block)
+ *  \param half stride of the first level (at least 2)
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(bitonic_level_pair_slice)(void *arr, int low_index, int count, int half, int direction) {
+    KERNEL_TYPE *p0 = (KERNEL_TYPE *) arr + low_index;
+    int quarter = half / 2;
+    KERNEL_NAME(compare_exchange_quads)(p0, p0 + quarter, p0 + half, p0 + half + quarter, count, direction);
+}
+
+/**
+ *  \brief Performs the levels of a bitonic merge while their blocks (2 * half elements) are larger than a limit.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param half pointer to the stride of the next level, updated with the stride of the first level not performed
+ *  \param limit number of elements of the blocks from which the levels are no longer performed
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static inline void KERNEL_NAME(bitonic_levels_above)(KERNEL_TYPE *arr, int low_index, int count, int *half,
+                                                     int limit, int direction) {
+    while (*half >= 1 && 2 * *half > limit) {
+        if (*half >= 2 && *half > limit) {
+            KERNEL_NAME(bitonic_level_pair)(arr, low_index, count, *half, direction);
+            *half /= 4;
+        } else {
+            KERNEL_NAME(bitonic_level)(arr, low_index, count, *half, direction);
+            *half /= 2;
+        }
+    }
+}
+
+#ifndef KERNEL_KEY_OPS
+/**
+ *  \brief Merges the bitonic blocks of 2 * half elements of a range of an array in the desired order.
+ *
+ *  Iterative and cache-blocked: the levels whose blocks do not fit in the L2 cache run as streaming passes over the
+ *  whole range (two levels per pass), the next levels run inside L2-sized blocks and the last ones inside L1-sized
+ *  blocks, each block being finished completely before moving on to the next one.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range (multiple of 2 * half)
+ *  \param half stride of the first level
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(bitonic_merge_levels)(KERNEL_TYPE *arr, int low_index, int count, int half,
+                                              int direction) {
+    KERNEL_NAME(bitonic_levels_above)(arr, low_index, count, &half, KERNEL_L2_BLOCK, direction);
+    int l2_block = count < KERNEL_L2_BLOCK ? count : KERNEL_L2_BLOCK;
+    for (int l2_index = low_index; half >= 1 && l2_index < low_index + count; l2_index += l2_block) {
+        int l2_half = half;
+        KERNEL_NAME(bitonic_levels_above)(arr, l2_index, l2_block, &l2_half, KERNEL_L1_BLOCK, direction);
+        int l1_block = l2_block < KERNEL_L1_BLOCK ? l2_block : KERNEL_L1_BLOCK;
+        for (int l1_index = l2_index; l2_half >= 1 && l1_index < l2_index + l2_block; l1_index += l1_block) {
+            int l1_half = l2_half;
+#ifdef KERNEL_LEAVES
+            if (merge_leaf != NULL) {
+                // the last levels of each block of up to SIMD_MAX_COUNT elements run in registers
+                KERNEL_NAME(bitonic_levels_above)(arr, l1_index, l1_block, &l1_half, SIMD_MAX_COUNT, direction);
+                if (2 * l1_half >= SIMD_MIN_COUNT) {
+                    for (int leaf_index = l1_index; leaf_index < l1_index + l1_block; leaf_index += 2 * l1_half) {
+                        merge_leaf(arr + leaf_index, 2 * l1_half, direction);
+                    }
+                    continue;
+                }
+            }
+#endif
+            KERNEL_NAME(bitonic_levels_above)(arr, l1_index, l1_block, &l1_half, 1, direction);
+        }
+    }
+}
+
+/**
+ *  \brief Merges two halves of an array in the desired order.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the array
+ *  \param count number of elements in the array
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(bitonic_merge)(KERNEL_TYPE *arr, int low_index, int count, int direction) {
+    if (count <= 1) return;
+    KERNEL_NAME(bitonic_merge_levels)(arr, low_index, count, count / 2, direction);
+}
+
+/**
+ *  \brief Sorts an array in the desired order.
+ *
+ *  \param arr array to be sorted
+ *  \param low_index index of the first element of the array
+ *  \param count number of elements in the array
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(bitonic_sort)(KERNEL_TYPE *arr, int low_index, int count,
+                                      int direction) { // NOLINT(*-no-recursion)
+    if (count <= 1) return;
+#ifdef KERNEL_LEAVES
+    if (sort_leaf != NULL && count >= SIMD_MIN_COUNT && count <= SIMD_MAX_COUNT) {
+        sort_leaf(arr + low_index, count, direction);
+        return;
+    }
+#endif
+    int half = count / 2;
+    // sort left half in ascending order
+    KERNEL_NAME(bitonic_sort)(arr, low_index, half, ASCENDING);
+    // sort right half in descending order
+    KERNEL_NAME(bitonic_sort)(arr, low_index + half, half, DESCENDING);
+    // merge the two halves
+    KERNEL_NAME(bitonic_merge)(arr, low_index, count, direction);
+}
+
+/**
+ *  \brief Merges a bitonic range of any number of elements in the desired order.
+ *
+ *  The elements of the range above the largest power of 2 below count are compare-exchanged with the ones that many
+ *  positions behind, after which both parts are bitonic and every element of the first part is ordered before the
+ *  ones of the second.
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(bitonic_merge_any)(KERNEL_TYPE *arr, int low_index, int count,
+                                           int direction) { // NOLINT(*-no-recursion)
+    if ((count & (count - 1)) == 0) {
+        KERNEL_NAME(bitonic_merge)(arr, low_index, count, direction);
+        return;
+    }
+    int half = 1;
+    while (2 * half < count) half *= 2;
+    KERNEL_NAME(compare_exchange_runs)(arr + low_index, arr + low_index + half, count - half, direction);
+    KERNEL_NAME(bitonic_merge)(arr, low_index, half, direction);
+    KERNEL_NAME(bitonic_merge_any)(arr, low_index + half, count - half, direction);
+}
+
+/**
+ *  \brief Sorts a range of any number of elements in the desired order.
+ *
+ *  Ranges whose size is a power of 2 are sorted by bitonic_sort. Otherwise, the largest power of 2 below count is
+ *  sorted by bitonic_sort in the opposite order and the rest in the desired one, which makes the range bitonic, and
+ *  the range is merged. Most of the elements thus go through the blocked power of 2 kernels.
+ *
+ *  \param arr array to be sorted
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(bitonic_sort_any)(KERNEL_TYPE *arr, int low_index, int count,
+                                          int direction) { // NOLINT(*-no-recursion)
+    if ((count & (count - 1)) == 0) {
+        KERNEL_NAME(bitonic_sort)(arr, low_index, count, direction);
+        return;
+    }
+    int half = 1;
+    while (2 * half < count) half *= 2;
+    KERNEL_NAME(bitonic_sort)(arr, low_index, half, !direction);
+    KERNEL_NAME(bitonic_sort_any)(arr, low_index + half, count - half, direction);
+    KERNEL_NAME(bitonic_merge_any)(arr, low_index, count, direction);
+}
+#endif
+
+#ifdef KERNEL_KEY_OPS
+/**
+ *  \brief Maps the elements of a range of an array to their integer keys, or the keys back to the elements.
+ *
+ *  \param arr array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ */
+static void KERNEL_NAME(map_keys)(void *arr, int low_index, int count) {
+    KERNEL_TYPE *elems = (KERNEL_TYPE *) arr + low_index;
+    for (int i = 0; i < count; i++) {
+        elems[i] = KERNEL_KEY(elems[i]);
+    }
+}
+#endif
+
+/**
+ *  \brief Merges the bitonic blocks of 2 * half elements of a range of an array in the desired order.
+ *
+ *  With KERNEL_KEY_OPS, the elements are mapped to their integer keys, which are merged by the kernels of the key
+ *  type, and mapped back (the mapping is its own inverse).
+ *
+ *  \param arr array to be merged
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range (multiple of 2 * half)
+ *  \param half stride of the first level
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(merge_levels)(void *arr, int low_index, int count, int half, int direction) {
+#ifdef KERNEL_KEY_OPS
+    KERNEL_NAME(map_keys)(arr, low_index, count);
+    KERNEL_KEY_OPS.merge_levels(arr, low_index, count, half, direction);
+    KERNEL_NAME(map_keys)(arr, low_index, count);
+#else
+    KERNEL_NAME(bitonic_merge_levels)((KERNEL_TYPE *) arr, low_index, count, half, direction);
+#endif
+}
+
+/**
+ *  \brief Sorts an array of any number of elements in the desired order.
+ *
+ *  With KERNEL_KEY_OPS, the elements are mapped to their integer keys, which are sorted by the kernels of the key type
+ *  (plain integer compare-exchanges, and the SIMD leaves for 32-bit keys), and mapped back.
+ *
+ *  \param arr array to be sorted
+ *  \param low_index index of the first element of the array
+ *  \param count number of elements in the array
+ *  \param direction 0 for descending order, 1 for ascending order
+ */
+static void KERNEL_NAME(sort)(void *arr, int low_index, int count, int direction) {
+#ifdef KERNEL_KEY_OPS
+    KERNEL_NAME(map_keys)(arr, low_index, count);
+    KERNEL_KEY_OPS.sort(arr, low_index, count, direction);
+    KERNEL_NAME(map_keys)(arr, low_index, count);
+#else
+    KERNEL_NAME(bitonic_sort_any)((KERNEL_TYPE *) arr, low_index, count, direction);
+#endif
+}
+
+/**
+ *  \brief Classifies the elements of a range of an array into the buckets delimited by sorted splitters.
+ *
+ *  The splitters are laid out as an implicit binary search tree (the children of node j are nodes 2j and 2j + 1, the
+ *  root is node 1), so each element descends the tree with a fixed number of compares and no data-dependent branch.
+ *  An element equal to a splitter goes to the bucket before it. If that splitter is repeated, so the next bucket would
+ *  be empty, the element goes to the next bucket instead, which then only holds elements equal to the splitter (an
+ *  equality bucket, that needs no sort). In descending order, the buckets are numbered from the largest elements.
+ *
+ *  \param arr array to be classified
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param tree splitters (n_buckets elements, node 0 unused), followed by the upper splitter of each bucket, in
+ *  ascending order (n_buckets elements, the last one unused)
+ *  \param equal 1 for each bucket in ascending order whose upper splitter is repeated, 0 otherwise (NULL if no
+ *  splitter is repeated)
+ *  \param log_buckets base 2 logarithm of the number of buckets
+ *  \param direction 0 for descending order, 1 for ascending order
+ *  \param bucket_ids where the bucket of each element of the array is stored
+ *  \param histogram number of elements of the range in each bucket, incremented
+ */
+static void KERNEL_NAME(classify)(const void *arr, int low_index, int count, const void *tree, const uint8_t *equal,
+                                  int log_buckets, int direction, uint16_t *bucket_ids, int *histogram) {
+    const KERNEL_TYPE *elems = (const KERNEL_TYPE *) arr;
+    const KERNEL_TYPE *splitters = (const KERNEL_TYPE *) tree;
+    int n_buckets = 1 << log_buckets;
+    const KERNEL_TYPE *uppers = splitters + n_buckets;
+    int flip = direction == ASCENDING ? 0 : n_buckets - 1;
+    for (int i = low_index; i < low_index + count; i++) {
+        KERNEL_TYPE elem = elems[i];
+        int node = 1;
+        for (int level = 0; level < log_buckets; level++) {
+            node = 2 * node + KERNEL_LESS(splitters[node], elem);
+        }
+        int bucket = node - n_buckets;
+        if (equal != NULL) {
+            // the element is at most the upper splitter of its bucket: if it is equal, it goes to the equality bucket
+            bucket += equal[bucket] & !KERNEL_LESS(elem, uppers[bucket]);
+        }
+        bucket ^= flip;
+        bucket_ids[i] = (uint16_t) bucket;
+        histogram[bucket]++;
+    }
+}
+
+/**
+ *  \brief Checks if an element goes strictly before another one in the order of a direction.
+ *
+ *  \param x first element
+ *  \param y second element
+ *  \param direction 0 for descending order, 1 for ascending order
+ *
+ *  \return 1 if x goes before y, 0 otherwise (also if they are equal)
+ */
+static inline int KERNEL_NAME(goes_before)(KERNEL_TYPE x, KERNEL_TYPE y, int direction) {
+    return direction == ASCENDING ? KERNEL_LESS(x, y) : KERNEL_LESS(y, x);
+}
+
+/**
+ *  \brief Finds the number of elements of the first run among the first k elements of the merge of two runs.
+ *
+ *  A binary search along the k-th anti-diagonal of the merge path (see merge.h).
+ *
+ *  \param a first run
+ *  \param m number of elements of the first run
+ *  \param b second run
+ *  \param n number of elements of the second run
+ *  \param k position of the output (0 to m + n)
+ *  \param direction 0 for descending order, 1 for ascending order (order of the runs)
+ *
+ *  \return number of elements of the first run that precede position k of the output
+ */
+static int KERNEL_NAME(co_rank)(const void *a, int m, const void *b, int n, int k, int direction) {
+    const KERNEL_TYPE *first = (const KERNEL_TYPE *) a;
+    const KERNEL_TYPE *second = (const KERNEL_TYPE *) b;
+    int low = k > n ? k - n : 0;
+    int high = k < m ? k : m;
+    // smallest i such that b[k - i - 1] goes before a[i]: then a[i] is not among the first k elements
+    while (low < high) {
+        int i = low + (high - low) / 2;
+        if (KERNEL_NAME(goes_before)(second[k - i - 1], first[i], direction)) {
+            high = i;
+        } else {
+            low = i + 1;
+        }
+    }
+    return low;
+}
+
+/**
+ *  \brief Merges a range of the output of two sorted runs.
+ *
+ *  The merge is stable (on ties, the elements of the first run go first) and each step selects the next element
+ *  without a branch, until one of the runs is exhausted; the rest of the range is copied from the other one.
+ *
+ *  \param a first run
+ *  \param m number of elements of the first run
+ *  \param b second run
+ *  \param n number of elements of the second run
+ *  \param low first position of the range of the output
+ *  \param high position after the last one of the range of the output
+ *  \param out output of the whole merge (m + n elements, the range is written at its positions low to high)
+ *  \param direction 0 for descending order, 1 for ascending order (order of the runs and of the output)
+ */
+static void KERNEL_NAME(merge_range)(const void *a, int m, const void *b, int n, int low, int high, void *out,
+                                     int direction) {
+    const KERNEL_TYPE *first = (const KERNEL_TYPE *) a;
+    const KERNEL_TYPE *second = (const KERNEL_TYPE *) b;
+    KERNEL_TYPE *elems = (KERNEL_TYPE *) out;
+    int i = KERNEL_NAME(co_rank)(a, m, b, n, low, direction);
+    int j = low - i;
+    int k = low;
+    while (k < high && i < m && j < n) {
+        // each step takes one element from either run, so this many steps need no bound check
+        int steps = high - k;
+        steps = m - i < steps ? m - i : steps;
+        steps = n - j < steps ? n - j : steps;
+        for (int step = 0; step < steps; step++) {
+            const KERNEL_TYPE *x = first + i;
+            const KERNEL_TYPE *y = second + j;
+            int take_second = KERNEL_NAME(goes_before)(*y, *x, direction);
+            // the address is selected with a mask, so the compiler cannot branch on the unpredictable comparison
+            uintptr_t mask = -(uintptr_t) take_second;
+            elems[k++] = *(const KERNEL_TYPE *) (((uintptr_t) x & ~mask) | ((uintptr_t) y & mask));
+            j += take_second;
+            i += !take_second;
+        }
+    }
+    while (k < high && i < m) {
+        elems[k++] = first[i++];
+    }
+    while (k < high) {
+        elems[k++] = second[j++];
+    }
+}
+
+/**
+ *  \brief Finds the pairs of adjacent elements of a range that are out of order.
+ *
+ *  A break is a pair whose second element goes before the first one in the order of the direction (the boundary of
+ *  two sorted runs), an inversion a pair whose first element goes before the second one (which rules out a range
+ *  sorted in the opposite order).
+ *
+ *  \param arr array
+ *  \param low_index index of the first element of the first pair
+ *  \param count number of pairs (the last one ends at low_index + count)
+ *  \param direction 0 for descending order, 1 for ascending order
+ *  \param breaks where the index of the second element of each break is stored
+ *  \param max_breaks maximum number of breaks stored (the next ones are skipped)
+ *  \param inverted set to 1 if the range has an inversion, left as it is otherwise
+ *
+ *  \return number of breaks stored
+ */
+static int KERNEL_NAME(find_breaks)(const void *arr, int low_index, int count, int direction, int *breaks,
+                                    int max_breaks, int *inverted) {
+    const KERNEL_TYPE *elems = (const KERNEL_TYPE *) arr;
+    // the pair is read in the order of the direction, so a break is always a descent and an inversion an ascent
+    int lo = direction == ASCENDING ? 0 : 1;
+    int n_breaks = 0;
+    int ascents = 0;
+    for (int i = low_index; i < low_index + count; i++) {
+        KERNEL_TYPE x = elems[i + lo];
+        KERNEL_TYPE y = elems[i + 1 - lo];
+        if (KERNEL_LESS(y, x)) {
+            if (n_breaks < max_breaks) {
+                breaks[n_breaks++] = i + 1;
+            }
+        } else {
+            ascents |= KERNEL_LESS(x, y);
+        }
+    }
+    if (ascents) {
+        *inverted = 1;
+    }
+    return n_breaks;
+}
+
+/**
+ *  \brief Finds the first element of a range that is ordered after a bound in ascending order.
+ *
+ *  \param arr array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param bound bound (one element)
+ *
+ *  \return index of the first element greater than the bound, low_index + count if there is none
+ */
+static int KERNEL_NAME(find_greater)(const void *arr, int low_index, int count, const void *bound) {
+    const KERNEL_TYPE *elems = (const KERNEL_TYPE *) arr;
+    KERNEL_TYPE value = *(const KERNEL_TYPE *) bound;
+    int i = low_index;
+    while (i < low_index + count && !KERNEL_LESS(value, elems[i])) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ *  \brief Merges the heads of k sorted blocks with a loser tree, until the output is full or a block runs out.
+ *
+ *  The k blocks are the leaves k to 2k - 1 of an implicit tree whose internal nodes 1 to k - 1 hold the loser of
+ *  their match, and an empty block loses every match. The matches on the path of the previous winner are replayed
+ *  first, since its block may have been refilled since it won; on ties, the previous winner keeps winning.
+ *
+ *  \param heads next element of each block, advanced as the elements are taken
+ *  \param ends end of each block (the block is empty when its head reaches it)
+ *  \param tree losers of the internal nodes
+ *  \param k number of blocks
+ *  \param winner winner of the previous call (or of the matches that built the tree)
+ *  \param out output
+ *  \param n_out number of elements of the output, updated as the elements are taken
+ *  \param out_cap capacity of the output
+ *  \param direction 0 for descending order, 1 for ascending order (order of the blocks and of the output)
+ *
+ *  \return winner, whose block is the one that ran out if it is empty, -1 if every block is empty
+ */
+static int KERNEL_NAME(loser_merge)(const void **heads, const void **ends, int *tree, int k, int winner, void *out,
+                                    int *n_out, int out_cap, int direction) {
+    const KERNEL_TYPE **first = (const KERNEL_TYPE **) heads;
+    const KERNEL_TYPE **last = (const KERNEL_TYPE **) ends;
+    KERNEL_TYPE *elems = (KERNEL_TYPE *) out;
+    int n = *n_out;
+    for (;;) {
+        // replay the matches from the leaf of the winner to the root
+        for (int node = (winner + k) / 2; node >= 1; node /= 2) {
+            int other = tree[node];
+            if (first[other] != last[other]
+                && (first[winner] == last[winner] || KERNEL_NAME(goes_before)(*first[other], *first[winner],
+                                                                              direction))) {
+                tree[node] = winner;
+                winner = other;
+            }
+        }
+        if (first[winner] == last[winner]) {
+            winner = -1;
+            break;
+        }
+        if (n == out_cap) {
+            break;
+        }
+        elems[n++] = *first[winner]++;
+        // the block is refilled by the caller before its next match
+        if (first[winner] == last[winner]) {
+            break;
+        }
+    }
+    *n_out = n;
+    return winner;
+}
+
+/**
+ *  \brief Compares two elements.
+ *
+ *  \param a first element
+ *  \param b second element
+ *
+ *  \return 1 if a is ordered before b in ascending order, 0 otherwise
+ */
+static int KERNEL_NAME(less)(const void *a, const void *b) {
+    return KERNEL_LESS(*(const KERNEL_TYPE *) a, *(const KERNEL_TYPE *) b);
+}
+
+/**
+ *  \brief Checks if an array is sorted in the desired order.
+ *
+ *  \param arr array to be checked
+ *  \param count number of elements in the array
+ *  \param direction 0 for descending order, 1 for ascending order
+ *
+ *  \return index of the first element that is out of order with the next one, -1 if the array is sorted
+ */
+static int KERNEL_NAME(check)(const void *arr, int count, int direction) {
+    const KERNEL_TYPE *elems = (const KERNEL_TYPE *) arr;
+    for (int i = 0; i < count - 1; i++) {
+        if (direction == ASCENDING ? KERNEL_LESS(elems[i + 1], elems[i]) : KERNEL_LESS(elems[i], elems[i + 1])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ *  \brief Prints an element of an array.
+ *
+ *  \param stream stream to print to
+ *  \param arr array
+ *  \param index index of the element
+ */
+static void KERNEL_NAME(print)(FILE *stream, const void *arr, int index) {
+    KERNEL_PRINT(stream, ((const KERNEL_TYPE *) arr)[index]);
+}
+
+/** \brief Kernels of the element type */
+static const kernel_ops_t KERNEL_NAME(ops) = {
+    KERNEL_TYPE_NAME,
+    sizeof(KERNEL_TYPE),
+    KERNEL_NAME(sort),
+    KERNEL_NAME(merge_levels),
+    KERNEL_NAME(bitonic_level_slice),
+    KERNEL_NAME(bitonic_level_pair_slice),
+    KERNEL_NAME(classify),
+    KERNEL_NAME(co_rank),
+    KERNEL_NAME(merge_range),
+    KERNEL_NAME(find_breaks),
+    KERNEL_NAME(find_greater),
+    KERNEL_NAME(loser_merge),
+    KERNEL_NAME(less),
+    KERNEL_NAME(check),
+    KERNEL_NAME(print),
+};
+
+#undef KERNEL_L2_BLOCK
+#undef KERNEL_L1_BLOCK
+#undef KERNEL_TYPE
+#undef KERNEL_SUFFIX
+#undef KERNEL_TYPE_NAME
+#undef KERNEL_LESS
+#undef KERNEL_MIN
+#undef KERNEL_MAX
+#undef KERNEL_PRINT
+#undef KERNEL_LEAVES
+#undef KERNEL_KEY
+#undef KERNEL_KEY_OPS
@@ -0,0 +1,214 @@
+/**
+ *  \file memory.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the allocation of the array in anonymous memory, with huge pages and NUMA
+ *  placement.
+ *
+ *  The NUMA system calls are made directly, so the program does not depend on libnuma.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "const.h"
+#include "memory.h"
+
+/** \brief Maximum number of NUMA nodes of the node masks */
+#define MAX_NODES 1024
+
+/** \brief Maximum number of CPUs of the CPU masks */
+#define MAX_CPUS 4096
+
+/** \brief Number of bits of a word of the node and CPU masks */
+#define MASK_BITS (8 * sizeof(unsigned long))
+
+/**
+ *  \brief Interleaves the pages of a mapping across the NUMA nodes the process may use.
+ *
+ *  \param addr address of the mapping
+ *  \param size size of the mapping
+ *
+ *  \return number of nodes the pages are interleaved across, 0 if the policy could not be set
+ */
+static int interleave(void *addr, size_t size) {
+    unsigned long mask[MAX_NODES / MASK_BITS] = {0};
+    if (syscall(SYS_get_mempolicy, NULL, mask, MAX_NODES, NULL, MPOL_F_MEMS_ALLOWED) != 0) {
+        return 0;
+    }
+    int n_nodes = 0;
+    for (size_t i = 0; i < sizeof(mask) / sizeof(mask[0]); i++) {
+        n_nodes += __builtin_popcountl(mask[i]);
+    }
+    if (syscall(SYS_mbind, addr, size, MPOL_INTERLEAVE, mask, MAX_NODES, 0) != 0) {
+        return 0;
+    }
+    return n_nodes;
+}
+
+/**
+ *  \brief Allocates the memory of an array in an anonymous mapping.
+ *
+ *  \param bytes number of bytes of the array
+ *  \param flags ARRAY_HUGE and/or ARRAY_INTERLEAVE of const.h
+ *  \param map_size where the size of the mapping will be stored (to be unmapped with munmap)
+ *  \param kind where the kind of pages will be stored
+ *  \param n_nodes where the number of NUMA nodes the pages are interleaved across will be stored (0 if they are not)
+ *
+ *  \return pointer to the memory, NULL if it could not be mapped
+ */
+void *array_alloc(size_t bytes, int flags, size_t *map_size, const char **kind, int *n_nodes) {
+    size_t page = (flags & ARRAY_HUGE) ? HUGE_PAGE_SIZE : (size_t) sysconf(_SC_PAGESIZE);
+    size_t size = (bytes + page - 1) / page * page;
+    if (size == 0) {
+        size = page;
+    }
+    void *addr = MAP_FAILED;
+    if (flags & ARRAY_HUGE) {
+        // reserved huge pages, if the system has them
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        *kind = "huge pages (hugetlb)";
+    }
+    if (addr == MAP_FAILED) {
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            return NULL;
+        }
+        *kind = "base pages";
+        if ((flags & ARRAY_HUGE) && madvise(addr, size, MADV_HUGEPAGE) == 0) {
+            *kind = "transparent huge pages";
+        }
+    }
+    *n_nodes = (flags & ARRAY_INTERLEAVE) ? interleave(addr, size) : 0;
+    *map_size = size;
+    return addr;
+}
+
+/**
+ *  \brief Gets the NUMA node of the CPU the calling thread runs on.
+ *
+ *  \return node, -1 if it is not known
+ */
+int current_node(void) {
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+        return -1;
+    }
+    return (int) node;
+}
+
+/**
+ *  \brief Gets the NUMA nodes of pages of memory.
+ *
+ *  \param pages addresses in the pages
+ *  \param n number of pages
+ *  \param nodes where the node of each page will be stored (negative if the page is not resident)
+ *
+ *  \return 0 if the nodes were read, -1 if the system does not report them
+ */
+int page_nodes(void **pages, int n, int *nodes) {
+    // move_pages without target nodes only reports where the pages are
+    return syscall(SYS_move_pages, 0, (unsigned long) n, pages, NULL, nodes, 0) == 0 ? 0 : -1;
+}
+
+/**
+ *  \brief Reads the CPUs of a NUMA node that the process may run on into a CPU mask.
+ *
+ *  \param node node
+ *  \param allowed CPUs the process may run on (MAX_CPUS bits)
+ *  \param mask where the allowed CPUs of the node will be set (MAX_CPUS bits, cleared by the caller)
+ *
+ *  \return number of allowed CPUs of the node, 0 if it has none or they could not be read
+ */
+static int node_cpus(int node, const unsigned long *allowed, unsigned long *mask) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;
+    }
+    // the list is made of CPUs and ranges of CPUs separated by commas, e.g. 0-3,8-11
+    int n_cpus = 0;
+    int first, last;
+    while (fscanf(file, "%d", &first) == 1) {
+        last = first;
+        int c = fgetc(file);
+        if (c == '-') {
+            if (fscanf(file, "%d", &last) != 1) {
+                break;
+            }
+            c = fgetc(file);
+        }
+        for (int cpu = first; cpu <= last && cpu < MAX_CPUS; cpu++) {
+            if (allowed[cpu / MASK_BITS] & (1UL << (cpu % MASK_BITS))) {
+                mask[cpu / MASK_BITS] |= 1UL << (cpu % MASK_BITS);
+                n_cpus++;
+            }
+        }
+        if (c != ',') {
+            break;
+        }
+    }
+    fclose(file);
+    return n_cpus;
+}
+
+/**
+ *  \brief Pins the calling thread to the CPUs of the NUMA node of a part of the array.
+ *
+ *  The nodes that the process may allocate memory on and that have CPUs it may run on (its affinity mask, e.g. set by
+ *  taskset) get blocks of consecutive parts (part * n_nodes / n_parts), so the pages first touched by the thread of a
+ *  part are placed on the node of that part, and the worker thread that sorts the part, pinned the same way, finds them
+ *  there. The thread is only pinned to the CPUs of the node that are in the affinity mask of the process.
+ *
+ *  \param part index of the part
+ *  \param n_parts number of parts
+ *
+ *  \return node the thread was pinned to, -1 if it was not (a single node, no CPU of the node the process may run
+ *  on, or the affinity could not be set)
+ */
+int pin_to_node(int part, int n_parts) {
+    unsigned long mems[MAX_NODES / MASK_BITS] = {0};
+    if (part < 0 || part >= n_parts
+        || syscall(SYS_get_mempolicy, NULL, mems, MAX_NODES, NULL, MPOL_F_MEMS_ALLOWED) != 0) {
+        return -1;
+    }
+    // the CPUs the process may run on (e.g. set by taskset) are those of the main thread, which is never pinned (its id
+    // is the process id), unlike the calling thread, which may already be pinned to another node
+    unsigned long allowed[MAX_CPUS / MASK_BITS] = {0};
+    if (syscall(SYS_sched_getaffinity, getpid(), sizeof(allowed), allowed) < 0) {
+        return -1;
+    }
+    // the nodes without CPUs (memory only) or whose CPUs are all excluded cannot run the thread
+    int nodes[MAX_NODES];
+    int n_nodes = 0;
+    unsigned long cpus[MAX_CPUS / MASK_BITS];
+    for (int node = 0; node < MAX_NODES; node++) {
+        if (mems[node / MASK_BITS] & (1UL << (node % MASK_BITS))) {
+            memset(cpus, 0, sizeof(cpus));
+            if (node_cpus(node, allowed, cpus) > 0) {
+                nodes[n_nodes++] = node;
+            }
+        }
+    }
+    if (n_nodes <= 1) {
+        return -1;
+    }
+    int node = nodes[(long) part * n_nodes / n_parts];
+    memset(cpus, 0, sizeof(cpus));
+    // a thread id of 0 is the calling thread
+    if (node_cpus(node, allowed, cpus) == 0 || syscall(SYS_sched_setaffinity, 0, sizeof(cpus), cpus) != 0) {
+        return -1;
+    }
+    return node;
+}
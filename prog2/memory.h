@@ -0,0 +1,79 @@
+/**
+ *  \file memory.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the allocation of the array in anonymous memory, with huge pages and NUMA
+ *  placement.
+ *
+ *  The array is allocated in an anonymous mapping, backed by huge pages (MAP_HUGETLB if the system has reserved huge
+ *  pages, transparent huge pages through madvise otherwise) and optionally interleaved across the NUMA nodes the
+ *  process may use (mbind). The pages are not touched, so that the threads that first write them (the threads that read
+ *  the file, one per partition of the worker threads) place them on their own nodes: each of these threads is pinned
+ *  to the CPUs of the node of its partition (pin_to_node), and so is the lockstep worker thread that sorts it.
+ *
+ *  The NUMA system calls are made directly, so the program does not depend on libnuma.
+ *
+ *  Operations:
+ *  - array_alloc: allocates the memory of an array
+ *  - current_node: gets the NUMA node of the CPU the calling thread runs on
+ *  - page_nodes: gets the NUMA nodes of pages of memory
+ *  - pin_to_node: pins the calling thread to the CPUs of the NUMA node of a part of the array
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+
+/**
+ *  \brief Allocates the memory of an array in an anonymous mapping.
+ *
+ *  \param bytes number of bytes of the array
+ *  \param flags ARRAY_HUGE and/or ARRAY_INTERLEAVE of const.h
+ *  \param map_size where the size of the mapping will be stored (to be unmapped with munmap)
+ *  \param kind where the kind of pages will be stored
+ *  \param n_nodes where the number of NUMA nodes the pages are interleaved across will be stored (0 if they are not)
+ *
+ *  \return pointer to the memory, NULL if it could not be mapped
+ */
+void *array_alloc(size_t bytes, int flags, size_t *map_size, const char **kind, int *n_nodes);
+
+/**
+ *  \brief Gets the NUMA node of the CPU the calling thread runs on.
+ *
+ *  \return node, -1 if it is not known
+ */
+int current_node(void);
+
+/**
+ *  \brief Gets the NUMA nodes of pages of memory.
+ *
+ *  \param pages addresses in the pages
+ *  \param n number of pages
+ *  \param nodes where the node of each page will be stored (negative if the page is not resident)
+ *
+ *  \return 0 if the nodes were read, -1 if the system does not report them
+ */
+int page_nodes(void **pages, int n, int *nodes);
+
+/**
+ *  \brief Pins the calling thread to the CPUs of the NUMA node of a part of the array.
+ *
+ *  The nodes that the process may allocate memory on and that have CPUs it may run on (its affinity mask, e.g. set by
+ *  taskset) get blocks of consecutive parts (part * n_nodes / n_parts), so the pages first touched by the thread of a
+ *  part are placed on the node of that part, and the worker thread that sorts the part, pinned the same way, finds them
+ *  there. The thread is only pinned to the CPUs of the node that are in the affinity mask of the process.
+ *
+ *  \param part index of the part
+ *  \param n_parts number of parts
+ *
+ *  \return node the thread was pinned to, -1 if it was not (a single node, no CPU of the node the process may run
+ *  on, or the affinity could not be set)
+ */
+int pin_to_node(int part, int n_parts);
+
+#endif /* MEMORY_H */
@@ -0,0 +1,92 @@
+/**
+ *  \file merge.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the merge path kernels, that split the merge of two sorted runs among
+ *  several threads. The co-rank and the merge of a range are instantiated per element type (co_rank and merge_range
+ *  of kernel_ops_t, see kernels_template.h), so the comparisons are inline in their loops.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include "const.h"
+#include "merge.h"
+
+/**
+ *  \brief Finds the number of elements of the first run among the first k elements of the merge of two runs.
+ *
+ *  \param ops kernels of the element type
+ *  \param a first run
+ *  \param m number of elements of the first run
+ *  \param b second run
+ *  \param n number of elements of the second run
+ *  \param k position of the output (0 to m + n)
+ *  \param direction DESCENDING or ASCENDING (order of the runs)
+ *
+ *  \return number of elements of the first run that precede position k of the output
+ */
+int merge_co_rank(const kernel_ops_t *ops, const void *a, int m, const void *b, int n, int k, int direction) {
+    return ops->co_rank(a, m, b, n, k, direction);
+}
+
+/**
+ *  \brief Merges a range of the output of two sorted runs.
+ *
+ *  \param ops kernels of the element type
+ *  \param a first run
+ *  \param m number of elements of the first run
+ *  \param b second run
+ *  \param n number of elements of the second run
+ *  \param low first position of the range of the output
+ *  \param high position after the last one of the range of the output
+ *  \param out output of the whole merge (m + n elements, the range is written at its positions low to high)
+ *  \param direction DESCENDING or ASCENDING (order of the runs and of the output)
+ */
+void merge_range(const kernel_ops_t *ops, const void *a, int m, const void *b, int n, int low, int high, void *out,
+                 int direction) {
+    ops->merge_range(a, m, b, n, low, high, out, direction);
+}
+
+/**
+ *  \brief Merges a range of the output of a round of merges of pairs of runs.
+ *
+ *  Run 2p is merged with run 2p + 1 (or copied, if it is the last one) into the same range of the destination, so
+ *  the output of a round can be split in ranges of any size, independently of where the runs start.
+ *
+ *  \param runs runs of the round
+ *  \param low first position of the range
+ *  \param high position after the last one of the range
+ */
+void merge_round_range(const merge_runs_t *runs, int low, int high) {
+    size_t elem_size = runs->ops->elem_size;
+    for (int p = 0; 2 * p < runs->n_runs; p++) {
+        int start = runs->starts[2 * p];
+        int middle = runs->starts[2 * p + 1];
+        int end = runs->starts[2 * p + 2 < runs->n_runs ? 2 * p + 2 : runs->n_runs];
+        if (end <= low || start >= high) {
+            continue;
+        }
+        merge_range(runs->ops, runs->src + (size_t) start * elem_size, middle - start,
+                    runs->src + (size_t) middle * elem_size, end - middle, (low > start ? low : start) - start,
+                    (high < end ? high : end) - start, runs->dst + (size_t) start * elem_size, runs->direction);
+    }
+}
+
+/**
+ *  \brief Makes the merged pairs of runs of a round the runs of the next round, and swaps the buffers.
+ *
+ *  \param runs runs of the round
+ */
+void merge_next_round(merge_runs_t *runs) {
+    int n_runs = 0;
+    for (int r = 0; r < runs->n_runs; r += 2) {
+        runs->starts[n_runs++] = runs->starts[r];
+    }
+    runs->starts[n_runs] = runs->size;
+    runs->n_runs = n_runs;
+    char *src = runs->src;
+    runs->src = runs->dst;
+    runs->dst = src;
+}
@@ -0,0 +1,96 @@
+/**
+ *  \file merge.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the merge path kernels, that split the merge of two sorted runs among several
+ *  threads.
+ *
+ *  The merge of two runs of m and n elements is a path through an m x n grid, and the k-th element of the output is on
+ *  its k-th anti-diagonal. A binary search along the anti-diagonal (the co-rank) finds how many elements of each run
+ *  precede it, so any range of the output can be merged on its own, without synchronization, by reading only the
+ *  elements of the runs that end up in it. The merge is stable: on ties, the elements of the first run go first.
+ *
+ *  The co-rank and the merge of a range are the kernels of the element type (co_rank and merge_range of kernel_ops_t),
+ *  with the comparison inline, so no element is compared through a function pointer.
+ *
+ *  Several runs are merged in pairs, in rounds, between two buffers: each round halves the number of runs, and its
+ *  output can be split in ranges of any size among the threads.
+ *
+ *  Operations:
+ *  - merge_co_rank: finds the number of elements of the first run that precede a position of the output
+ *  - merge_range: merges a range of the output of two runs
+ *  - merge_round_range: merges a range of the output of a round of merges of pairs of runs
+ *  - merge_next_round: makes the merged pairs of a round the runs of the next one
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef MERGE_H
+#define MERGE_H
+
+#include "kernels.h"
+
+/** \brief Runs of an array merged in pairs, in rounds, from a source buffer to a destination one */
+typedef struct {
+    const kernel_ops_t *ops;
+    char *src;
+    char *dst;
+    int size;
+    int direction;
+    int n_runs;
+    int *starts;
+} merge_runs_t;
+
+/**
+ *  \brief Finds the number of elements of the first run among the first k elements of the merge of two runs.
+ *
+ *  \param ops kernels of the element type
+ *  \param a first run
+ *  \param m number of elements of the first run
+ *  \param b second run
+ *  \param n number of elements of the second run
+ *  \param k position of the output (0 to m + n)
+ *  \param direction DESCENDING or ASCENDING (order of the runs)
+ *
+ *  \return number of elements of the first run that precede position k of the output
+ */
+int merge_co_rank(const kernel_ops_t *ops, const void *a, int m, const void *b, int n, int k, int direction);
+
+/**
+ *  \brief Merges a range of the output of two sorted runs.
+ *
+ *  \param ops kernels of the element type
+ *  \param a first run
+ *  \param m number of elements of the first run
+ *  \param b second run
+ *  \param n number of elements of the second run
+ *  \param low first position of the range of the output
+ *  \param high position after the last one of the range of the output
+ *  \param out output of the whole merge (m + n elements, the range is written at its positions low to high)
+ *  \param direction DESCENDING or ASCENDING (order of the runs and of the output)
+ */
+void merge_range(const kernel_ops_t *ops, const void *a, int m, const void *b, int n, int low, int high, void *out,
+                 int direction);
+
+/**
+ *  \brief Merges a range of the output of a round of merges of pairs of runs.
+ *
+ *  Run 2p is merged with run 2p + 1 (or copied, if it is the last one) into the same range of the destination, so
+ *  the output of a round can be split in ranges of any size, independently of where the runs start.
+ *
+ *  \param runs runs of the round
+ *  \param low first position of the range
+ *  \param high position after the last one of the range
+ */
+void merge_round_range(const merge_runs_t *runs, int low, int high);
+
+/**
+ *  \brief Makes the merged pairs of runs of a round the runs of the next round, and swaps the buffers.
+ *
+ *  \param runs runs of the round
+ */
+void merge_next_round(merge_runs_t *runs);
+
+#endif /* MERGE_H */
@@ -0,0 +1,208 @@
+/**
+ *  \file mergesort.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the parallel merge sort.
+ *
+ *  Each phase forks one task per run or slice of the array and continues with the next phase, like the sample sort.
+ *  The state shared by the tasks of a sort lives in a single structure, freed by the last phase.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "steal.h"
+#include "merge.h"
+#include "mergesort.h"
+
+/** \brief Phase of the merge sort: fork the sort of each run */
+#define RUNS_PHASE 0
+
+/** \brief Phase of the merge sort: sort a run */
+#define SORT_RUN_PHASE 1
+
+/** \brief Phase of the merge sort: start the first round of merges of the sorted runs */
+#define MERGES_PHASE 2
+
+/** \brief Phase of the merge sort: merge a slice of the output of a round of merges */
+#define MERGE_PHASE 3
+
+/** \brief Phase of the merge sort: start the next round of merges */
+#define ROUND_PHASE 4
+
+/** \brief Phase of the merge sort: copy a slice of the sorted array back from the buffer */
+#define COPY_PHASE 5
+
+/** \brief Phase of the merge sort: free the state of the sort */
+#define FINISH_PHASE 6
+
+/** \brief Phase of the merge sort: sort an array of up to STEAL_GRAIN_SIZE elements in place, as a single run */
+#define SORT_ALL_PHASE 7
+
+/** \brief State shared by the tasks of a merge sort */
+typedef struct {
+    const kernel_ops_t *ops;
+    char *arr;
+    char *aux;
+    int size;
+    int direction;
+    int n_slices;
+    int slice;
+    merge_runs_t runs;
+    int *starts;
+} mergesort_t;
+
+static void run_mergesort_job(steal_pool_t *pool, steal_task_t *header);
+
+/**
+ *  \brief Starts the next round of merges of the runs, or finishes them.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header task that forks the round
+ *  \param sort state of the sort
+ */
+static void next_round(steal_pool_t *pool, steal_task_t *header, mergesort_t *sort) {
+    if (sort->runs.n_runs > 1) {
+        steal_fork_phase(pool, header, MERGE_PHASE, sort->n_slices, ROUND_PHASE);
+    } else if (sort->runs.src != sort->arr) {
+        steal_fork_phase(pool, header, COPY_PHASE, sort->n_slices, FINISH_PHASE);
+    } else {
+        free(sort->aux);
+        free(sort->starts);
+        free(sort);
+        steal_done(pool, header);
+    }
+}
+
+/**
+ *  \brief Executes a fork/join task of a merge sort.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header header of the fork/join task
+ */
+static void run_mergesort_job(steal_pool_t *pool, steal_task_t *header) {
+    steal_phase_t *job = (steal_phase_t *) header;
+    mergesort_t *sort = (mergesort_t *) job->state;
+    size_t elem_size = sort->ops->elem_size;
+    int low = job->index * sort->slice;
+    int high = sort->size - low < sort->slice ? sort->size : low + sort->slice;
+
+    if (job->phase == RUNS_PHASE) {
+        steal_fork_phase(pool, header, SORT_RUN_PHASE, sort->runs.n_runs, MERGES_PHASE);
+    } else if (job->phase == SORT_RUN_PHASE) {
+        int start = sort->starts[job->index];
+        sort->ops->sort(sort->arr, start, sort->starts[job->index + 1] - start, sort->direction);
+        steal_done(pool, header);
+    } else if (job->phase == MERGE_PHASE) {
+        if (low < high) {
+            merge_round_range(&sort->runs, low, high);
+        }
+        steal_done(pool, header);
+    } else if (job->phase == MERGES_PHASE) {
+        next_round(pool, header, sort);
+    } else if (job->phase == ROUND_PHASE) {
+        merge_next_round(&sort->runs);
+        next_round(pool, header, sort);
+    } else if (job->phase == COPY_PHASE) {
+        if (low < high) {
+            memcpy(sort->arr + (size_t) low * elem_size, sort->runs.src + (size_t) low * elem_size,
+                   (size_t) (high - low) * elem_size);
+        }
+        steal_done(pool, header);
+    } else if (job->phase == SORT_ALL_PHASE) {
+        sort->ops->sort(sort->arr, 0, sort->size, sort->direction);
+        free(sort);
+        steal_done(pool, header);
+    } else {
+        // finish phase
+        free(sort->aux);
+        free(sort->starts);
+        free(sort);
+        steal_done(pool, header);
+    }
+    free(header);
+}
+
+/**
+ *  \brief Computes the number of runs (and of slices of each round) of a merge sort: one per worker thread.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param size number of elements in the array
+ *
+ *  \return number of runs
+ */
+static int run_count(steal_pool_t *pool, int size) {
+    return pool->n_workers < size ? pool->n_workers : size;
+}
+
+/**
+ *  \brief Computes the auxiliary memory used by the merge sort of an array.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *
+ *  \return number of bytes allocated by the sort besides the array
+ */
+size_t mergesort_memory(steal_pool_t *pool, int size, int elem_type) {
+    if (size <= STEAL_GRAIN_SIZE) {
+        return 0;
+    }
+    size_t elem_size = kernel_ops(elem_type)->elem_size;
+    return (size_t) size * elem_size + (size_t) (run_count(pool, size) + 1) * sizeof(int);
+}
+
+/**
+ *  \brief Allocates the root task of the merge sort of an array.
+ *
+ *  Arrays of up to STEAL_GRAIN_SIZE elements are sorted in place by a single task.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (any)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the sort
+ */
+steal_task_t *new_mergesort_job(steal_pool_t *pool, void *arr, int size, int elem_type, int direction) {
+    mergesort_t *sort = (mergesort_t *) calloc(1, sizeof(mergesort_t));
+    if (sort == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the merge sort\n");
+        return NULL;
+    }
+    sort->ops = kernel_ops(elem_type);
+    sort->arr = (char *) arr;
+    sort->size = size;
+    sort->direction = direction;
+    if (size <= STEAL_GRAIN_SIZE) {
+        return steal_phase_job(run_mergesort_job, sort, SORT_ALL_PHASE, 0);
+    }
+    int n_runs = run_count(pool, size);
+    sort->n_slices = n_runs;
+    sort->slice = (size + n_runs - 1) / n_runs;
+
+    size_t elem_size = sort->ops->elem_size;
+    sort->aux = (char *) malloc((size_t) size * elem_size);
+    sort->starts = (int *) malloc((n_runs + 1) * sizeof(int));
+    if (sort->aux == NULL || sort->starts == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the merge sort\n");
+        free(sort->aux);
+        free(sort->starts);
+        free(sort);
+        return NULL;
+    }
+    // runs of the same size, up to one element
+    for (int r = 0; r <= n_runs; r++) {
+        sort->starts[r] = (int) ((long long) size * r / n_runs);
+    }
+    sort->runs = (merge_runs_t) {sort->ops, sort->arr, sort->aux, size, direction, n_runs, sort->starts};
+    return steal_phase_job(run_mergesort_job, sort, RUNS_PHASE, 0);
+}
@@ -0,0 +1,54 @@
+/**
+ *  \file mergesort.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the parallel merge sort, an alternative to the bitonic sort that reads each
+ *  element once per round of merges instead of once per merge level, O(n log n) work in total.
+ *
+ *  The sort is a chain of fork/join tasks of the work-stealing scheduler:
+ *  - runs: the array is split in one run per worker thread, and each run is sorted by the bitonic kernels
+ *  - merge: the runs are merged in pairs, in rounds, between the array and an auxiliary buffer as large as it; the
+ *    output of each round is split by merge path (see merge.h) in one slice of the same size per worker thread, so
+ *    every thread has the same work in every round, however many runs are left
+ *  - copy: the sorted array is copied back from the buffer, if the last round ended there
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef MERGESORT_H
+#define MERGESORT_H
+
+#include <stddef.h>
+
+#include "steal.h"
+
+/**
+ *  \brief Computes the auxiliary memory used by the merge sort of an array.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *
+ *  \return number of bytes allocated by the sort besides the array
+ */
+size_t mergesort_memory(steal_pool_t *pool, int size, int elem_type);
+
+/**
+ *  \brief Allocates the root task of the merge sort of an array.
+ *
+ *  The auxiliary buffer (as large as the array) and the starts of the runs are allocated here, and freed by the last
+ *  task of the sort.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (any)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the sort
+ */
+steal_task_t *new_mergesort_job(steal_pool_t *pool, void *arr, int size, int elem_type, int direction);
+
+#endif /* MERGESORT_H */
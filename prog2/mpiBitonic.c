@@ -0,0 +1,589 @@
+/**
+ *  \file mpiBitonic.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the distributed bitonic sort, across the ranks of an MPI program.
+ *
+ *  Each of the P ranks (a power of 2) reads its block of the array from the file with MPI-IO and sorts it with the
+ *  threaded bitonic sort of the library. The blocks are then merged by the bitonic sorting network of P elements, with
+ *  whole blocks as its elements: at each step of the network, a rank exchanges its block with its partner rank and
+ *  compare-splits them, keeping the larger or the smaller half of the two blocks. The split is a local merge of the two
+ *  sorted blocks (see merge.h), split among the threads of the rank by merge path, so the block of every rank stays
+ *  sorted after each step, and the blocks end up in descending order of the ranks.
+ *
+ *  The sorted array is written to the output file in parallel by the ranks, with MPI-IO, or gathered on rank 0 and
+ *  written by it. Each rank checks the order of its block and of its boundary with the next one, and the checksums of
+ *  the input and output elements of all the ranks are compared (see verify.h).
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <mpi.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "bitonic.h"
+#include "arrfile.h"
+#include "merge.h"
+#include "verify.h"
+
+/** \brief Slice of the output of the compare-split of two blocks, merged by a thread */
+typedef struct {
+    const kernel_ops_t *ops;
+    const char *a;
+    const char *b;
+    int block;
+    int low;
+    int high;
+    int first;
+    char *out;
+} split_slice_t;
+
+/**
+ *  \brief Prints the usage of the program.
+ *
+ *  \param cmd_name name of the command that started the program
+ */
+static void printUsage(char *cmd_name) {
+    fprintf(stderr, "Usage: mpirun -np P %s REQUIRED OPTIONS\n"
+                    "REQUIRED:\n"
+                    "-f --- input file with numbers (the element type is read from its header, see genData)\n"
+                    "OPTIONS:\n"
+                    "-h --- print this help\n"
+                    "-n --- number of worker threads of each rank (default is %d, minimum is 1)\n"
+                    "-o --- output file for the sorted array (same format as the input file), written by the ranks\n"
+                    "-G --- gather the sorted array on rank 0, which writes the output file\n"
+                    "-S --- use the scalar kernels even if the CPU supports the SIMD ones\n"
+                    "The number of ranks P must be a power of 2, and the size of the array a power of 2 (at least P)\n",
+            cmd_name, N_WORKERS);
+}
+
+/**
+ *  \brief Checks if every rank succeeded.
+ *
+ *  \param status EXIT_SUCCESS or EXIT_FAILURE on the calling rank
+ *
+ *  \return EXIT_SUCCESS if every rank succeeded, EXIT_FAILURE otherwise
+ */
+static int all_ranks(int status) {
+    int any_failure;
+    MPI_Allreduce(&status, &any_failure, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    return any_failure != EXIT_SUCCESS ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Reads the header of the input file and checks that the array can be split among the ranks.
+ *
+ *  \param file_path path to the input file
+ *  \param n_ranks number of ranks
+ *  \param header where the header of the file will be stored
+ *
+ *  \return EXIT_SUCCESS if the array can be sorted, EXIT_FAILURE otherwise
+ */
+static int read_header(char *file_path, int n_ranks, array_header_t *header) {
+    int fd = open(file_path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1 || read_array_header(fd, header) != EXIT_SUCCESS) {
+        fprintf(stderr, "[DIST] Could not read the header of the file %s\n", file_path);
+        if (fd != -1) close(fd);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    const kernel_ops_t *ops = kernel_ops(header->elem_type);
+    if (ops == NULL || header->elem_type >= N_ELEM_TYPES) {
+        fprintf(stderr, "[DIST] Unknown element type %d\n", header->elem_type);
+        return EXIT_FAILURE;
+    }
+    // the blocks of the ranks must be powers of 2 (and fit the int indexes of the kernels)
+    uint64_t count = header->count;
+    if ((count & (count - 1)) != 0 || count < (uint64_t) n_ranks || count / n_ranks > INT_MAX) {
+        fprintf(stderr, "[DIST] The size of the array must be a power of 2, of at least one element per rank\n");
+        return EXIT_FAILURE;
+    }
+    if ((uint64_t) st.st_size < header->size + count * ops->elem_size) {
+        fprintf(stderr, "[DIST] The file is smaller than the size of the array\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Reads the block of a rank from the input file, with a collective MPI-IO read.
+ *
+ *  \param file_path path to the input file
+ *  \param header header of the input file
+ *  \param rank rank of the calling process
+ *  \param block number of elements of each block
+ *  \param elem elements of the file as an MPI datatype
+ *  \param arr block where the elements are read to
+ *
+ *  \return EXIT_SUCCESS if the block was read, EXIT_FAILURE otherwise
+ */
+static int read_block(char *file_path, const array_header_t *header, int rank, int block, MPI_Datatype elem,
+                      void *arr) {
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_WORLD, file_path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        fprintf(stderr, "[DIST] Could not open file %s\n", file_path);
+        return EXIT_FAILURE;
+    }
+    size_t elem_size = kernel_ops(header->elem_type)->elem_size;
+    MPI_Offset offset = (MPI_Offset) header->size + (MPI_Offset) rank * block * (MPI_Offset) elem_size;
+    MPI_Status status;
+    int n_read = 0;
+    int error = MPI_File_read_at_all(file, offset, arr, block, elem, &status);
+    MPI_File_close(&file);
+    if (error != MPI_SUCCESS || MPI_Get_count(&status, elem, &n_read) != MPI_SUCCESS || n_read != block) {
+        fprintf(stderr, "[DIST] Rank %d could not read its block\n", rank);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Thread function that merges a slice of the output of the compare-split of two blocks.
+ *
+ *  \param arg pointer to the slice
+ *
+ *  \return NULL
+ */
+static void *split_slice(void *arg) {
+    split_slice_t *slice = (split_slice_t *) arg;
+    size_t elem_size = slice->ops->elem_size;
+    // the merge starts at the co-rank of the first position of the slice
+    int i = merge_co_rank(slice->ops, slice->a, slice->block, slice->b, slice->block, slice->low, DESCENDING);
+    int j = slice->low - i;
+    char *out = slice->out + (size_t) (slice->low - slice->first) * elem_size;
+    merge_range(slice->ops, slice->a + (size_t) i * elem_size, slice->block - i, slice->b + (size_t) j * elem_size,
+                slice->block - j, 0, slice->high - slice->low, out, DESCENDING);
+    return NULL;
+}
+
+/**
+ *  \brief Compare-splits two sorted blocks: keeps the larger or the smaller half of their elements, sorted.
+ *
+ *  Both partners merge the block of the lower rank before the one of the higher rank, so that they split the ties in
+ *  the same way and no element is kept by both or by neither.
+ *
+ *  \param ops kernels of the element type
+ *  \param lower block of the lower rank (in descending order)
+ *  \param upper block of the higher rank (in descending order)
+ *  \param block number of elements of each block
+ *  \param keep_larger whether the larger half is kept (the smaller one otherwise)
+ *  \param out where the kept half will be stored (in descending order)
+ *  \param n_threads number of threads of the merge
+ */
+static void compare_split(const kernel_ops_t *ops, const void *lower, const void *upper, int block, int keep_larger,
+                          void *out, int n_threads) {
+    if (n_threads > block) {
+        n_threads = block;
+    }
+    int first = keep_larger ? 0 : block;
+    int slice = (block + n_threads - 1) / n_threads;
+    split_slice_t *slices = (split_slice_t *) malloc(n_threads * sizeof(split_slice_t));
+    pthread_t *threads = (pthread_t *) malloc(n_threads * sizeof(pthread_t));
+    if (slices == NULL || threads == NULL) {
+        free(slices);
+        free(threads);
+        split_slice_t all = {ops, (const char *) lower, (const char *) upper, block, first, first + block, first,
+                             (char *) out};
+        split_slice(&all);
+        return;
+    }
+    for (int i = 0; i < n_threads; i++) {
+        int low = first + (i * slice < block ? i * slice : block);
+        int high = first + ((i + 1) * slice < block ? (i + 1) * slice : block);
+        slices[i] = (split_slice_t) {ops, (const char *) lower, (const char *) upper, block, low, high, first,
+                                     (char *) out};
+        if (pthread_create(&threads[i], NULL, split_slice, &slices[i]) != 0) {
+            fprintf(stderr, "[DIST] Could not create merge thread %d\n", i);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(slices);
+    free(threads);
+}
+
+/**
+ *  \brief Merges the sorted blocks of the ranks with the bitonic sorting network of the ranks.
+ *
+ *  At step j of stage k of the network, rank r compare-splits its block with the one of rank r ^ j. In the sub-merges
+ *  of descending order ((r & k) == 0), the lower rank keeps the larger half; in the others, it keeps the smaller one.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr where the pointer to the block is stored (swapped with the buffer after each step)
+ *  \param buf where the pointer to a buffer of a block is stored
+ *  \param recv buffer of a block, where the block of the partner is received
+ *  \param block number of elements of each block
+ *  \param elem elements of the array as an MPI datatype
+ *  \param rank rank of the calling process
+ *  \param n_ranks number of ranks (power of 2)
+ *  \param n_threads number of threads of each merge
+ *
+ *  \return number of steps done
+ */
+static int merge_blocks(const kernel_ops_t *ops, void **arr, void **buf, void *recv, int block, MPI_Datatype elem,
+                        int rank, int n_ranks, int n_threads) {
+    int n_steps = 0;
+    for (int k = 2; k <= n_ranks; k *= 2) {
+        for (int j = k / 2; j >= 1; j /= 2, n_steps++) {
+            int partner = rank ^ j;
+            MPI_Sendrecv(*arr, block, elem, partner, n_steps, recv, block, elem, partner, n_steps, MPI_COMM_WORLD,
+                         MPI_STATUS_IGNORE);
+            int is_lower = rank < partner;
+            int keep_larger = ((rank & k) == 0) == is_lower;
+            compare_split(ops, is_lower ? *arr : recv, is_lower ? recv : *arr, block, keep_larger, *buf, n_threads);
+            void *sorted = *buf;
+            *buf = *arr;
+            *arr = sorted;
+        }
+    }
+    return n_steps;
+}
+
+/**
+ *  \brief Checks that the blocks of the ranks are sorted, and that they have the elements of the input.
+ *
+ *  Each rank checks the order of its block, and of its last element with the first one of the next rank. The checksums
+ *  of the blocks are combined on rank 0.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr block of the calling rank
+ *  \param block number of elements of each block
+ *  \param elem elements of the array as an MPI datatype
+ *  \param rank rank of the calling process
+ *  \param n_ranks number of ranks
+ *  \param n_threads number of threads of the verification of each rank
+ *  \param input checksum of the input block of the calling rank
+ *
+ *  \return EXIT_SUCCESS if the array is sorted, EXIT_FAILURE otherwise (on every rank)
+ */
+static int check_blocks(const kernel_ops_t *ops, const void *arr, int block, MPI_Datatype elem, int rank, int n_ranks,
+                        int n_threads, const checksum_t *input) {
+    size_t elem_size = ops->elem_size;
+    checksum_t output;
+    int i = verify_parallel(ops, arr, block, DESCENDING, n_threads, &output);
+
+    // the first element of the next rank follows the last one of this rank
+    char *pair = (char *) malloc(2 * elem_size);
+    if (pair == NULL) {
+        fprintf(stderr, "[MAIN] Could not allocate memory for the verification\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    memcpy(pair, (const char *) arr + (size_t) (block - 1) * elem_size, elem_size);
+    int prev = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    int next = rank < n_ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+    MPI_Sendrecv(arr, 1, elem, prev, 0, pair + elem_size, 1, elem, next, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (i == -1 && next != MPI_PROC_NULL && ops->check(pair, 2, DESCENDING) != -1) {
+        i = block - 1;
+    }
+    if (i != -1) {
+        const void *second = i < block - 1 ? (const char *) arr + (size_t) (i + 1) * elem_size : pair + elem_size;
+        fprintf(stderr, "[MAIN] Error in position %lld between element ", (long long) rank * block + i);
+        ops->print(stderr, arr, i);
+        fprintf(stderr, " and ");
+        ops->print(stderr, second, 0);
+        fprintf(stderr, "\n");
+    }
+    free(pair);
+
+    // combine the checksums of the ranks
+    uint64_t sums[2] = {input->sum, output.sum};
+    uint64_t xor_sums[2] = {input->xor_sum, output.xor_sum};
+    uint64_t total_sums[2], total_xor_sums[2];
+    MPI_Reduce(sums, total_sums, 2, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(xor_sums, total_xor_sums, 2, MPI_UINT64_T, MPI_BXOR, 0, MPI_COMM_WORLD);
+    int status = all_ranks(i == -1 ? EXIT_SUCCESS : EXIT_FAILURE);
+    if (rank == 0 && status == EXIT_SUCCESS) {
+        if (total_sums[0] != total_sums[1] || total_xor_sums[0] != total_xor_sums[1]) {
+            fprintf(stderr, "[MAIN] The checksum of the array does not match the one of the input: elements were lost "
+                            "or duplicated\n");
+            status = EXIT_FAILURE;
+        } else {
+            printf("[MAIN] The array is sorted, everything is OK! :)\n");
+        }
+    }
+    MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return status;
+}
+
+/**
+ *  \brief Writes the sorted array to the output file, each rank its block, with a collective MPI-IO write.
+ *
+ *  Rank 0 creates the file, with the header of the input file.
+ *
+ *  \param out_path path to the output file
+ *  \param header header of the input file
+ *  \param arr block of the calling rank
+ *  \param block number of elements of each block
+ *  \param elem elements of the array as an MPI datatype
+ *  \param rank rank of the calling process
+ *
+ *  \return EXIT_SUCCESS if the file was written, EXIT_FAILURE otherwise
+ */
+static int write_parallel(char *out_path, const array_header_t *header, const void *arr, int block,
+                          MPI_Datatype elem, int rank) {
+    int status = EXIT_SUCCESS;
+    if (rank == 0) {
+        int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || write_array_header(fd, header) != EXIT_SUCCESS) {
+            status = EXIT_FAILURE;
+        }
+        if (fd != -1) close(fd);
+    }
+    MPI_File file;
+    if (all_ranks(status) != EXIT_SUCCESS
+        || MPI_File_open(MPI_COMM_WORLD, out_path, MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        fprintf(stderr, "[MAIN] Could not create the output file %s\n", out_path);
+        return EXIT_FAILURE;
+    }
+    size_t elem_size = kernel_ops(header->elem_type)->elem_size;
+    MPI_Offset offset = (MPI_Offset) header->size + (MPI_Offset) rank * block * (MPI_Offset) elem_size;
+    status = MPI_File_write_at_all(file, offset, arr, block, elem, MPI_STATUS_IGNORE) == MPI_SUCCESS
+             ? EXIT_SUCCESS : EXIT_FAILURE;
+    MPI_File_close(&file);
+    if (all_ranks(status) != EXIT_SUCCESS) {
+        fprintf(stderr, "[MAIN] Rank %d could not write the output file %s\n", rank, out_path);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Gathers the sorted array on rank 0, which writes it to the output file.
+ *
+ *  \param out_path path to the output file
+ *  \param header header of the input file
+ *  \param arr block of the calling rank
+ *  \param block number of elements of each block
+ *  \param elem elements of the array as an MPI datatype
+ *  \param rank rank of the calling process
+ *
+ *  \return EXIT_SUCCESS if the file was written, EXIT_FAILURE otherwise
+ */
+static int write_gathered(char *out_path, const array_header_t *header, const void *arr, int block, MPI_Datatype elem,
+                          int rank) {
+    size_t bytes = header->count * kernel_ops(header->elem_type)->elem_size;
+    char *all = rank == 0 ? (char *) malloc(bytes) : NULL;
+    if (all_ranks(rank == 0 && all == NULL ? EXIT_FAILURE : EXIT_SUCCESS) != EXIT_SUCCESS) {
+        fprintf(stderr, "[MAIN] Could not allocate memory for the gathered array\n");
+        return EXIT_FAILURE;
+    }
+    MPI_Gather(arr, block, elem, all, block, elem, 0, MPI_COMM_WORLD);
+    int status = EXIT_SUCCESS;
+    if (rank == 0) {
+        int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || write_array_header(fd, header) != EXIT_SUCCESS
+            || pwrite_fully(fd, all, bytes, (off_t) header->size) != EXIT_SUCCESS) {
+            fprintf(stderr, "[MAIN] Could not write the output file %s\n", out_path);
+            status = EXIT_FAILURE;
+        }
+        if (fd != -1) close(fd);
+        free(all);
+    }
+    return all_ranks(status);
+}
+
+/**
+ *  \brief Main function of the program.
+ *
+ *  Lifecycle:
+ *  - process command line options
+ *  - read the header of the input file, and the block of each rank (MPI-IO)
+ *  - sort the block of each rank with the threaded bitonic sort (bitonic_submit_typed, bitonic_wait)
+ *  - merge the blocks with the bitonic sorting network of the ranks (merge_blocks)
+ *  - check if the array is sorted
+ *  - write the output file, in parallel or gathered on rank 0
+ *
+ *  \param argc number of command line arguments
+ *  \param argv array of command line arguments
+ *
+ *  \return EXIT_SUCCESS if the array is sorted, EXIT_FAILURE otherwise
+ */
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank, n_ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+
+    // program arguments
+    char *cmd_name = argv[0];
+    char *file_path = NULL;
+    char *out_path = NULL;
+    int n_workers = N_WORKERS;
+    int use_simd = 1;
+    int gather = 0;
+
+    // process command line options
+    int opt;
+    int status = EXIT_SUCCESS;
+    while (status == EXIT_SUCCESS && (opt = getopt(argc, argv, "f:n:o:GSh")) != -1) {
+        switch (opt) {
+            case 'f':
+                file_path = optarg;
+                break;
+            case 'n':
+                n_workers = atoi(optarg);
+                if (n_workers < 1) {
+                    if (rank == 0) fprintf(stderr, "[MAIN] Invalid number of worker threads\n");
+                    status = EXIT_FAILURE;
+                }
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'G':
+                gather = 1;
+                break;
+            case 'S':
+                use_simd = 0;
+                break;
+            case 'h':
+                if (rank == 0) printUsage(cmd_name);
+                MPI_Finalize();
+                return EXIT_SUCCESS;
+            default:
+                status = EXIT_FAILURE;
+                break;
+        }
+    }
+    if (status == EXIT_SUCCESS && file_path == NULL) {
+        if (rank == 0) fprintf(stderr, "[MAIN] Input file not specified\n");
+        status = EXIT_FAILURE;
+    }
+    if (status == EXIT_SUCCESS && gather && out_path == NULL) {
+        if (rank == 0) fprintf(stderr, "[MAIN] The sorted array is only gathered (-G) into an output file (-o)\n");
+        status = EXIT_FAILURE;
+    }
+    if (status == EXIT_SUCCESS && (n_ranks & (n_ranks - 1)) != 0) {
+        if (rank == 0) fprintf(stderr, "[MAIN] The number of ranks must be a power of 2\n");
+        status = EXIT_FAILURE;
+    }
+    if (status != EXIT_SUCCESS) {
+        if (rank == 0) printUsage(cmd_name);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    const char *kernels = init_kernels(use_simd);
+    if (rank == 0) {
+        fprintf(stdout, "[MAIN] Input file: %s\n", file_path);
+        fprintf(stdout, "[MAIN] Ranks: %d\n", n_ranks);
+        fprintf(stdout, "[MAIN] Worker threads per rank: %d\n", n_workers);
+        fprintf(stdout, "[MAIN] Leaf kernels: %s\n", kernels);
+        if (out_path != NULL) {
+            fprintf(stdout, "[MAIN] Output file: %s (%s)\n", out_path, gather ? "gathered on rank 0" : "parallel");
+        }
+    }
+
+    // START LOAD TIME
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+
+    // read the header and the block of each rank
+    array_header_t header;
+    if (all_ranks(read_header(file_path, n_ranks, &header)) != EXIT_SUCCESS) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    const kernel_ops_t *ops = kernel_ops(header.elem_type);
+    int block = (int) (header.count / n_ranks);
+    size_t bytes = (size_t) block * ops->elem_size;
+    MPI_Datatype elem;
+    MPI_Type_contiguous((int) ops->elem_size, MPI_BYTE, &elem);
+    MPI_Type_commit(&elem);
+    void *arr = malloc(bytes);
+    void *buf = malloc(bytes);
+    void *recv = malloc(bytes);
+    if (all_ranks(arr == NULL || buf == NULL || recv == NULL ? EXIT_FAILURE : EXIT_SUCCESS) != EXIT_SUCCESS) {
+        if (rank == 0) fprintf(stderr, "[DIST] Could not allocate memory for the blocks\n");
+        free(arr);
+        free(buf);
+        free(recv);
+        MPI_Type_free(&elem);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    bitonic_pool_t *pool = bitonic_pool_create(n_workers);
+    if (all_ranks(pool == NULL || read_block(file_path, &header, rank, block, elem, arr) != EXIT_SUCCESS
+                  ? EXIT_FAILURE : EXIT_SUCCESS) != EXIT_SUCCESS) {
+        if (pool != NULL) bitonic_pool_destroy(pool);
+        free(arr);
+        free(buf);
+        free(recv);
+        MPI_Type_free(&elem);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    checksum_t input;
+    checksum_parallel(ops, arr, block, n_workers, &input);
+    if (rank == 0) {
+        fprintf(stdout, "[DIST] Array size: %llu (%d per rank)\n", (unsigned long long) header.count, block);
+        fprintf(stdout, "[DIST] Element type: %s\n", ops->name);
+    }
+
+    // END LOAD TIME, START TIME
+    MPI_Barrier(MPI_COMM_WORLD);
+    double now = MPI_Wtime();
+    if (rank == 0) fprintf(stdout, "[TIME] Load time: %.9f seconds\n", now - start);
+    start = now;
+
+    // sort the block of each rank, then merge the blocks across the ranks
+    bitonic_handle_t *handle = bitonic_submit_typed(pool, arr, block, header.elem_type, DESCENDING);
+    if (handle != NULL) {
+        bitonic_wait(handle);
+    }
+    bitonic_pool_destroy(pool);
+    if (all_ranks(handle != NULL ? EXIT_SUCCESS : EXIT_FAILURE) != EXIT_SUCCESS) {
+        free(arr);
+        free(buf);
+        free(recv);
+        MPI_Type_free(&elem);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    now = MPI_Wtime();
+    if (rank == 0) fprintf(stdout, "[TIME] Local sort time: %.9f seconds\n", now - start);
+    int n_steps = merge_blocks(ops, &arr, &buf, recv, block, elem, rank, n_ranks, n_workers);
+
+    // END TIME
+    MPI_Barrier(MPI_COMM_WORLD);
+    double elapsed = MPI_Wtime() - start;
+    if (rank == 0) {
+        fprintf(stdout, "[DIST] Bitonic merge of %d blocks in %d compare-split steps\n", n_ranks, n_steps);
+        fprintf(stdout, "[TIME] Time elapsed: %.9f seconds\n", elapsed);
+        fprintf(stdout, "[TIME] Time per element: %.3f ns\n", 1.0e9 * elapsed / (double) header.count);
+    }
+    free(recv);
+    free(buf);
+
+    // check if the array is sorted, then write it
+    start = MPI_Wtime();
+    status = check_blocks(ops, arr, block, elem, rank, n_ranks, n_workers, &input);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) fprintf(stdout, "[TIME] Verify time: %.9f seconds\n", MPI_Wtime() - start);
+    if (status == EXIT_SUCCESS && out_path != NULL) {
+        start = MPI_Wtime();
+        status = gather ? write_gathered(out_path, &header, arr, block, elem, rank)
+                        : write_parallel(out_path, &header, arr, block, elem, rank);
+        if (rank == 0) fprintf(stdout, "[TIME] Write time: %.9f seconds\n", MPI_Wtime() - start);
+    }
+    free(arr);
+    MPI_Type_free(&elem);
+    MPI_Finalize();
+    return status;
+}
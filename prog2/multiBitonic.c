@@ -9,13 +9,35 @@
  *  \author Rafael Gonçalves - March 2024
  */
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "const.h"
-#include "shared.c"
+#include "kernels.h"
+#include "bitonic.h"
+#include "shared.h"
+#include "arrfile.h"
+#include "extsort.h"
+#include "stats.h"
+#include "memory.h"
+#include "pipeline.h"
+#include "topk.h"
+#include "verify.h"
+
+/** \brief Names of the sort algorithms, indexed by ALGORITHM_* of const.h */
+static const char *algorithm_names[] = {"bitonic", "samplesort", "radix", "qsort", "serial", "mergesort"};
+
+/** \brief Operations of the element type compared by qsort_compare */
+static const kernel_ops_t *qsort_ops;
 
 /**
  *  \brief Prints the usage of the program.
@@ -25,10 +47,57 @@
 void printUsage(char *cmd_name) {
     fprintf(stderr, "Usage: %s REQUIRED OPTIONS\n"
                     "REQUIRED:\n"
-                    "-f --- input file with numbers\n"
+                    "-f --- input file with numbers (the element type is read from its header, see genData)\n"
                     "OPTIONS:\n"
                     "-h --- print this help\n"
-                    "-n --- number of worker threads (default is %d, minimum is 1)\n", cmd_name, N_WORKERS);
+                    "-n --- number of worker threads (default is %d, minimum is 1)\n"
+                    "-s --- scheduler: steal (work-stealing, default) or lockstep (distributor thread)\n"
+                    "-b --- synchronization of the lockstep scheduler: cond (mutex, default) or spin (spin/futex barrier)\n"
+                    "-a --- algorithm: bitonic (default), samplesort, mergesort or radix (integer keys), work-stealing scheduler\n"
+                    "       only, or the single-threaded baselines qsort (C library) and serial (bitonic sort kernel)\n"
+                    "-m --- external sort within a memory budget (bytes, or with a K, M or G suffix), requires -o\n"
+                    "-o --- output file for the sorted array (same format as the input file)\n"
+                    "-P --- pipelined load: each worker thread sorts its part as soon as it is read (lockstep scheduler)\n"
+                    "-k --- select the K largest elements instead of sorting the array (lockstep scheduler only)\n"
+                    "-A --- argsort: compute the indices of the elements in sorted order (stable, int32) instead of\n"
+                    "       sorting the array, and write them to the -o file (work-stealing scheduler only)\n"
+                    "-V --- verification of the result: serial (order, default), parallel (order and checksum of the\n"
+                    "       input and output elements, split among the worker threads) or none\n"
+                    "-H --- read the array into memory backed by huge pages, by one thread per worker thread\n"
+                    "-I --- read the array into memory interleaved across the NUMA nodes (with -H or alone)\n"
+                    "-p --- print the duration, busy and wait times of each phase (lockstep scheduler only)\n"
+                    "-T --- write the timeline of the phases to a Chrome trace file (lockstep scheduler only)\n"
+                    "-S --- use the scalar kernels even if the CPU supports the SIMD ones\n", cmd_name, N_WORKERS);
+}
+
+/**
+ *  \brief Parses a number of bytes, with an optional K, M or G suffix (powers of 1024).
+ *
+ *  \param text text to be parsed
+ *
+ *  \return number of bytes, 0 if the text is not valid
+ */
+static size_t parse_bytes(const char *text) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    switch (*end) {
+        case 'G':
+        case 'g':
+            value <<= 10;
+            // fall through
+        case 'M':
+        case 'm':
+            value <<= 10;
+            // fall through
+        case 'K':
+        case 'k':
+            value <<= 10;
+            end++;
+            break;
+        default:
+            break;
+    }
+    return *end == '\0' && end != text ? (size_t) value : 0;
 }
 
 /**
@@ -61,48 +130,281 @@ void free_all(void **pointers, int size) {
     }
 }
 
+/** \brief Slice of a file read by a thread into memory */
+typedef struct {
+    int fd;
+    char *dst;
+    size_t bytes;
+    off_t offset;
+    int part;
+    int n_parts;
+    int status;
+} read_slice_t;
+
 /**
- *  \brief Merges two halves of an integer array in the desired order.
+ *  \brief Thread function that reads a slice of a file into memory.
+ *
+ *  The thread is first pinned to the NUMA node of its part, so the pages it faults in are placed there.
+ *
+ *  \param arg pointer to the slice
  *
- *  \param arr array to be merged
- *  \param low_index index of the first element of the array
- *  \param count number of elements in the array
- *  \param direction 0 for descending order, 1 for ascending order
+ *  \return NULL
  */
-void bitonic_merge(int *arr, int low_index, int count, int direction) { // NOLINT(*-no-recursion)
-    if (count <= 1) return;
-    int half = count / 2;
-    // move the numbers to the correct half
-    for (int i = low_index; i < low_index + half; i++) {
-        if (direction == (arr[i] > arr[i + half])) {
-            int temp = arr[i];
-            arr[i] = arr[i + half];
-            arr[i + half] = temp;
+static void *read_slice(void *arg) {
+    read_slice_t *slice = (read_slice_t *) arg;
+    pin_to_node(slice->part, slice->n_parts);
+    slice->status = pread_fully(slice->fd, slice->dst, slice->bytes, slice->offset);
+    return NULL;
+}
+
+/**
+ *  \brief Reads a block of a file into memory, split among several threads.
+ *
+ *  The slices are multiples of READ_SLICE_ALIGN bytes, so the threads do not fault in the same pages. With one thread
+ *  per worker thread, slice i is about the partition of worker thread i, and is read on its NUMA node (pin_to_node).
+ *
+ *  \param fd file descriptor of the file
+ *  \param dst memory where the block is read to
+ *  \param bytes number of bytes of the block
+ *  \param offset offset of the block in the file
+ *  \param n_threads number of threads
+ *
+ *  \return EXIT_SUCCESS if the whole block was read, EXIT_FAILURE otherwise
+ */
+static int read_parallel(int fd, char *dst, size_t bytes, off_t offset, int n_threads) {
+    read_slice_t *slices = (read_slice_t *) malloc(n_threads * sizeof(read_slice_t));
+    pthread_t *threads = (pthread_t *) malloc(n_threads * sizeof(pthread_t));
+    if (slices == NULL || threads == NULL) {
+        free(slices);
+        free(threads);
+        return pread_fully(fd, dst, bytes, offset);
+    }
+    size_t slice = (bytes / n_threads + READ_SLICE_ALIGN - 1) / READ_SLICE_ALIGN * READ_SLICE_ALIGN;
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < n_threads; i++) {
+        size_t start = (size_t) i * slice < bytes ? (size_t) i * slice : bytes;
+        size_t end = start + slice < bytes ? start + slice : bytes;
+        slices[i] = (read_slice_t) {fd, dst + start, end - start, offset + (off_t) start, i, n_threads, EXIT_SUCCESS};
+        if (pthread_create(&threads[i], NULL, read_slice, &slices[i]) != 0) {
+            fprintf(stderr, "[DIST] Could not create reader thread %d\n", i);
+            exit(EXIT_FAILURE);
         }
     }
-    // merge left half
-    bitonic_merge(arr, low_index, half, direction);
-    // merge right half
-    bitonic_merge(arr, low_index + half, half, direction);
+    for (int i = 0; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+        status |= slices[i].status;
+    }
+    free(slices);
+    free(threads);
+    return status;
 }
 
 /**
- *  \brief Sorts an integer array in the desired order.
+ *  \brief Creates the output file and maps it into memory, with the array of the input file.
+ *
+ *  The output file gets the header of the input file and is mapped shared, so the array is sorted in place in the page
+ *  cache of the output file: the kernel writes the pages back while the sort goes on, and no write is left for the end.
+ *  The input array is read into the mapping by several threads, which also faults it in.
+ *
+ *  \param in_fd file descriptor of the input file
+ *  \param header header of the input file
+ *  \param bytes number of bytes of the array
+ *  \param out_path path to the output file
+ *  \param read_now whether the array is read into the mapping (0 if a pipelined load reads it)
+ *  \param n_threads number of threads that read the input file
+ *  \param arr where the pointer to the array will be stored
+ *  \param map where the pointer to the mapping will be stored
+ *  \param map_size where the size of the mapping will be stored
  *
- *  \param arr array to be sorted
- *  \param low_index index of the first element of the array
- *  \param count number of elements in the array
- *  \param direction 0 for descending order, 1 for ascending order
+ *  \return EXIT_SUCCESS if the array was loaded, EXIT_FAILURE otherwise
  */
-void bitonic_sort(int *arr, int low_index, int count, int direction) { // NOLINT(*-no-recursion)
-    if (count <= 1) return;
-    int half = count / 2;
-    // sort left half in ascending order
-    bitonic_sort(arr, low_index, half, ASCENDING);
-    // sort right half in descending order
-    bitonic_sort(arr, low_index + half, half, DESCENDING);
-    // merge the two halves
-    bitonic_merge(arr, low_index, count, direction);
+static int map_output(int in_fd, const array_header_t *header, size_t bytes, char *out_path, int read_now,
+                      int n_threads, void **arr, void **map, size_t *map_size) {
+    // the output file is only truncated once it is known not to be the input file, which is read afterwards
+    int out_fd = open(out_path, O_RDWR | O_CREAT, 0644);
+    if (out_fd != -1 && same_file(in_fd, out_fd)) {
+        fprintf(stderr, "[DIST] The output file %s is the input file\n", out_path);
+        close(out_fd);
+        return EXIT_FAILURE;
+    }
+    if (out_fd == -1 || ftruncate(out_fd, 0) != 0 || write_array_header(out_fd, header) != EXIT_SUCCESS
+        || ftruncate(out_fd, (off_t) (header->size + bytes)) != 0) {
+        fprintf(stderr, "[DIST] Could not create the output file %s\n", out_path);
+        if (out_fd != -1) close(out_fd);
+        return EXIT_FAILURE;
+    }
+    *map_size = header->size + bytes;
+    *map = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
+    close(out_fd);
+    if (*map == MAP_FAILED) {
+        fprintf(stderr, "[DIST] Could not map the output file %s\n", out_path);
+        return EXIT_FAILURE;
+    }
+    *arr = (char *) *map + header->size;
+    if (read_now && read_parallel(in_fd, *arr, bytes, (off_t) header->size, n_threads) != EXIT_SUCCESS) {
+        fprintf(stderr, "[DIST] Could not read the array\n");
+        munmap(*map, *map_size);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Reads the array of the input file into anonymous memory, with huge pages and NUMA placement.
+ *
+ *  The array is read by one thread per worker thread, each reading about the partition its worker thread sorts first,
+ *  pinned to the NUMA node of that worker thread, so that it is the first to touch those pages and places them on that
+ *  node (unless they are interleaved).
+ *
+ *  \param in_fd file descriptor of the input file
+ *  \param header header of the input file
+ *  \param bytes number of bytes of the array
+ *  \param mem_flags ARRAY_HUGE and/or ARRAY_INTERLEAVE (0 for base pages)
+ *  \param read_now whether the array is read into the memory (0 if a pipelined load reads it)
+ *  \param n_threads number of threads that read the input file
+ *  \param arr where the pointer to the array will be stored
+ *  \param map where the pointer to the mapping will be stored
+ *  \param map_size where the size of the mapping will be stored
+ *
+ *  \return EXIT_SUCCESS if the array was loaded, EXIT_FAILURE otherwise
+ */
+static int map_anonymous(int in_fd, const array_header_t *header, size_t bytes, int mem_flags, int read_now,
+                         int n_threads, void **arr, void **map, size_t *map_size) {
+    const char *kind;
+    int n_nodes;
+    *map = array_alloc(bytes, mem_flags, map_size, &kind, &n_nodes);
+    if (*map == NULL) {
+        fprintf(stderr, "[DIST] Could not allocate memory for the array\n");
+        return EXIT_FAILURE;
+    }
+    if (n_nodes > 0) {
+        fprintf(stdout, "[DIST] Array memory: %s, interleaved across %d NUMA nodes\n", kind, n_nodes);
+    } else {
+        fprintf(stdout, "[DIST] Array memory: %s%s\n", kind,
+                (mem_flags & ARRAY_INTERLEAVE) ? " (could not interleave them)" : "");
+    }
+    *arr = *map;
+    if (read_now && read_parallel(in_fd, *arr, bytes, (off_t) header->size, n_threads) != EXIT_SUCCESS) {
+        fprintf(stderr, "[DIST] Could not read the array\n");
+        munmap(*map, *map_size);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Maps the input file into memory.
+ *
+ *  The file is mapped privately, so the array is sorted in place without copying it and without modifying the file.
+ *  If the file cannot be mapped, the array is read into an allocated buffer with a single read.
+ *
+ *  The file starts with a header, see arrfile.h.
+ *
+ *  With an output file, the array is sorted directly in a shared mapping of the output file instead (see map_output).
+ *  With memory flags, it is read into anonymous memory instead (see map_anonymous).
+ *  With a pipelined load, the array is not read before returning: a reader thread is started that reads it one part
+ *  of the worker threads at a time (see pipeline.h), into the output file or into anonymous memory.
+ *
+ *  \param file_path path to the input file
+ *  \param out_path path to the output file (NULL for none)
+ *  \param mem_flags ARRAY_HUGE and/or ARRAY_INTERLEAVE (0 to map the file)
+ *  \param pipeline pointer to the pipelined load to be started (NULL to read the array before returning)
+ *  \param n_workers number of threads that read the input file into the output file or anonymous memory, and of parts
+ *  of the pipelined load
+ *  \param arr where the pointer to the array will be stored
+ *  \param size where the size of the array will be stored
+ *  \param elem_type where the type of the elements of the array will be stored
+ *  \param map where the pointer to the mapping will be stored (NULL if the array was allocated)
+ *  \param map_size where the size of the mapping will be stored
+ *
+ *  \return EXIT_SUCCESS if the array was loaded, EXIT_FAILURE otherwise
+ */
+static int map_array(char *file_path, char *out_path, int mem_flags, pipeline_t *pipeline, int n_workers, void **arr,
+                     int *size, int *elem_type, void **map, size_t *map_size) {
+    // open the file
+    int fd = open(file_path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        fprintf(stderr, "[DIST] Could not open file %s\n", file_path);
+        if (fd != -1) close(fd);
+        return EXIT_FAILURE;
+    }
+    // read the header of the file
+    array_header_t header;
+    if (read_array_header(fd, &header) != EXIT_SUCCESS) {
+        fprintf(stderr, "[DIST] Could not read the header of the file\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    uint64_t count = header.count;
+    size_t header_size = header.size;
+    *elem_type = header.elem_type;
+    const kernel_ops_t *ops = kernel_ops(*elem_type);
+    if (ops == NULL || *elem_type >= N_ELEM_TYPES) {
+        fprintf(stderr, "[DIST] Unknown element type %d\n", *elem_type);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    // size must be power of 2 (and fit the int indexes of the kernels)
+    if (count > INT_MAX || (count & (count - 1)) != 0) {
+        fprintf(stderr, "[DIST] The size of the array must be a power of 2\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    *size = (int) count;
+    fprintf(stdout, "[DIST] Array size: %d\n", *size);
+    fprintf(stdout, "[DIST] Element type: %s\n", ops->name);
+    size_t bytes = (size_t) *size * ops->elem_size;
+    if ((size_t) st.st_size < header_size + bytes) {
+        fprintf(stderr, "[DIST] The file is smaller than the size of the array\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    if (out_path != NULL || mem_flags != 0 || pipeline != NULL) {
+        int status = out_path != NULL
+                     ? map_output(fd, &header, bytes, out_path, pipeline == NULL, n_workers, arr, map, map_size)
+                     : map_anonymous(fd, &header, bytes, mem_flags, pipeline == NULL, n_workers, arr, map, map_size);
+        if (status == EXIT_SUCCESS && pipeline != NULL) {
+            // the parts of the worker threads (see bitonic_distributor)
+            int n_parts = *size < n_workers ? *size : n_workers;
+            size_t part_bytes = n_parts > 0 ? (size_t) (*size / n_parts) * ops->elem_size : bytes;
+            if (pipeline_start(pipeline, fd, *arr, bytes, (off_t) header_size, n_parts, part_bytes) != EXIT_SUCCESS) {
+                fprintf(stderr, "[DIST] Could not create the reader thread\n");
+                munmap(*map, *map_size);
+                status = EXIT_FAILURE;
+            }
+        }
+        close(fd);
+        return status;
+    }
+
+    // map the file privately (the header is followed by the array)
+    *map_size = header_size + bytes;
+    *map = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (*map != MAP_FAILED) {
+        *arr = (char *) *map + header_size;
+        close(fd);
+        return EXIT_SUCCESS;
+    }
+
+    // fall back to reading the file into memory
+    *map = NULL;
+    *map_size = 0;
+    *arr = malloc(bytes > 0 ? bytes : 1);
+    if (*arr == NULL) {
+        fprintf(stderr, "[DIST] Could not allocate memory for the array\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    if (pread_fully(fd, *arr, bytes, (off_t) header_size) != EXIT_SUCCESS) {
+        fprintf(stderr, "[DIST] Could not read the array\n");
+        free(*arr);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    return EXIT_SUCCESS;
 }
 
 /**
@@ -116,10 +418,19 @@ typedef struct {
 /**
  *  \brief Worker thread function that executes tasks.
  *
+ *  The thread is pinned to the NUMA node of its partition, where the threads that read the array placed its pages.
+ *
  *  Lifecycle loop:
  *  - get a task from the shared area
- *  - if the task is a sort task, sort the array
+ *  - if the task is a sort task, wait for its part to be read (pipelined load, folding its checksum with the parallel
+ *    verification) and sort it
  *  - if the task is a merge task, merge the array
+ *  - if the task is a merge level task, perform a slice of one level of a merge
+ *  - if the task is a load task, fault in a partition of the array (folding its checksum with the parallel
+ *    verification)
+ *  - if the task is a top-K task, wait for its part to be read (pipelined load) and select its top-K list
+ *  - if the task is a top-K merge task, merge the top-K list of another worker thread into its own
+ *  - record the task in the statistics, if any
  *  - if the task is a termination task, finish the thread
  *
  *  \param arg pointer to the argument structure, that contains the index of the worker thread and the shared area
@@ -128,32 +439,130 @@ static void *bitonic_worker(void *arg) {
     bitonic_worker_arg_t *worker_arg = (bitonic_worker_arg_t *) arg;
     int index = worker_arg->index;
     shared_t *shared = worker_arg->shared;
+    stats_t *stats = shared->stats;
+    pin_to_node(index, shared->config.n_workers);
 
-    while (1) {
+    for (int phase = 0;; phase++) {
+        uint64_t wait_begin = stats != NULL ? stats_now() : 0;
         task_t task = get_task(shared, index);
+        // with the pipelined load, a part is sorted as soon as it has been read
+        int loaded = (task.type != SORT_TASK && task.type != TOPK_TASK) || shared->pipeline == NULL || task.count == 0
+                     || pipeline_wait(shared->pipeline, task.low_index / task.count) == EXIT_SUCCESS;
+        uint64_t begin = stats != NULL ? stats_now() : 0;
+        const kernel_ops_t *ops = kernel_ops(task.elem_type);
         if (task.type == SORT_TASK) {
-            bitonic_sort(task.arr, task.low_index, task.count, task.direction);
-            task_done(shared, index);
+            if (loaded) {
+                if (shared->checksums != NULL && shared->pipeline != NULL) {
+                    checksum_fold(ops, task.arr, task.low_index, task.count, &shared->checksums[index]);
+                }
+                ops->sort(task.arr, task.low_index, task.count, task.direction);
+            }
         } else if (task.type == MERGE_TASK) {
-            bitonic_merge(task.arr, task.low_index, task.count, task.direction);
-            task_done(shared, index);
+            ops->merge_levels(task.arr, task.low_index, task.count, task.half, task.direction);
+        } else if (task.type == MERGE_LEVEL_TASK) {
+            ops->level_slice(task.arr, task.low_index, task.count, task.half, task.direction);
+        } else if (task.type == LOAD_TASK) {
+            // folding the checksum faults the pages in as well
+            if (shared->checksums != NULL) {
+                checksum_fold(ops, task.arr, task.low_index, task.count, &shared->checksums[index]);
+            } else {
+                touch_pages(task.arr, task.low_index, task.count, ops->elem_size);
+            }
+        } else if (task.type == TOPK_TASK) {
+            if (loaded && task.count > 0) {
+                void *top = (char *) shared->top + (size_t) index * 2 * shared->top_length * ops->elem_size;
+                topk_scan(ops, task.arr, task.low_index, task.count, top, shared->top_length);
+            }
+        } else if (task.type == TOPK_MERGE_TASK) {
+            if (task.count > 0) {
+                topk_merge(ops, task.arr, task.low_index, task.low_index + task.half, task.count, shared->top_length);
+            }
         } else {
             // termination task
             task_done(shared, index);
             break;
         }
+        if (stats != NULL) {
+            stats_task(stats, phase, index, &task, wait_begin, begin, stats_now());
+        }
+        task_done(shared, index);
     }
     return (void *) EXIT_SUCCESS;
 }
 
+/**
+ *  \brief Assigns the tasks of a phase to the worker threads, recording the phase in the statistics, if any.
+ *
+ *  \param shared pointer to the shared area
+ *  \param list pointer to the list of tasks, one per worker thread
+ *  \param type type of the tasks of the phase
+ *  \param block number of elements of the blocks sorted or merged in the phase
+ *  \param half distance between the compared elements of the first level of the phase (0 for the sort and load)
+ */
+static void set_phase(shared_t *shared, task_t *list, int type, int block, int half) {
+    uint64_t wait_begin = shared->stats != NULL ? stats_now() : 0;
+    set_tasks(shared, list, shared->config.n_workers);
+    if (shared->stats != NULL) {
+        stats_phase(shared->stats, type, block, half, wait_begin, stats_now());
+    }
+}
+
+/**
+ *  \brief Selects the top-K list of the array, in descending order, in the top buffer of the first worker thread.
+ *
+ *  Each worker thread selects the top-K list of its part (with the pipelined load, as soon as it has been read), and
+ *  the lists are then merged in pairs, in a tree reduction of log2(n_parts) phases.
+ *
+ *  \param shared pointer to the shared area, with the top buffers
+ *  \param list pointer to the list of tasks, one per worker thread
+ *  \param load pointer to the pipelined load (NULL if the array has been read)
+ *  \param n_parts number of parts of the array
+ *  \param part number of elements of each part
+ */
+static void select_top(shared_t *shared, task_t *list, pipeline_t *load, int n_parts, int part) {
+    void *arr = shared->config.arr;
+    int elem_type = shared->config.elem_type;
+    int n_workers = shared->config.n_workers;
+    int k = shared->top_length;
+
+    // make each worker thread select the top-K list of one part
+    for (int i = 0; i < n_workers; i++) {
+        task_t task = {TOPK_TASK, arr, i * part, i < n_parts ? part : 0, DESCENDING, 0, elem_type};
+        list[i] = task;
+    }
+    shared->pipeline = load;
+    set_phase(shared, list, TOPK_TASK, part, 0);
+    fprintf(stdout, "[DIST] Top-%d selection of %d parts of size %d%s\n", shared->config.top_k, n_parts, part,
+            load != NULL ? ", each as soon as it has been read" : "");
+
+    // merge the lists in pairs, each into the buffer of the worker thread with the lower index
+    int length = part < k ? part : k;
+    for (int step = 1; step < n_parts; step *= 2) {
+        for (int i = 0; i < n_workers; i++) {
+            int merges = i % (2 * step) == 0 && i + step < n_parts;
+            task_t task = {TOPK_MERGE_TASK, shared->top, i * 2 * k, merges ? length : 0, DESCENDING, step * 2 * k,
+                           elem_type};
+            list[i] = task;
+        }
+        set_phase(shared, list, TOPK_MERGE_TASK, length, 0);
+        fprintf(stdout, "[DIST] Top-K merge of %d lists of size %d\n", n_parts / step, length);
+        length = 2 * length < k ? 2 * length : k;
+    }
+}
+
 /**
  *  \brief Distributor thread function that assigns tasks to worker threads.
  *
  *  Lifecycle:
- *  - read the array from the file
- *  - divide the array into n_workers parts and assign a sort task to each worker thread
- *  - perform a bitonic merge of the sorted parts and assign a merge task to each worker thread
- *  - terminate worker threads that are not needed anymore
+ *  - map the array from the file into memory and make each worker thread fault in its partition, or, with the
+ *    pipelined load, start the reader thread of the array
+ *  - divide the array into n_workers parts and assign a sort task to each worker thread (with the pipelined load, each
+ *    worker thread sorts its part as soon as it has been read)
+ *  - perform a bitonic merge of the sorted parts, split among all the worker threads:
+ *    - the levels whose blocks span more than one part are split by index range, one slice per worker thread
+ *    - the remaining levels are independent sub-merges of each part, one per worker thread
+ *  - or, in top-K mode, select the top-K list of the array instead (see select_top)
+ *  - terminate the worker threads
  *
  *  \param arg pointer to the shared area
  */
@@ -162,116 +571,531 @@ static void *bitonic_distributor(void *arg) {
     char *file_path = shared->config.file_path;
     int direction = shared->config.direction;
     int n_workers = shared->config.n_workers;
+    pipeline_t pipeline;
+    pipeline_t *load = shared->config.pipelined ? &pipeline : NULL;
+    int status = EXIT_SUCCESS;
 
-    // open the file
-    FILE *file = fopen(file_path, "rb");
-    if (file == NULL) {
-        fprintf(stderr, "[DIST] Could not open file %s\n", file_path);
-        return (void *) EXIT_FAILURE;
-    }
-    // read the size of the array
-    int size;
-    if (fread(&size, sizeof(int), 1, file) != 1) {
-        fprintf(stderr, "[DIST] Could not read the size of the array\n");
-        fclose(file);
-        return (void *) EXIT_FAILURE;
-    }
-    // size must be power of 2
-    if ((size & (size - 1)) != 0) {
-        fprintf(stderr, "[DIST] The size of the array must be a power of 2\n");
-        fclose(file);
-        return (void *) EXIT_FAILURE;
-    }
-    fprintf(stdout, "[DIST] Array size: %d\n", size);
-    // allocate memory for the array
-    int *arr = (int *) malloc(size * sizeof(int));
-    if (arr == NULL) {
-        fprintf(stderr, "[DIST] Could not allocate memory for the array\n");
-        fclose(file);
+    // START LOAD TIME
+    get_delta_time();
+
+    // map the array into memory (or start reading it)
+    void *arr, *map;
+    int size, elem_type;
+    size_t map_size;
+    // in top-K mode, only the top-K list is written to the output file
+    char *out_path = shared->config.top_k > 0 ? NULL : shared->config.out_path;
+    if (map_array(file_path, out_path, shared->config.mem_flags, load, n_workers, &arr, &size, &elem_type, &map,
+                  &map_size) != EXIT_SUCCESS) {
         return (void *) EXIT_FAILURE;
     }
-    // load array into memory
-    int num, ni = 0;
-    while (fread(&num, sizeof(int), 1, file) == 1 && ni < size) {
-        arr[ni++] = num;
-    }
-    // close the file
-    fclose(file);
 
     // initialize the array to be sorted
-    init_arr(&shared->config, arr, size);
+    init_arr(&shared->config, arr, size, elem_type, map, map_size);
 
     // allocate memory for the list of tasks
     task_t *list = (task_t *) malloc(n_workers * sizeof(task_t));
     if (list == NULL) {
         fprintf(stderr, "[DIST] Could not allocate memory for the list of tasks\n");
-        free_all((void **) arr, 1);
+        if (load != NULL) {
+            pipeline_finish(load);
+        }
         return (void *) EXIT_FAILURE;
     }
 
-    // START TIME
-    get_delta_time();
+    // allocate memory for the top-K lists of the worker threads (2 * k elements each, k a power of 2)
+    if (shared->config.top_k > 0) {
+        int k = 1;
+        while (k < shared->config.top_k && k < size) k *= 2;
+        size_t n_elems = (size_t) n_workers * 2 * k;
+        shared->top_length = k;
+        shared->top = n_elems <= INT_MAX ? malloc(n_elems * kernel_ops(elem_type)->elem_size) : NULL;
+        if (shared->top == NULL) {
+            fprintf(stderr, "[DIST] Could not allocate memory for the top-K lists\n");
+            free(list);
+            if (load != NULL) {
+                pipeline_finish(load);
+            }
+            return (void *) EXIT_FAILURE;
+        }
+    }
+
+    // number of parts of the array (worker threads beyond it get empty tasks)
+    int n_parts = size < n_workers ? size : n_workers;
+    int part = n_parts > 0 ? size / n_parts : 0;
+
+    // make each worker thread fault in the partition it will sort, concurrently (the reader thread of the pipelined
+    // load faults it in as it reads it)
+    if (size > 1 && load == NULL) {
+        for (int i = 0; i < n_workers; i++) {
+            task_t task = {LOAD_TASK, arr, i * part, i < n_parts ? part : 0, 0, 0, elem_type};
+            list[i] = task;
+        }
+        set_phase(shared, list, LOAD_TASK, part, 0);
+        wait_tasks(shared);
+    }
+
+    // END LOAD TIME, START TIME
+    fprintf(stdout, "[TIME] Load time: %.9f seconds\n", get_delta_time());
 
-    if (size > 1) {
-        // divide the array into n_workers parts
+    if (shared->config.top_k > 0) {
+        select_top(shared, list, load, n_parts, part);
+    } else if (size > 1) {
+        // divide the array into n_parts parts
         // make each worker thread bitonic sort one part
-        int count = size / n_workers;
         for (int i = 0; i < n_workers; i++) {
-            int low_index = i * count;
+            int low_index = i * part;
             // direction of the sub-sort
-            int sub_direction = (((low_index / count) % 2 == 0) != 0) == direction;
-            task_t task = {SORT_TASK, arr, low_index, count, sub_direction};
+            int sub_direction = (((low_index / part) % 2 == 0) != 0) == direction;
+            task_t task = {SORT_TASK, arr, low_index, i < n_parts ? part : 0, sub_direction, 0, elem_type};
             list[i] = task;
         }
-        set_tasks(shared, list, n_workers);
-        fprintf(stdout, "[DIST] Bitonic sort of %d parts of size %d\n", n_workers, count);
-
-        // perform a bitonic merge of the sorted parts
-        // make each worker thread bitonic merge one part, discard unused threads
-        for (count *= 2; count <= size; count *= 2) {
-            int n_tasks = size / count;
-            // merge tasks
-            for (int i = 0; i < n_tasks; i++) {
-                int low_index = i * count;
-                // direction of the sub-merge
-                int sub_direction = (((low_index / count) % 2 == 0) != 0) == direction;
-                task_t task = {MERGE_TASK, arr, low_index, count, sub_direction};
-                list[i] = task;
+        shared->pipeline = load;
+        set_phase(shared, list, SORT_TASK, part, 0);
+        fprintf(stdout, "[DIST] Bitonic sort of %d parts of size %d%s\n", n_parts, part,
+                load != NULL ? ", each as soon as it has been read" : "");
+
+        // the merges need the whole array
+        if (load != NULL) {
+            wait_tasks(shared);
+            status = pipeline_finish(load);
+            shared->pipeline = load = NULL;
+        }
+
+        // perform a bitonic merge of the sorted parts, keeping every worker thread busy
+        for (int count = 2 * part; status == EXIT_SUCCESS && count <= size; count *= 2) {
+            int half = count / 2;
+            int n_split_levels = 0;
+            // levels whose blocks span more than one part: each worker thread does a slice of half a part
+            int slice = part > 1 ? part / 2 : 1;
+            int n_slices = size / 2 / slice;
+            for (; half >= part; half /= 2, n_split_levels++) {
+                for (int i = 0; i < n_workers; i++) {
+                    int pair_index = i * slice;
+                    int low_index = (pair_index / half) * 2 * half + pair_index % half;
+                    // direction of the sub-merge the slice belongs to
+                    int sub_direction = (((low_index / count) % 2 == 0) != 0) == direction;
+                    task_t task = {MERGE_LEVEL_TASK, arr, low_index, i < n_slices ? slice : 0, sub_direction,
+                                   half, elem_type};
+                    list[i] = task;
+                }
+                set_phase(shared, list, MERGE_LEVEL_TASK, count, half);
             }
-            // termination tasks
-            for (int i = n_tasks; i < n_workers; i++) {
-                task_t task = {TERMINATION_TASK};
-                list[i] = task;
+            // remaining levels: each worker thread merges the blocks of its own part
+            if (half >= 1) {
+                for (int i = 0; i < n_workers; i++) {
+                    int low_index = i * part;
+                    // direction of the sub-merge the part belongs to
+                    int sub_direction = (((low_index / count) % 2 == 0) != 0) == direction;
+                    task_t task = {MERGE_TASK, arr, low_index, i < n_parts ? part : 0, sub_direction, half, elem_type};
+                    list[i] = task;
+                }
+                set_phase(shared, list, MERGE_TASK, count, half);
             }
-            set_tasks(shared, list, n_workers);
-            fprintf(stdout, "[DIST] Bitonic merge of %d parts of size %d\n", n_tasks, count);
-            // update the number of workers
-            n_workers = n_tasks;
+            fprintf(stdout, "[DIST] Bitonic merge of %d parts of size %d (%d levels split among %d worker threads)\n",
+                    size / count, count, n_split_levels, n_slices);
         }
+    }
 
-        // termination task to last worker thread
+    // termination tasks, the worker threads only finish when the array is sorted
+    for (int i = 0; i < n_workers; i++) {
         task_t task = {TERMINATION_TASK};
-        list[0] = task;
-        set_tasks(shared, list, 1);
+        list[i] = task;
+    }
+    set_tasks(shared, list, n_workers);
+    wait_tasks(shared);
+    free(list);
+    if (load != NULL) {
+        status = pipeline_finish(load);
+    }
+    if (status != EXIT_SUCCESS) {
+        fprintf(stderr, "[DIST] Could not read the array\n");
+        return (void *) EXIT_FAILURE;
+    }
+    // arrays of 0 or 1 elements are neither loaded nor sorted by the worker threads
+    if (size <= 1 && shared->checksums != NULL) {
+        checksum_fold(kernel_ops(elem_type), arr, 0, size, &shared->checksums[0]);
     }
 
     // END TIME
-    fprintf(stdout, "[TIME] Time elapsed: %.9f seconds\n", get_delta_time());
+    double elapsed = get_delta_time();
+    fprintf(stdout, "[TIME] Time elapsed: %.9f seconds\n", elapsed);
+    fprintf(stdout, "[TIME] Time per element: %.3f ns\n", size > 0 ? 1.0e9 * elapsed / size : 0.0);
 
     return (void *) EXIT_SUCCESS;
 }
 
+/**
+ *  \brief Checks if the array is sorted in descending order, and reports the verify time.
+ *
+ *  With the parallel verification, the order is checked by several threads, which also compute the checksum of the
+ *  array, that must be the one of the input array (see verify.h).
+ *
+ *  \param arr array to be checked
+ *  \param size size of the array
+ *  \param elem_type type of the elements of the array
+ *  \param verify VERIFY_* of const.h
+ *  \param n_threads number of threads of the parallel verification
+ *  \param input checksum of the input array (NULL to only check the order)
+ *
+ *  \return EXIT_SUCCESS if the array is sorted (or not verified), EXIT_FAILURE otherwise
+ */
+static int check_array(void *arr, int size, int elem_type, int verify, int n_threads, const checksum_t *input) {
+    if (verify == VERIFY_NONE) {
+        printf("[MAIN] The array was not verified\n");
+        return EXIT_SUCCESS;
+    }
+    const kernel_ops_t *ops = kernel_ops(elem_type);
+    checksum_t output;
+    get_delta_time();
+    int i = verify == VERIFY_PARALLEL
+            ? verify_parallel(ops, arr, size, DESCENDING, n_threads, input != NULL ? &output : NULL)
+            : ops->check(arr, size, DESCENDING);
+    fprintf(stdout, "[TIME] Verify time: %.9f seconds\n", get_delta_time());
+    if (i != -1) {
+        fprintf(stderr, "[MAIN] Error in position %d between element ", i);
+        ops->print(stderr, arr, i);
+        fprintf(stderr, " and ");
+        ops->print(stderr, arr, i + 1);
+        fprintf(stderr, "\n");
+        return EXIT_FAILURE;
+    }
+    if (input != NULL && (output.sum != input->sum || output.xor_sum != input->xor_sum)) {
+        fprintf(stderr, "[MAIN] The checksum of the array does not match the one of the input: elements were lost or "
+                        "duplicated\n");
+        return EXIT_FAILURE;
+    }
+    printf("[MAIN] The array is sorted, everything is OK! :)\n");
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Writes an array to a file, with a header in the same format as the one of the input file (see arrfile.h).
+ *
+ *  \param file_path path to the input file
+ *  \param out_path path to the output file
+ *  \param arr array to be written
+ *  \param size number of elements of the array
+ *  \param elem_type type of the elements of the array
+ *
+ *  \return EXIT_SUCCESS if the array was written, EXIT_FAILURE otherwise
+ */
+static int write_array(char *file_path, char *out_path, const void *arr, int size, int elem_type) {
+    array_header_t header;
+    int in_fd = open(file_path, O_RDONLY);
+    int status = in_fd != -1 ? read_array_header(in_fd, &header) : EXIT_FAILURE;
+    if (in_fd != -1) close(in_fd);
+    header.count = (uint64_t) size;
+    int fd = status == EXIT_SUCCESS ? open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (fd == -1 || write_array_header(fd, &header) != EXIT_SUCCESS
+        || pwrite_fully(fd, arr, (size_t) size * kernel_ops(elem_type)->elem_size, (off_t) header.size)
+           != EXIT_SUCCESS) {
+        fprintf(stderr, "[MAIN] Could not write the output file %s\n", out_path);
+        if (fd != -1) close(fd);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Compares two elements for qsort, in descending order.
+ *
+ *  \param a pointer to the first element
+ *  \param b pointer to the second element
+ *
+ *  \return negative if a goes before b, positive if it goes after b, 0 if they are equal
+ */
+static int qsort_compare(const void *a, const void *b) {
+    return qsort_ops->less(a, b) - qsort_ops->less(b, a);
+}
+
+/**
+ *  \brief Sorts an array on the calling thread with one of the baselines.
+ *
+ *  \param arr pointer to the array
+ *  \param size number of elements in the array (0 or a power of 2)
+ *  \param elem_type type of the elements of the array
+ *  \param algorithm ALGORITHM_QSORT or ALGORITHM_SERIAL
+ */
+static void baseline_sort(void *arr, int size, int elem_type, int algorithm) {
+    const kernel_ops_t *ops = kernel_ops(elem_type);
+    if (algorithm == ALGORITHM_QSORT) {
+        qsort_ops = ops;
+        qsort(arr, size, ops->elem_size, qsort_compare);
+    } else if (size > 0) {
+        ops->sort(arr, 0, size, DESCENDING);
+    }
+}
+
+/**
+ *  \brief Sorts the array of a file with the work-stealing scheduler, through the bitonic sort library.
+ *
+ *  Lifecycle:
+ *  - create a pool of worker threads (bitonic_pool_create)
+ *  - map the array from the file into memory (or into the output file) and fault it in (bitonic_prefault), and compute
+ *    its checksum with the parallel verification
+ *  - sort the array in place with the algorithm (bitonic_submit_algorithm, bitonic_wait), or with a baseline on the
+ *    main thread (baseline_sort)
+ *  - terminate the worker threads and check if the array is sorted
+ *
+ *  \param file_path path to the input file
+ *  \param out_path path to the output file (NULL for none)
+ *  \param mem_flags ARRAY_HUGE and/or ARRAY_INTERLEAVE (0 to map the file)
+ *  \param n_workers number of worker threads
+ *  \param algorithm ALGORITHM_* of const.h
+ *  \param verify VERIFY_* of const.h
+ *
+ *  \return EXIT_SUCCESS if the array is sorted, EXIT_FAILURE otherwise
+ */
+static int steal_sort(char *file_path, char *out_path, int mem_flags, int n_workers, int algorithm, int verify) {
+    bitonic_pool_t *pool = bitonic_pool_create(n_workers);
+    if (pool == NULL) {
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "[MAIN] Worker threads have been created (%d/%d)\n", n_workers, n_workers);
+
+    // START LOAD TIME
+    get_delta_time();
+
+    // map the array into memory
+    void *arr, *map;
+    int size, elem_type;
+    size_t map_size;
+    if (map_array(file_path, out_path, mem_flags, NULL, n_workers, &arr, &size, &elem_type, &map, &map_size)
+        != EXIT_SUCCESS) {
+        bitonic_pool_destroy(pool);
+        return EXIT_FAILURE;
+    }
+    bitonic_prefault(pool, arr, size, elem_type);
+    checksum_t input;
+    if (verify == VERIFY_PARALLEL) {
+        checksum_parallel(kernel_ops(elem_type), arr, size, n_workers, &input);
+    }
+
+    // END LOAD TIME
+    fprintf(stdout, "[TIME] Load time: %.9f seconds\n", get_delta_time());
+    size_t aux_memory = bitonic_aux_memory(pool, size, elem_type, algorithm);
+    if (aux_memory > 0) {
+        fprintf(stdout, "[MAIN] Auxiliary memory: %.1f MiB\n", aux_memory / (1024.0 * 1024.0));
+    }
+
+    // START TIME
+    get_delta_time();
+    int baseline = algorithm == ALGORITHM_QSORT || algorithm == ALGORITHM_SERIAL;
+    bitonic_handle_t *handle = NULL;
+    if (baseline) {
+        baseline_sort(arr, size, elem_type, algorithm);
+    } else if ((handle = bitonic_submit_algorithm(pool, arr, size, elem_type, algorithm, DESCENDING)) != NULL) {
+        bitonic_wait(handle);
+    }
+
+    // END TIME
+    double elapsed = get_delta_time();
+    fprintf(stdout, "[TIME] Time elapsed: %.9f seconds\n", elapsed);
+    fprintf(stdout, "[TIME] Time per element: %.3f ns\n", size > 0 ? 1.0e9 * elapsed / size : 0.0);
+    fprintf(stdout, "[MAIN] Tasks stolen: %ld\n", bitonic_pool_steals(pool));
+
+    bitonic_pool_destroy(pool);
+    fprintf(stdout, "[MAIN] Worker threads have finished (%d/%d)\n", n_workers, n_workers);
+
+    int status = baseline || handle != NULL
+                 ? check_array(arr, size, elem_type, verify, n_workers, verify == VERIFY_PARALLEL ? &input : NULL)
+                 : EXIT_FAILURE;
+    if (map != NULL) {
+        munmap(map, map_size);
+    } else {
+        free(arr);
+    }
+    return status;
+}
+
+/**
+ *  \brief Checks the indices of an argsort: they must be a permutation, and keep equal elements in their order.
+ *
+ *  The order of the elements is checked on the array permuted by the indices, with check_array.
+ *
+ *  \param perm indices of the elements in sorted order
+ *  \param sorted array permuted by the indices (NULL if they are not verified)
+ *  \param size size of the array
+ *  \param elem_type type of the elements of the array
+ *  \param verify VERIFY_* of const.h
+ *  \param n_threads number of threads of the parallel verification
+ *  \param input checksum of the input array (NULL to only check the order)
+ *
+ *  \return EXIT_SUCCESS if the indices sort the array (or are not verified), EXIT_FAILURE otherwise
+ */
+static int check_argsort(const int *perm, void *sorted, int size, int elem_type, int verify, int n_threads,
+                         const checksum_t *input) {
+    if (verify == VERIFY_NONE) {
+        printf("[MAIN] The indices were not verified\n");
+        return EXIT_SUCCESS;
+    }
+    const kernel_ops_t *ops = kernel_ops(elem_type);
+    size_t elem_size = ops->elem_size;
+    char *seen = (char *) calloc(size > 0 ? size : 1, sizeof(char));
+    if (seen == NULL) {
+        fprintf(stderr, "[MAIN] Could not allocate memory for the verification of the indices\n");
+        return EXIT_FAILURE;
+    }
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < size && status == EXIT_SUCCESS; i++) {
+        if (perm[i] < 0 || perm[i] >= size || seen[perm[i]]) {
+            fprintf(stderr, "[MAIN] The indices are not a permutation: index %d in position %d\n", perm[i], i);
+            status = EXIT_FAILURE;
+        } else {
+            seen[perm[i]] = 1;
+        }
+    }
+    free(seen);
+    for (int i = 0; i + 1 < size && status == EXIT_SUCCESS; i++) {
+        const char *x = (const char *) sorted + (size_t) i * elem_size;
+        if (!ops->less(x, x + elem_size) && !ops->less(x + elem_size, x) && perm[i] > perm[i + 1]) {
+            fprintf(stderr, "[MAIN] Equal elements in positions %d and %d are not in the order of their indices\n", i,
+                    i + 1);
+            status = EXIT_FAILURE;
+        }
+    }
+    return status == EXIT_SUCCESS ? check_array(sorted, size, elem_type, verify, n_threads, input) : EXIT_FAILURE;
+}
+
+/**
+ *  \brief Writes the indices of an argsort to a file, with a typed header of 32-bit integers (see arrfile.h).
+ *
+ *  \param out_path path to the output file
+ *  \param perm indices of the elements in sorted order
+ *  \param size number of indices
+ *
+ *  \return EXIT_SUCCESS if the indices were written, EXIT_FAILURE otherwise
+ */
+static int write_indices(char *out_path, const int *perm, int size) {
+    array_header_t header = {1, ELEM_INT32, (uint64_t) size, 2 * sizeof(uint32_t) + sizeof(uint64_t)};
+    int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1 || write_array_header(fd, &header) != EXIT_SUCCESS
+        || pwrite_fully(fd, perm, (size_t) size * sizeof(int), (off_t) header.size) != EXIT_SUCCESS) {
+        fprintf(stderr, "[MAIN] Could not write the output file %s\n", out_path);
+        if (fd != -1) close(fd);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Computes the indices that sort the array of a file with the work-stealing scheduler (argsort).
+ *
+ *  Lifecycle:
+ *  - create a pool of worker threads (bitonic_pool_create)
+ *  - map the array from the file into memory and fault it in (bitonic_prefault), and compute its checksum with the
+ *    parallel verification
+ *  - compute the indices of the elements in sorted order with the algorithm (bitonic_submit_argsort, bitonic_wait)
+ *  - apply them to the array in parallel, as to any other column (bitonic_submit_permute), unless they are not verified
+ *  - terminate the worker threads, check the indices and write them to the output file
+ *
+ *  \param file_path path to the input file
+ *  \param out_path path to the output file of the indices (NULL for none)
+ *  \param mem_flags ARRAY_HUGE and/or ARRAY_INTERLEAVE (0 to map the file)
+ *  \param n_workers number of worker threads
+ *  \param algorithm ALGORITHM_* of const.h (not a baseline)
+ *  \param verify VERIFY_* of const.h
+ *
+ *  \return EXIT_SUCCESS if the indices sort the array, EXIT_FAILURE otherwise
+ */
+static int steal_argsort(char *file_path, char *out_path, int mem_flags, int n_workers, int algorithm, int verify) {
+    bitonic_pool_t *pool = bitonic_pool_create(n_workers);
+    if (pool == NULL) {
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "[MAIN] Worker threads have been created (%d/%d)\n", n_workers, n_workers);
+
+    // START LOAD TIME
+    get_delta_time();
+
+    // map the array into memory, it is not modified
+    void *arr, *map;
+    int size, elem_type;
+    size_t map_size;
+    if (map_array(file_path, NULL, mem_flags, NULL, n_workers, &arr, &size, &elem_type, &map, &map_size)
+        != EXIT_SUCCESS) {
+        bitonic_pool_destroy(pool);
+        return EXIT_FAILURE;
+    }
+    bitonic_prefault(pool, arr, size, elem_type);
+    checksum_t input;
+    if (verify == VERIFY_PARALLEL) {
+        checksum_parallel(kernel_ops(elem_type), arr, size, n_workers, &input);
+    }
+    size_t elem_size = kernel_ops(elem_type)->elem_size;
+    int *perm = (int *) malloc((size > 0 ? size : 1) * sizeof(int));
+    void *sorted = verify != VERIFY_NONE ? malloc((size > 0 ? size : 1) * elem_size) : NULL;
+
+    // END LOAD TIME
+    fprintf(stdout, "[TIME] Load time: %.9f seconds\n", get_delta_time());
+    fprintf(stdout, "[MAIN] Auxiliary memory: %.1f MiB\n",
+            bitonic_argsort_memory(pool, size, elem_type, algorithm) / (1024.0 * 1024.0));
+
+    // START TIME
+    get_delta_time();
+    bitonic_handle_t *handle = perm != NULL && (verify == VERIFY_NONE || sorted != NULL)
+                               ? bitonic_submit_argsort(pool, arr, size, elem_type, algorithm, DESCENDING, perm)
+                               : NULL;
+    if (handle != NULL) {
+        bitonic_wait(handle);
+    } else {
+        fprintf(stderr, "[MAIN] Could not compute the indices of the array\n");
+    }
+
+    // END TIME
+    double elapsed = get_delta_time();
+    fprintf(stdout, "[TIME] Time elapsed: %.9f seconds\n", elapsed);
+    fprintf(stdout, "[TIME] Time per element: %.3f ns\n", size > 0 ? 1.0e9 * elapsed / size : 0.0);
+    fprintf(stdout, "[MAIN] Tasks stolen: %ld\n", bitonic_pool_steals(pool));
+
+    // the indices are applied to the array like to any other column
+    int status = handle != NULL ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (status == EXIT_SUCCESS && sorted != NULL) {
+        if ((handle = bitonic_submit_permute(pool, perm, arr, sorted, size, elem_size)) != NULL) {
+            bitonic_wait(handle);
+            fprintf(stdout, "[TIME] Permute time: %.9f seconds\n", get_delta_time());
+        } else {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    bitonic_pool_destroy(pool);
+    fprintf(stdout, "[MAIN] Worker threads have finished (%d/%d)\n", n_workers, n_workers);
+
+    if (status == EXIT_SUCCESS) {
+        status = check_argsort(perm, sorted, size, elem_type, verify, n_workers,
+                               verify == VERIFY_PARALLEL ? &input : NULL);
+    }
+    if (status == EXIT_SUCCESS && out_path != NULL) {
+        status = write_indices(out_path, perm, size);
+    }
+    free(perm);
+    free(sorted);
+    if (map != NULL) {
+        munmap(map, map_size);
+    } else {
+        free(arr);
+    }
+    return status;
+}
+
 /**
  *  \brief Main function of the program.
  *
  *  Lifecycle:
  *  - process command line options
- *  - allocate memory for the shared area, configuration, tasks, list of tasks and list of threads done
- *  - initialize the configuration, tasks and shared area
- *  - create distributor thread
- *  - create worker threads
- *  - wait for threads to finish
- *  - check if the array is sorted
+ *  - with -A, compute the indices that sort the array with steal_argsort
+ *  - with the work-stealing scheduler, sort the array with steal_sort
+ *  - otherwise:
+ *    - allocate memory for the shared area, configuration, tasks, list of tasks, list of threads done and task slots
+ *    - initialize the configuration, tasks, shared area and synchronization mode
+ *    - create distributor thread
+ *    - create worker threads
+ *    - wait for threads to finish
+ *    - print the statistics and write the trace, if requested
+ *    - check if the array is sorted
  *
  *  \param argc number of command line arguments
  *  \param argv array of command line arguments
@@ -283,11 +1107,24 @@ int main(int argc, char *argv[]) {
     char *cmd_name = argv[0];
     char *file_path = NULL;
     int n_workers = N_WORKERS;
+    int use_simd = 1;
+    int scheduler = SCHEDULER_STEAL;
+    int sync_mode = SYNC_COND;
+    int algorithm = ALGORITHM_BITONIC;
+    size_t budget = 0;
+    char *out_path = NULL;
+    int print_stats = 0;
+    int mem_flags = 0;
+    int pipelined = 0;
+    int top_k = 0;
+    int argsort = 0;
+    int verify = VERIFY_SERIAL;
+    char *trace_path = NULL;
 
     // process command line options
     int opt;
     do {
-        switch ((opt = getopt(argc, argv, "f:n:"))) {
+        switch ((opt = getopt(argc, argv, "f:n:s:b:a:m:o:Pk:AV:HIpT:hS"))) {
             case 'f':
                 file_path = optarg;
                 if (file_path == NULL) {
@@ -304,6 +1141,94 @@ int main(int argc, char *argv[]) {
                     return EXIT_FAILURE;
                 }
                 break;
+            case 's':
+                if (strcmp(optarg, "steal") == 0) {
+                    scheduler = SCHEDULER_STEAL;
+                } else if (strcmp(optarg, "lockstep") == 0) {
+                    scheduler = SCHEDULER_LOCKSTEP;
+                } else {
+                    fprintf(stderr, "[MAIN] Invalid scheduler\n");
+                    printUsage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'b':
+                if (strcmp(optarg, "cond") == 0) {
+                    sync_mode = SYNC_COND;
+                } else if (strcmp(optarg, "spin") == 0) {
+                    sync_mode = SYNC_SPIN;
+                } else {
+                    fprintf(stderr, "[MAIN] Invalid synchronization mode\n");
+                    printUsage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'a':
+                algorithm = -1;
+                for (int i = 0; i < (int) (sizeof(algorithm_names) / sizeof(algorithm_names[0])); i++) {
+                    if (strcmp(optarg, algorithm_names[i]) == 0) {
+                        algorithm = i;
+                    }
+                }
+                if (algorithm == -1) {
+                    fprintf(stderr, "[MAIN] Invalid algorithm\n");
+                    printUsage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'm':
+                budget = parse_bytes(optarg);
+                if (budget == 0) {
+                    fprintf(stderr, "[MAIN] Invalid memory budget\n");
+                    printUsage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'P':
+                pipelined = 1;
+                break;
+            case 'k':
+                top_k = atoi(optarg);
+                if (top_k < 1) {
+                    fprintf(stderr, "[MAIN] Invalid number of largest elements\n");
+                    printUsage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'A':
+                argsort = 1;
+                break;
+            case 'V':
+                if (strcmp(optarg, "serial") == 0) {
+                    verify = VERIFY_SERIAL;
+                } else if (strcmp(optarg, "parallel") == 0) {
+                    verify = VERIFY_PARALLEL;
+                } else if (strcmp(optarg, "none") == 0) {
+                    verify = VERIFY_NONE;
+                } else {
+                    fprintf(stderr, "[MAIN] Invalid verification\n");
+                    printUsage(cmd_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'H':
+                mem_flags |= ARRAY_HUGE;
+                break;
+            case 'I':
+                mem_flags |= ARRAY_INTERLEAVE;
+                break;
+            case 'p':
+                print_stats = 1;
+                break;
+            case 'T':
+                trace_path = optarg;
+                break;
+            case 'S':
+                use_simd = 0;
+                break;
             case 'h':
                 printUsage(cmd_name);
                 return EXIT_SUCCESS;
@@ -322,6 +1247,78 @@ int main(int argc, char *argv[]) {
     }
     fprintf(stdout, "[MAIN] Input file: %s\n", file_path);
     fprintf(stdout, "[MAIN] Worker threads: %d\n", n_workers);
+    fprintf(stdout, "[MAIN] Leaf kernels: %s\n", init_kernels(use_simd));
+    fprintf(stdout, "[MAIN] Scheduler: %s\n", scheduler == SCHEDULER_STEAL ? "steal" : "lockstep");
+    fprintf(stdout, "[MAIN] Algorithm: %s\n", algorithm_names[algorithm]);
+    fprintf(stdout, "[MAIN] Verification: %s\n",
+            verify == VERIFY_PARALLEL ? "parallel" : verify == VERIFY_NONE ? "none" : "serial");
+
+    if (budget > 0 && out_path == NULL) {
+        fprintf(stderr, "[MAIN] The external sort needs an output file (-o)\n");
+        printUsage(cmd_name);
+        return EXIT_FAILURE;
+    }
+    if (out_path != NULL) {
+        fprintf(stdout, "[MAIN] Output file: %s\n", out_path);
+    }
+    if (mem_flags != 0 && ((out_path != NULL && !argsort) || budget > 0)) {
+        fprintf(stderr, "[MAIN] The array is only read into anonymous memory (-H, -I) without an output file (-o)\n");
+        return EXIT_FAILURE;
+    }
+    if (pipelined && (scheduler != SCHEDULER_LOCKSTEP || budget > 0)) {
+        fprintf(stderr, "[MAIN] The pipelined load (-P) only runs on the lockstep scheduler, without -m\n");
+        return EXIT_FAILURE;
+    }
+    if (top_k > 0 && (scheduler != SCHEDULER_LOCKSTEP || budget > 0)) {
+        fprintf(stderr, "[MAIN] The top-K selection (-k) only runs on the lockstep scheduler, without -m\n");
+        return EXIT_FAILURE;
+    }
+    if (argsort && (scheduler != SCHEDULER_STEAL || budget > 0 || top_k > 0)) {
+        fprintf(stderr, "[MAIN] The argsort (-A) only runs on the work-stealing scheduler, without -m or -k\n");
+        return EXIT_FAILURE;
+    }
+    if (argsort && (algorithm == ALGORITHM_QSORT || algorithm == ALGORITHM_SERIAL)) {
+        fprintf(stderr, "[MAIN] The argsort (-A) does not run the baselines\n");
+        return EXIT_FAILURE;
+    }
+    if (verify != VERIFY_SERIAL && budget > 0) {
+        fprintf(stderr, "[MAIN] The external sort checks its output while it merges it, without -V\n");
+        return EXIT_FAILURE;
+    }
+    if ((print_stats || trace_path != NULL) && scheduler != SCHEDULER_LOCKSTEP) {
+        fprintf(stderr, "[MAIN] The statistics (-p, -T) are only recorded by the lockstep scheduler\n");
+        return EXIT_FAILURE;
+    }
+    if (budget > 0) {
+        if (scheduler != SCHEDULER_STEAL) {
+            fprintf(stderr, "[MAIN] The external sort only runs on the work-stealing scheduler\n");
+            return EXIT_FAILURE;
+        }
+        if (algorithm == ALGORITHM_QSORT || algorithm == ALGORITHM_SERIAL) {
+            fprintf(stderr, "[MAIN] The external sort does not run the baselines\n");
+            return EXIT_FAILURE;
+        }
+        return external_sort(file_path, out_path, budget, n_workers, algorithm, DESCENDING);
+    }
+    if (argsort) {
+        return steal_argsort(file_path, out_path, mem_flags, n_workers, algorithm, verify);
+    }
+    if (scheduler == SCHEDULER_STEAL) {
+        return steal_sort(file_path, out_path, mem_flags, n_workers, algorithm, verify);
+    }
+    if (algorithm != ALGORITHM_BITONIC) {
+        fprintf(stderr, "[MAIN] The lockstep scheduler only runs the bitonic sort\n");
+        return EXIT_FAILURE;
+    }
+    // the parts of the worker threads must be powers of 2, like the array
+    if ((n_workers & (n_workers - 1)) != 0) {
+        fprintf(stderr, "[MAIN] The lockstep scheduler needs a power of 2 number of worker threads\n");
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "[MAIN] Synchronization: %s\n", sync_mode == SYNC_SPIN ? "spin" : "cond");
+    if (top_k > 0) {
+        fprintf(stdout, "[MAIN] Top-K: %d largest elements\n", top_k);
+    }
 
     // allocate memory for the configuration
     config_t *config = (config_t *) malloc(sizeof(config_t));
@@ -350,28 +1347,55 @@ int main(int argc, char *argv[]) {
         free_all((void *[]) {config, tasks, list}, 3);
         return EXIT_FAILURE;
     }
-    // allocate memory for the shared area
-    shared_t *shared = (shared_t *) malloc(sizeof(shared_t));
+    // allocate memory for the shared area (aligned, for its cache-line-aligned barrier)
+    shared_t *shared = (shared_t *) aligned_alloc(_Alignof(shared_t), sizeof(shared_t));
     if (shared == NULL) {
         fprintf(stderr, "[MAIN] Could not allocate memory for the shared area\n");
         free_all((void *[]) {config, tasks, list, is_thread_done}, 4);
         return EXIT_FAILURE;
     }
-    // initialize the configuration, tasks and shared area
-    init_config(config, file_path, DESCENDING, n_workers);
+    // allocate memory for the task slots of the worker threads
+    task_slot_t *slots = (task_slot_t *) aligned_alloc(_Alignof(task_slot_t), n_workers * sizeof(task_slot_t));
+    if (slots == NULL) {
+        fprintf(stderr, "[MAIN] Could not allocate memory for the task slots\n");
+        free_all((void *[]) {config, tasks, list, is_thread_done, shared}, 5);
+        return EXIT_FAILURE;
+    }
+    // initialize the configuration, tasks, shared area and synchronization mode
+    init_config(config, file_path, out_path, mem_flags, pipelined, top_k, DESCENDING, n_workers);
     init_tasks(tasks, list, n_workers, is_thread_done);
     init_shared(shared, config, tasks);
+    init_sync(shared, sync_mode, slots);
+    // checksums of the input folded by the worker threads (in top-K mode, the output is not a permutation of the input)
+    if (verify == VERIFY_PARALLEL && top_k == 0) {
+        shared->checksums = (checksum_t *) calloc(n_workers, sizeof(checksum_t));
+        if (shared->checksums == NULL) {
+            fprintf(stderr, "[MAIN] Could not allocate memory for the checksums\n");
+            free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots}, 6);
+            return EXIT_FAILURE;
+        }
+    }
+    stats_t *stats = NULL;
+    if (print_stats || trace_path != NULL) {
+        stats = stats_create(n_workers);
+        if (stats == NULL) {
+            fprintf(stderr, "[MAIN] Could not allocate memory for the statistics\n");
+            free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots}, 6);
+            return EXIT_FAILURE;
+        }
+        shared->stats = stats;
+    }
 
     // create distributor thread
     pthread_t *distributor = (pthread_t *) malloc(sizeof(pthread_t));
     if (distributor == NULL) {
         fprintf(stderr, "[MAIN] Could not allocate memory for the distributor thread\n");
-        free_all((void *[]) {config, tasks, list, is_thread_done, shared}, 5);
+        free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots}, 6);
         return EXIT_FAILURE;
     }
     if (pthread_create(distributor, NULL, bitonic_distributor, shared) != 0) {
         fprintf(stderr, "[MAIN] Could not create distributor thread\n");
-        free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor}, 6);
+        free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor}, 7);
         return EXIT_FAILURE;
     } else {
         fprintf(stdout, "[MAIN] Distributor thread has been created\n");
@@ -380,20 +1404,20 @@ int main(int argc, char *argv[]) {
     pthread_t *workers = (pthread_t *) malloc(n_workers * sizeof(pthread_t));
     if (workers == NULL) {
         fprintf(stderr, "[MAIN] Could not allocate memory for the worker threads\n");
-        free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor}, 6);
+        free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor}, 7);
         return EXIT_FAILURE;
     }
     bitonic_worker_arg_t *workers_arg = (bitonic_worker_arg_t *) malloc(n_workers * sizeof(bitonic_worker_arg_t));
     if (workers_arg == NULL) {
         fprintf(stderr, "[MAIN] Could not allocate memory for the worker threads arguments\n");
-        free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor, workers}, 7);
+        free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor, workers}, 8);
         return EXIT_FAILURE;
     }
     for (int i = 0; i < n_workers; i++) {
         workers_arg[i] = (bitonic_worker_arg_t) {i, shared};
         if (pthread_create(&workers[i], NULL, bitonic_worker, &workers_arg[i]) != 0) {
             fprintf(stderr, "[MAIN] Could not create worker thread %d\n", i + 1);
-            free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor, workers, workers_arg}, 8);
+            free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor, workers, workers_arg}, 9);
             return EXIT_FAILURE;
         } else {
             fprintf(stdout, "[MAIN] Worker threads have been created (%d/%d)\n", i + 1, n_workers);
@@ -401,43 +1425,80 @@ int main(int argc, char *argv[]) {
     }
 
     // wait for threads to finish
+    // the threads return their exit code as the pointer itself, which must not be dereferenced
     void *ptr_retcode_void;
-    int *ptr_retcode_int;
+    int retcode;
     pthread_join(*distributor, &ptr_retcode_void);
-    ptr_retcode_int = (int *) ptr_retcode_void;
-    if (ptr_retcode_int != EXIT_SUCCESS) {
-        fprintf(stderr, "[MAIN] Distributor thread has failed with return code %d\n", *ptr_retcode_int);
-        free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor, workers, workers_arg}, 8);
+    retcode = (int) (intptr_t) ptr_retcode_void;
+    if (retcode != EXIT_SUCCESS) {
+        fprintf(stderr, "[MAIN] Distributor thread has failed with return code %d\n", retcode);
+        free(shared->top);
+        free(shared->checksums);
+        free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor, workers, workers_arg}, 9);
         return EXIT_FAILURE;
     } else {
         fprintf(stdout, "[MAIN] Distributor thread has finished\n");
     }
     for (int i = 0; i < n_workers; i++) {
         pthread_join(workers[i], &ptr_retcode_void);
-        ptr_retcode_int = (int *) ptr_retcode_void;
-        if (ptr_retcode_int != EXIT_SUCCESS) {
-            fprintf(stderr, "[MAIN] Worker thread %d has failed with return code %d\n", i + 1,
-                    *ptr_retcode_int);
-            free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor, workers, workers_arg}, 8);
+        retcode = (int) (intptr_t) ptr_retcode_void;
+        if (retcode != EXIT_SUCCESS) {
+            fprintf(stderr, "[MAIN] Worker thread %d has failed with return code %d\n", i + 1, retcode);
+            free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor, workers, workers_arg}, 9);
             return EXIT_FAILURE;
         } else {
             fprintf(stdout, "[MAIN] Worker threads have finished (%d/%d)\n", i + 1, n_workers);
         }
     }
 
-    // check if array is sorted
-    int *arr = shared->config.arr;
+    // print the statistics and write the trace
+    if (stats != NULL) {
+        if (print_stats) {
+            stats_print(stats, stdout);
+        }
+        if (trace_path != NULL && stats_write_trace(stats, trace_path) != EXIT_SUCCESS) {
+            fprintf(stderr, "[MAIN] Could not write the trace file %s\n", trace_path);
+        } else if (trace_path != NULL) {
+            fprintf(stdout, "[MAIN] Trace file: %s\n", trace_path);
+        }
+        stats_destroy(stats);
+    }
+
+    // check if array is sorted (in top-K mode, the top-K list), and write the top-K list to the output file
+    void *arr = shared->config.arr;
     int size = shared->config.size;
-    for (int i = 0; i < size - 1; i++) {
-        if (arr[i] < arr[i + 1]) {
-            fprintf(stderr, "[MAIN] Error in position %d between element %d and %d\n",
-                    i, arr[i], arr[i + 1]);
-            free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor, workers, workers_arg}, 8);
-            return EXIT_FAILURE;
+    int elem_type = shared->config.elem_type;
+    int status = EXIT_SUCCESS;
+    if (top_k > 0) {
+        int length = top_k < size ? top_k : size;
+        if (length > 0) {
+            fprintf(stdout, "[MAIN] K-th largest element: ");
+            kernel_ops(elem_type)->print(stdout, shared->top, length - 1);
+            fprintf(stdout, "\n");
+        }
+        status = check_array(shared->top, length, elem_type, verify, n_workers, NULL);
+        if (status == EXIT_SUCCESS && out_path != NULL) {
+            status = write_array(file_path, out_path, shared->top, length, elem_type);
+        }
+        free(shared->top);
+    } else {
+        checksum_t input = {0, 0};
+        for (int i = 0; shared->checksums != NULL && i < n_workers; i++) {
+            checksum_combine(&input, &shared->checksums[i]);
         }
+        status = check_array(arr, size, elem_type, verify, n_workers, shared->checksums != NULL ? &input : NULL);
+        free(shared->checksums);
+    }
+    if (status != EXIT_SUCCESS) {
+        free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor, workers, workers_arg}, 9);
+        return EXIT_FAILURE;
     }
-    printf("[MAIN] The array is sorted, everything is OK! :)\n");
 
-    free_all((void *[]) {config, tasks, list, is_thread_done, shared, distributor, workers, workers_arg, arr}, 9);
+    if (shared->config.map != NULL) {
+        munmap(shared->config.map, shared->config.map_size);
+    } else {
+        free(arr);
+    }
+    free_all((void *[]) {config, tasks, list, is_thread_done, shared, slots, distributor, workers, workers_arg}, 9);
     return EXIT_SUCCESS;
 }
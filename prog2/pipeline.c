@@ -0,0 +1,134 @@
+/**
+ *  \file pipeline.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the pipelined load of the array.
+ *
+ *  A reader thread reads the array from the input file one partition at a time, in large blocks, asking the kernel to
+ *  read the next partition ahead while it copies the current one. Each worker thread waits only for the partition it
+ *  sorts, so the first partitions are sorted while the others are still being read.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "arrfile.h"
+#include "memory.h"
+#include "pipeline.h"
+
+/**
+ *  \brief Reader thread function that reads the partitions of the array in order.
+ *
+ *  Before each partition, the thread is pinned to the NUMA node of the partition (pin_to_node), so its pages are placed
+ *  on the node of the worker thread that sorts it. After each partition, the worker threads waiting for it are woken
+ *  up. If a read fails, all the worker threads are woken up, and see the failure.
+ *
+ *  \param arg pointer to the pipelined load
+ */
+static void *pipeline_reader(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *) arg;
+    posix_fadvise(pipeline->fd, pipeline->offset, (off_t) pipeline->bytes, POSIX_FADV_SEQUENTIAL);
+    int status = EXIT_SUCCESS;
+    for (int part = 0; part < pipeline->n_parts && status == EXIT_SUCCESS; part++) {
+        size_t begin = part * pipeline->part_bytes;
+        size_t end = part == pipeline->n_parts - 1 ? pipeline->bytes : begin + pipeline->part_bytes;
+        pin_to_node(part, pipeline->n_parts);
+        // the kernel reads the next partition while this one is copied
+        if (end < pipeline->bytes) {
+            posix_fadvise(pipeline->fd, pipeline->offset + (off_t) end, (off_t) pipeline->part_bytes,
+                          POSIX_FADV_WILLNEED);
+        }
+        for (size_t done = begin; done < end && status == EXIT_SUCCESS; done += PIPELINE_READ_BLOCK) {
+            size_t n = end - done < PIPELINE_READ_BLOCK ? end - done : PIPELINE_READ_BLOCK;
+            status = pread_fully(pipeline->fd, pipeline->dst + done, n, pipeline->offset + (off_t) done);
+        }
+        pthread_mutex_lock(&pipeline->mutex);
+        if (status == EXIT_SUCCESS) {
+            pipeline->n_ready = part + 1;
+        } else {
+            pipeline->failed = 1;
+            pipeline->n_ready = pipeline->n_parts;
+        }
+        pthread_cond_broadcast(&pipeline->ready);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+    return NULL;
+}
+
+/**
+ *  \brief Starts the reader thread of a pipelined load.
+ *
+ *  \param pipeline pointer to the pipelined load
+ *  \param fd file descriptor of the input file (duplicated, the caller may close it)
+ *  \param dst where the array will be stored
+ *  \param bytes number of bytes of the array
+ *  \param offset offset of the array in the file
+ *  \param n_parts number of partitions of the array
+ *  \param part_bytes number of bytes of each partition (the last one extends to the end of the array)
+ *
+ *  \return EXIT_SUCCESS if the reader thread was started, EXIT_FAILURE otherwise
+ */
+int pipeline_start(pipeline_t *pipeline, int fd, void *dst, size_t bytes, off_t offset, int n_parts,
+                   size_t part_bytes) {
+    pipeline->fd = dup(fd);
+    if (pipeline->fd == -1) {
+        return EXIT_FAILURE;
+    }
+    pipeline->dst = (char *) dst;
+    pipeline->offset = offset;
+    pipeline->bytes = bytes;
+    pipeline->n_parts = n_parts > 0 ? n_parts : 1;
+    pipeline->part_bytes = part_bytes;
+    pipeline->n_ready = 0;
+    pipeline->failed = 0;
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_cond_init(&pipeline->ready, NULL);
+    if (pthread_create(&pipeline->reader, NULL, pipeline_reader, pipeline) != 0) {
+        pthread_mutex_destroy(&pipeline->mutex);
+        pthread_cond_destroy(&pipeline->ready);
+        close(pipeline->fd);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Waits until a partition of the array has been read.
+ *
+ *  \param pipeline pointer to the pipelined load
+ *  \param part index of the partition
+ *
+ *  \return EXIT_SUCCESS if the partition was read, EXIT_FAILURE if the read failed
+ */
+int pipeline_wait(pipeline_t *pipeline, int part) {
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->n_ready <= part) {
+        pthread_cond_wait(&pipeline->ready, &pipeline->mutex);
+    }
+    int failed = pipeline->failed;
+    pthread_mutex_unlock(&pipeline->mutex);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Waits for the reader thread of a pipelined load to finish, and frees its resources.
+ *
+ *  \param pipeline pointer to the pipelined load
+ *
+ *  \return EXIT_SUCCESS if the whole array was read, EXIT_FAILURE otherwise
+ */
+int pipeline_finish(pipeline_t *pipeline) {
+    pthread_join(pipeline->reader, NULL);
+    int failed = pipeline->failed;
+    pthread_mutex_destroy(&pipeline->mutex);
+    pthread_cond_destroy(&pipeline->ready);
+    close(pipeline->fd);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+/**
+ *  \file pipeline.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the pipelined load of the array.
+ *
+ *  A reader thread reads the array from the input file one partition at a time, in large blocks, asking the kernel to
+ *  read the next partition ahead while it copies the current one. Each worker thread waits only for the partition it
+ *  sorts, so the first partitions are sorted while the others are still being read.
+ *
+ *  Operations:
+ *  - pipeline_start: starts the reader thread
+ *  - pipeline_wait: waits until a partition has been read
+ *  - pipeline_finish: waits for the reader thread to finish
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/** \brief Structure that represents the pipelined load of an array */
+typedef struct pipeline {
+    int fd;
+    char *dst;
+    off_t offset;
+    size_t bytes;
+    int n_parts;
+    size_t part_bytes;
+    pthread_t reader;
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;
+    int n_ready;
+    int failed;
+} pipeline_t;
+
+/**
+ *  \brief Starts the reader thread of a pipelined load.
+ *
+ *  \param pipeline pointer to the pipelined load
+ *  \param fd file descriptor of the input file (duplicated, the caller may close it)
+ *  \param dst where the array will be stored
+ *  \param bytes number of bytes of the array
+ *  \param offset offset of the array in the file
+ *  \param n_parts number of partitions of the array
+ *  \param part_bytes number of bytes of each partition (the last one extends to the end of the array)
+ *
+ *  \return EXIT_SUCCESS if the reader thread was started, EXIT_FAILURE otherwise
+ */
+int pipeline_start(pipeline_t *pipeline, int fd, void *dst, size_t bytes, off_t offset, int n_parts,
+                   size_t part_bytes);
+
+/**
+ *  \brief Waits until a partition of the array has been read.
+ *
+ *  \param pipeline pointer to the pipelined load
+ *  \param part index of the partition
+ *
+ *  \return EXIT_SUCCESS if the partition was read, EXIT_FAILURE if the read failed
+ */
+int pipeline_wait(pipeline_t *pipeline, int part);
+
+/**
+ *  \brief Waits for the reader thread of a pipelined load to finish, and frees its resources.
+ *
+ *  \param pipeline pointer to the pipelined load
+ *
+ *  \return EXIT_SUCCESS if the whole array was read, EXIT_FAILURE otherwise
+ */
+int pipeline_finish(pipeline_t *pipeline);
+
+#endif /* PIPELINE_H */
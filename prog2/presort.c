@@ -0,0 +1,296 @@
+/**
+ *  \file presort.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the adaptive pre-scan of the arrays sorted by the bitonic sort.
+ *
+ *  Each phase forks one task per chunk or segment of the array and continues with the next phase, like the sample
+ *  sort. The state shared by the tasks of a pre-scan lives in a single structure, freed by the last phase.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "steal.h"
+#include "merge.h"
+#include "presort.h"
+
+/** \brief Phase of the pre-scan: fork the scan of each chunk */
+#define SCAN_PHASE 0
+
+/** \brief Phase of the pre-scan: scan a chunk */
+#define SCAN_CHUNK_PHASE 1
+
+/** \brief Phase of the pre-scan: decide what to do with the array */
+#define DECIDE_PHASE 2
+
+/** \brief Phase of the pre-scan: reverse a segment of the array */
+#define REVERSE_PHASE 3
+
+/** \brief Phase of the pre-scan: merge a segment of the output of a round of merges */
+#define MERGE_PHASE 4
+
+/** \brief Phase of the pre-scan: start the next round of merges */
+#define ROUND_PHASE 5
+
+/** \brief Phase of the pre-scan: copy a segment of the merged runs back to the array */
+#define COPY_PHASE 6
+
+/** \brief Phase of the pre-scan: free the state of the pre-scan */
+#define FINISH_PHASE 7
+
+/** \brief State shared by the tasks of a pre-scan */
+typedef struct {
+    const kernel_ops_t *ops;
+    steal_task_t *sort;
+    char *arr;
+    char *aux;
+    int size;
+    int direction;
+    int n_chunks;
+    int chunk;
+    atomic_int n_breaks;
+    atomic_int n_inversions;
+    atomic_int gave_up;
+    int *breaks;
+    int *n_chunk_breaks;
+    merge_runs_t runs;
+    int starts[PRESORT_MAX_RUNS + 1];
+} presort_t;
+
+static void run_presort_job(steal_pool_t *pool, steal_task_t *header);
+
+/**
+ *  \brief Frees the state of a pre-scan.
+ *
+ *  \param presort state of the pre-scan
+ */
+static void free_presort(presort_t *presort) {
+    free(presort->aux);
+    free(presort->breaks);
+    free(presort->n_chunk_breaks);
+    free(presort);
+}
+
+/**
+ *  \brief Scans a chunk of an array for the pairs of adjacent elements out of order.
+ *
+ *  Each pair whose second element goes before the first one in the order of the sort is a break between two sorted
+ *  runs; the first PRESORT_MAX_RUNS of the chunk are recorded. Each pair whose first element goes before the second one
+ *  is an inversion, which rules out an array sorted in the opposite order. The chunk includes the pair across its end.
+ *
+ *  \param presort state of the pre-scan
+ *  \param index index of the chunk
+ */
+static void scan_chunk(presort_t *presort, int index) {
+    const kernel_ops_t *ops = presort->ops;
+    int low_index = index * presort->chunk;
+    int end = low_index + presort->chunk < presort->size - 1 ? low_index + presort->chunk : presort->size - 1;
+    int *breaks = presort->breaks + (size_t) index * PRESORT_MAX_RUNS;
+    int n_breaks = 0, n_inversions = 0, inverted = 0;
+    for (int block = low_index; block < end && !atomic_load_explicit(&presort->gave_up, memory_order_relaxed);
+         block += PRESORT_SCAN_BLOCK) {
+        int block_end = end - block < PRESORT_SCAN_BLOCK ? end : block + PRESORT_SCAN_BLOCK;
+        int found = ops->find_breaks(presort->arr, block, block_end - block, presort->direction, breaks + n_breaks,
+                                     PRESORT_MAX_RUNS - n_breaks, &inverted);
+        if (found > 0) {
+            n_breaks += found;
+            atomic_fetch_add_explicit(&presort->n_breaks, found, memory_order_relaxed);
+        }
+        if (inverted && n_inversions == 0) {
+            n_inversions = 1;
+            atomic_fetch_add_explicit(&presort->n_inversions, 1, memory_order_relaxed);
+        }
+        // too many runs, and not sorted in the opposite order either: the array has to be sorted
+        if (atomic_load_explicit(&presort->n_breaks, memory_order_relaxed) >= PRESORT_MAX_RUNS
+            && atomic_load_explicit(&presort->n_inversions, memory_order_relaxed) > 0) {
+            atomic_store_explicit(&presort->gave_up, 1, memory_order_relaxed);
+        }
+    }
+    presort->n_chunk_breaks[index] = n_breaks;
+}
+
+/**
+ *  \brief Reverses a segment of an array: swaps the elements of a range of its first half with their mirrors.
+ *
+ *  Inlined with a constant element size, so the swap of each pair is two loads and two stores.
+ *
+ *  \param arr array
+ *  \param size number of elements in the array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param elem_size number of bytes of an element
+ */
+static inline void reverse_elems(char *arr, int size, int low_index, int count, size_t elem_size) {
+    char tmp[sizeof(record_t)];
+    for (int i = low_index; i < low_index + count; i++) {
+        char *x = arr + (size_t) i * elem_size;
+        char *y = arr + (size_t) (size - 1 - i) * elem_size;
+        memcpy(tmp, x, elem_size);
+        memcpy(x, y, elem_size);
+        memcpy(y, tmp, elem_size);
+    }
+}
+
+/**
+ *  \brief Starts the next round of merges of the runs, or finishes them.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header task that forks the round
+ *  \param presort state of the pre-scan
+ */
+static void next_round(steal_pool_t *pool, steal_task_t *header, presort_t *presort) {
+    int n_segments = (presort->size + STEAL_GRAIN_SIZE - 1) / STEAL_GRAIN_SIZE;
+    if (presort->runs.n_runs > 1) {
+        steal_fork_phase(pool, header, MERGE_PHASE, n_segments, ROUND_PHASE);
+    } else if (presort->runs.src != presort->arr) {
+        steal_fork_phase(pool, header, COPY_PHASE, n_segments, FINISH_PHASE);
+    } else {
+        free_presort(presort);
+        steal_done(pool, header);
+    }
+}
+
+/**
+ *  \brief Decides what to do with the array after the scan: nothing, reverse it, merge its runs or sort it.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header task that decides
+ *  \param presort state of the pre-scan
+ */
+static void decide(steal_pool_t *pool, steal_task_t *header, presort_t *presort) {
+    int n_breaks = atomic_load(&presort->n_breaks);
+    int sorted_opposite = atomic_load(&presort->n_inversions) == 0;
+    if (n_breaks == 0) {
+        // already sorted
+        free(presort->sort);
+        free_presort(presort);
+        steal_done(pool, header);
+        return;
+    }
+    if (sorted_opposite) {
+        free(presort->sort);
+        int n_segments = (presort->size / 2 + STEAL_GRAIN_SIZE - 1) / STEAL_GRAIN_SIZE;
+        steal_fork_phase(pool, header, REVERSE_PHASE, n_segments, FINISH_PHASE);
+        return;
+    }
+    if (!atomic_load(&presort->gave_up) && n_breaks < PRESORT_MAX_RUNS) {
+        presort->aux = (char *) malloc((size_t) presort->size * presort->ops->elem_size);
+    }
+    if (presort->aux == NULL) {
+        // too many runs (or no memory to merge them): sort the array, in place of the pre-scan
+        steal_task_t *sort = presort->sort;
+        free_presort(presort);
+        steal_fork(pool, header, NULL, &sort, 1);
+        return;
+    }
+    free(presort->sort);
+    // the runs start at 0 and after each break, in the order of the chunks
+    int n_runs = 0;
+    presort->starts[n_runs++] = 0;
+    for (int chunk = 0; chunk < presort->n_chunks; chunk++) {
+        for (int i = 0; i < presort->n_chunk_breaks[chunk]; i++) {
+            presort->starts[n_runs++] = presort->breaks[chunk * PRESORT_MAX_RUNS + i];
+        }
+    }
+    presort->starts[n_runs] = presort->size;
+    presort->runs = (merge_runs_t) {presort->ops, presort->arr, presort->aux, presort->size, presort->direction, n_runs,
+                                    presort->starts};
+    next_round(pool, header, presort);
+}
+
+/**
+ *  \brief Executes a fork/join task of a pre-scan.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header header of the fork/join task
+ */
+static void run_presort_job(steal_pool_t *pool, steal_task_t *header) {
+    steal_phase_t *job = (steal_phase_t *) header;
+    presort_t *presort = (presort_t *) job->state;
+    size_t elem_size = presort->ops->elem_size;
+    int low = job->index * STEAL_GRAIN_SIZE;
+
+    if (job->phase == SCAN_PHASE) {
+        steal_fork_phase(pool, header, SCAN_CHUNK_PHASE, presort->n_chunks, DECIDE_PHASE);
+    } else if (job->phase == SCAN_CHUNK_PHASE) {
+        scan_chunk(presort, job->index);
+        steal_done(pool, header);
+    } else if (job->phase == DECIDE_PHASE) {
+        decide(pool, header, presort);
+    } else if (job->phase == REVERSE_PHASE) {
+        int count = presort->size / 2 - low < STEAL_GRAIN_SIZE ? presort->size / 2 - low : STEAL_GRAIN_SIZE;
+        if (elem_size == 4) {
+            reverse_elems(presort->arr, presort->size, low, count, 4);
+        } else if (elem_size == 8) {
+            reverse_elems(presort->arr, presort->size, low, count, 8);
+        } else {
+            reverse_elems(presort->arr, presort->size, low, count, elem_size);
+        }
+        steal_done(pool, header);
+    } else if (job->phase == MERGE_PHASE) {
+        int high = presort->size - low < STEAL_GRAIN_SIZE ? presort->size : low + STEAL_GRAIN_SIZE;
+        merge_round_range(&presort->runs, low, high);
+        steal_done(pool, header);
+    } else if (job->phase == ROUND_PHASE) {
+        merge_next_round(&presort->runs);
+        next_round(pool, header, presort);
+    } else if (job->phase == COPY_PHASE) {
+        int count = presort->size - low < STEAL_GRAIN_SIZE ? presort->size - low : STEAL_GRAIN_SIZE;
+        memcpy(presort->arr + (size_t) low * elem_size, presort->runs.src + (size_t) low * elem_size,
+               count * elem_size);
+        steal_done(pool, header);
+    } else {
+        // finish phase
+        free_presort(presort);
+        steal_done(pool, header);
+    }
+    free(header);
+}
+
+/**
+ *  \brief Allocates the root task of the pre-scan of an array.
+ *
+ *  The array is scanned in 4 chunks per worker thread.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the pre-scan
+ *  \param sort task that sorts the array if it is not almost sorted (freed with free if it is not run)
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the pre-scan
+ */
+steal_task_t *new_presort_job(steal_pool_t *pool, steal_task_t *sort, void *arr, int size, int elem_type,
+                              int direction) {
+    presort_t *presort = (presort_t *) calloc(1, sizeof(presort_t));
+    if (presort == NULL) {
+        return NULL;
+    }
+    presort->ops = kernel_ops(elem_type);
+    presort->sort = sort;
+    presort->arr = (char *) arr;
+    presort->size = size;
+    presort->direction = direction;
+    presort->n_chunks = 4 * pool->n_workers < size ? 4 * pool->n_workers : 1;
+    presort->chunk = (size + presort->n_chunks - 1) / presort->n_chunks;
+    atomic_init(&presort->n_breaks, 0);
+    atomic_init(&presort->n_inversions, 0);
+    atomic_init(&presort->gave_up, 0);
+    presort->breaks = (int *) malloc((size_t) presort->n_chunks * PRESORT_MAX_RUNS * sizeof(int));
+    presort->n_chunk_breaks = (int *) calloc(presort->n_chunks, sizeof(int));
+    if (presort->breaks == NULL || presort->n_chunk_breaks == NULL) {
+        free_presort(presort);
+        return NULL;
+    }
+    return steal_phase_job(run_presort_job, presort, SCAN_PHASE, 0);
+}
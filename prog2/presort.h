@@ -0,0 +1,43 @@
+/**
+ *  \file presort.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the adaptive pre-scan of the arrays sorted by the bitonic sort, that avoids
+ *  the O(n log^2 n) work of the sort on arrays that are already sorted, or almost.
+ *
+ *  The pre-scan is a chain of fork/join tasks of the work-stealing scheduler:
+ *  - scan: each chunk of the array counts the pairs of adjacent elements out of order, in the order of the sort and in
+ *    the opposite one, and records where the sorted runs break; as soon as the array has both too many runs and a pair
+ *    in the opposite order, every chunk gives up, so the pre-scan of a random array reads a few blocks per chunk
+ *  - decide: an array that is already sorted is left as it is, an array sorted in the opposite order is reversed in
+ *    place, an array of at most PRESORT_MAX_RUNS sorted runs is merged, and any other array is sorted
+ *  - reverse: each segment of the first half of the array is swapped with its mirror in the second half
+ *  - merge: the runs are merged in pairs, in rounds, through an auxiliary buffer as large as the array, each round
+ *    split in segments of the output by merge path (see merge.h), and copied back if they end in the buffer
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef PRESORT_H
+#define PRESORT_H
+
+#include "steal.h"
+
+/**
+ *  \brief Allocates the root task of the pre-scan of an array.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the pre-scan
+ *  \param sort task that sorts the array if it is not almost sorted (freed with free if it is not run)
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the pre-scan
+ */
+steal_task_t *new_presort_job(steal_pool_t *pool, steal_task_t *sort, void *arr, int size, int elem_type,
+                              int direction);
+
+#endif /* PRESORT_H */
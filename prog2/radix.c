@@ -0,0 +1,387 @@
+/**
+ *  \file radix.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the parallel LSD radix sort.
+ *
+ *  Each phase forks one task per chunk of the array and continues with the next phase, so the worker threads never
+ *  block between phases. The state shared by the tasks of a sort lives in a single structure, freed by the last phase.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "steal.h"
+#include "radix.h"
+
+/** \brief Number of values of a digit of the radix sort */
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+/** \brief Phase of the radix sort: start the next pass, or finish the sort if there is none */
+#define PASS_PHASE 0
+
+/** \brief Phase of the radix sort: count the digits of a chunk */
+#define HISTOGRAM_PHASE 1
+
+/** \brief Phase of the radix sort: prefix sum of the histograms of the chunks */
+#define PREFIX_PHASE 2
+
+/** \brief Phase of the radix sort: move the elements of a chunk to their positions in the other buffer */
+#define SCATTER_PHASE 3
+
+/** \brief Phase of the radix sort: swap the buffers after a pass */
+#define SWAP_PHASE 4
+
+/** \brief Phase of the radix sort: copy a chunk of the auxiliary buffer back to the array */
+#define COPY_PHASE 5
+
+/** \brief Phase of the radix sort: free the state of the sort */
+#define FINISH_PHASE 6
+
+/** \brief Phase of the radix sort: sort an array of less than RADIX_MIN_SIZE elements in place, by the kernels */
+#define SORT_ALL_PHASE 7
+
+/** \brief State shared by the tasks of a radix sort */
+typedef struct {
+    const kernel_ops_t *ops;
+    char *arr;
+    char *aux;
+    char *src;
+    char *dst;
+    int size;
+    int direction;
+    int key_size;
+    uint64_t flip;
+    int shift;
+    int n_chunks;
+    int chunk;
+    int *histograms;
+    char *wc_buffers;
+} radix_t;
+
+static void run_radix_job(steal_pool_t *pool, steal_task_t *header);
+
+/**
+ *  \brief Gets the number of bytes of the integer key of an element type.
+ *
+ *  The key is at the start of the element.
+ *
+ *  \param elem_type type of the elements (ELEM_* of const.h)
+ *
+ *  \return 4 or 8, 0 if the elements do not have an integer key
+ */
+static int key_size(int elem_type) {
+    switch (elem_type) {
+        case ELEM_INT32:
+        case ELEM_UINT32:
+            return 4;
+        case ELEM_INT64:
+        case ELEM_RECORD:
+        case ELEM_PAIR:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+/**
+ *  \brief Checks if the radix sort sorts the elements of a type.
+ *
+ *  \param elem_type type of the elements (ELEM_* of const.h)
+ *
+ *  \return 1 if the elements have an integer key, 0 otherwise
+ */
+int radix_supports(int elem_type) {
+    return key_size(elem_type) != 0;
+}
+
+/**
+ *  \brief Computes the auxiliary memory used by the radix sort of an array.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *
+ *  \return number of bytes allocated by the sort besides the array
+ */
+size_t radix_memory(steal_pool_t *pool, int size, int elem_type) {
+    if (!radix_supports(elem_type) || size < RADIX_MIN_SIZE) {
+        return 0;
+    }
+    size_t n_chunks = steal_chunk_count(pool, size);
+    return (size_t) size * kernel_ops(elem_type)->elem_size + n_chunks * RADIX_BUCKETS * sizeof(int)
+           + (size_t) pool->n_workers * RADIX_BUCKETS * RADIX_WC_BYTES;
+}
+
+/**
+ *  \brief Loads the key of an element, with the bits that order it as an unsigned integer flipped.
+ *
+ *  \param elem element
+ *  \param key_size number of bytes of the key (4 or 8)
+ *  \param flip bits of the key to flip
+ *
+ *  \return key of the element
+ */
+static inline uint64_t load_key(const char *elem, int key_size, uint64_t flip) {
+    if (key_size == 4) {
+        uint32_t key;
+        memcpy(&key, elem, sizeof(key));
+        return key ^ flip;
+    }
+    uint64_t key;
+    memcpy(&key, elem, sizeof(key));
+    return key ^ flip;
+}
+
+/**
+ *  \brief Counts the elements of a range of an array with each value of a digit.
+ *
+ *  Inlined with constant element and key sizes, so loading a key is a single load.
+ *
+ *  \param src array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param histogram number of elements with each value of the digit, incremented
+ *  \param shift position of the digit in the keys
+ *  \param flip bits of the keys to flip
+ *  \param elem_size number of bytes of an element
+ *  \param key_size number of bytes of the key of an element
+ */
+static inline void count_digits(const char *src, int low_index, int count, int *histogram, int shift, uint64_t flip,
+                                size_t elem_size, int key_size) {
+    for (int i = low_index; i < low_index + count; i++) {
+        histogram[(load_key(src + i * elem_size, key_size, flip) >> shift) & (RADIX_BUCKETS - 1)]++;
+    }
+}
+
+/**
+ *  \brief Moves the elements of a range of an array, in order, to their positions in another array.
+ *
+ *  The elements of each digit value are gathered in a write-combining buffer of a cache line, which is written to
+ *  the other array when it is full, so each pass writes whole cache lines to RADIX_BUCKETS streams instead of single
+ *  elements to random pages. Inlined with constant element and key sizes.
+ *
+ *  \param dst array where the elements are moved to
+ *  \param src array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param positions next write position for each value of the digit, incremented
+ *  \param wc_buffers write-combining buffers of the worker thread (RADIX_WC_BYTES per value of the digit)
+ *  \param shift position of the digit in the keys
+ *  \param flip bits of the keys to flip
+ *  \param elem_size number of bytes of an element
+ *  \param key_size number of bytes of the key of an element
+ */
+static inline void scatter_digits(char *dst, const char *src, int low_index, int count, int *positions,
+                                  char *wc_buffers, int shift, uint64_t flip, size_t elem_size, int key_size) {
+    int per_line = RADIX_WC_BYTES / elem_size;
+    int fill[RADIX_BUCKETS] = {0};
+    for (int i = low_index; i < low_index + count; i++) {
+        const char *elem = src + i * elem_size;
+        int digit = (load_key(elem, key_size, flip) >> shift) & (RADIX_BUCKETS - 1);
+        char *line = wc_buffers + digit * RADIX_WC_BYTES;
+        memcpy(line + fill[digit] * elem_size, elem, elem_size);
+        if (++fill[digit] == per_line) {
+            memcpy(dst + (size_t) positions[digit] * elem_size, line, per_line * elem_size);
+            positions[digit] += per_line;
+            fill[digit] = 0;
+        }
+    }
+    for (int digit = 0; digit < RADIX_BUCKETS; digit++) {
+        memcpy(dst + (size_t) positions[digit] * elem_size, wc_buffers + digit * RADIX_WC_BYTES,
+               fill[digit] * elem_size);
+        positions[digit] += fill[digit];
+    }
+}
+
+/**
+ *  \brief Computes the write positions of each chunk for each value of the digit.
+ *
+ *  The histograms of the chunks are replaced, in place, by the position where each chunk writes its first element of
+ *  each value: the elements of the smaller values plus the elements of the value in the previous chunks.
+ *
+ *  \param sort state of the sort
+ *
+ *  \return 1 if all the elements have the same value of the digit (the pass would not move them), 0 otherwise
+ */
+static int prefix_sum(radix_t *sort) {
+    int position = 0;
+    int trivial = 0;
+    for (int digit = 0; digit < RADIX_BUCKETS; digit++) {
+        int start = position;
+        for (int chunk = 0; chunk < sort->n_chunks; chunk++) {
+            int *count = &sort->histograms[chunk * RADIX_BUCKETS + digit];
+            int n = *count;
+            *count = position;
+            position += n;
+        }
+        trivial |= position - start == sort->size;
+    }
+    return trivial;
+}
+
+/**
+ *  \brief Frees the state of a radix sort.
+ *
+ *  \param sort state of the sort
+ */
+static void free_sort(radix_t *sort) {
+    free(sort->aux);
+    free(sort->histograms);
+    free(sort->wc_buffers);
+    free(sort);
+}
+
+/**
+ *  \brief Starts the next pass of a radix sort, or finishes the sort if all the digits were sorted.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header task that forks
+ *  \param sort state of the sort
+ */
+static void start_pass(steal_pool_t *pool, steal_task_t *header, radix_t *sort) {
+    if (sort->shift < 8 * sort->key_size) {
+        memset(sort->histograms, 0, sort->n_chunks * RADIX_BUCKETS * sizeof(int));
+        steal_fork_phase(pool, header, HISTOGRAM_PHASE, sort->n_chunks, PREFIX_PHASE);
+    } else if (sort->src != sort->arr) {
+        // an odd number of passes moved the elements, which are left in the auxiliary buffer
+        steal_fork_phase(pool, header, COPY_PHASE, sort->n_chunks, FINISH_PHASE);
+    } else {
+        free_sort(sort);
+        steal_done(pool, header);
+    }
+}
+
+/**
+ *  \brief Executes a fork/join task of a radix sort.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header header of the fork/join task
+ */
+static void run_radix_job(steal_pool_t *pool, steal_task_t *header) {
+    steal_phase_t *job = (steal_phase_t *) header;
+    radix_t *sort = (radix_t *) job->state;
+    size_t elem_size = sort->ops->elem_size;
+    // the last chunks may be short or empty: n_chunks chunks of chunk elements can overshoot the array
+    int low_index = job->index * sort->chunk < sort->size ? job->index * sort->chunk : sort->size;
+    int count = sort->size - low_index < sort->chunk ? sort->size - low_index : sort->chunk;
+
+    if (job->phase == PASS_PHASE) {
+        start_pass(pool, header, sort);
+    } else if (job->phase == HISTOGRAM_PHASE) {
+        int *histogram = sort->histograms + job->index * RADIX_BUCKETS;
+        if (elem_size == 4) {
+            count_digits(sort->src, low_index, count, histogram, sort->shift, sort->flip, 4, 4);
+        } else if (elem_size == 8) {
+            count_digits(sort->src, low_index, count, histogram, sort->shift, sort->flip, 8, 8);
+        } else {
+            count_digits(sort->src, low_index, count, histogram, sort->shift, sort->flip, sizeof(record_t), 8);
+        }
+        steal_done(pool, header);
+    } else if (job->phase == PREFIX_PHASE) {
+        if (prefix_sum(sort)) {
+            // the elements are already in order of this digit
+            sort->shift += RADIX_BITS;
+            start_pass(pool, header, sort);
+        } else {
+            steal_fork_phase(pool, header, SCATTER_PHASE, sort->n_chunks, SWAP_PHASE);
+        }
+    } else if (job->phase == SCATTER_PHASE) {
+        int *positions = sort->histograms + job->index * RADIX_BUCKETS;
+        // the write-combining buffers are flushed at the end of the chunk, so each worker thread reuses its own
+        char *wc_buffers = sort->wc_buffers + (size_t) steal_worker_index(pool) * RADIX_BUCKETS * RADIX_WC_BYTES;
+        if (elem_size == 4) {
+            scatter_digits(sort->dst, sort->src, low_index, count, positions, wc_buffers, sort->shift, sort->flip,
+                           4, 4);
+        } else if (elem_size == 8) {
+            scatter_digits(sort->dst, sort->src, low_index, count, positions, wc_buffers, sort->shift, sort->flip,
+                           8, 8);
+        } else {
+            scatter_digits(sort->dst, sort->src, low_index, count, positions, wc_buffers, sort->shift, sort->flip,
+                           sizeof(record_t), 8);
+        }
+        steal_done(pool, header);
+    } else if (job->phase == SWAP_PHASE) {
+        char *src = sort->src;
+        sort->src = sort->dst;
+        sort->dst = src;
+        sort->shift += RADIX_BITS;
+        start_pass(pool, header, sort);
+    } else if (job->phase == COPY_PHASE) {
+        memcpy(sort->arr + low_index * elem_size, sort->aux + low_index * elem_size, count * elem_size);
+        steal_done(pool, header);
+    } else if (job->phase == SORT_ALL_PHASE) {
+        sort->ops->sort(sort->arr, 0, sort->size, sort->direction);
+        free(sort);
+        steal_done(pool, header);
+    } else {
+        // finish phase
+        free_sort(sort);
+        steal_done(pool, header);
+    }
+    free(header);
+}
+
+/**
+ *  \brief Allocates the root task of the radix sort of an array.
+ *
+ *  Arrays of less than RADIX_MIN_SIZE elements are sorted in place by the kernels, in a single task. Otherwise, the
+ *  array is split into 4 chunks per worker thread, each with its own histogram; the write-combining buffers are per
+ *  worker thread, since a chunk flushes them before its task completes.
+ *
+ *  The keys are sorted as unsigned integers: the sign bit of the signed keys is flipped, which orders the negative
+ *  keys before the positive ones, and all the bits are flipped for the descending order.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (any)
+ *  \param elem_type type of the elements of the array (radix_supports must hold)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the sort
+ */
+steal_task_t *new_radix_job(steal_pool_t *pool, void *arr, int size, int elem_type, int direction) {
+    radix_t *sort = (radix_t *) calloc(1, sizeof(radix_t));
+    if (sort == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the radix sort\n");
+        return NULL;
+    }
+    sort->ops = kernel_ops(elem_type);
+    sort->arr = (char *) arr;
+    sort->size = size;
+    sort->direction = direction;
+    sort->key_size = key_size(elem_type);
+    uint64_t key_mask = sort->key_size == 4 ? UINT32_MAX : UINT64_MAX;
+    if (elem_type != ELEM_UINT32) {
+        sort->flip = (key_mask >> 1) + 1;
+    }
+    if (direction == DESCENDING) {
+        sort->flip ^= key_mask;
+    }
+    if (size < RADIX_MIN_SIZE) {
+        return steal_phase_job(run_radix_job, sort, SORT_ALL_PHASE, 0);
+    }
+    sort->n_chunks = steal_chunk_count(pool, size);
+    sort->chunk = (size + sort->n_chunks - 1) / sort->n_chunks;
+
+    sort->aux = (char *) malloc((size_t) size * sort->ops->elem_size);
+    sort->histograms = (int *) malloc((size_t) sort->n_chunks * RADIX_BUCKETS * sizeof(int));
+    sort->wc_buffers = (char *) aligned_alloc(RADIX_WC_BYTES,
+                                              (size_t) pool->n_workers * RADIX_BUCKETS * RADIX_WC_BYTES);
+    if (sort->aux == NULL || sort->histograms == NULL || sort->wc_buffers == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the radix sort\n");
+        free_sort(sort);
+        return NULL;
+    }
+    sort->src = sort->arr;
+    sort->dst = sort->aux;
+    return steal_phase_job(run_radix_job, sort, PASS_PHASE, 0);
+}
@@ -0,0 +1,65 @@
+/**
+ *  \file radix.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the parallel LSD radix sort, an alternative to the comparison sorts for
+ *  integer keys (int32, uint32, int64 and the int64 key of the records).
+ *
+ *  The sort makes one pass per digit of RADIX_BITS bits, from the least significant one, and each pass is a chain of
+ *  fork/join tasks of the work-stealing scheduler:
+ *  - histogram: each chunk of the array counts the elements of each digit value
+ *  - prefix: a prefix sum of the histograms gives each chunk its own write position for each digit value
+ *  - scatter: each chunk moves its elements, in order, to an auxiliary buffer through write-combining buffers
+ *
+ *  The array and the auxiliary buffer swap roles after each pass. Signed keys and the descending order are handled by
+ *  flipping bits of the keys as the digits are extracted, so the elements themselves are never changed.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef RADIX_H
+#define RADIX_H
+
+#include <stddef.h>
+
+#include "steal.h"
+
+/**
+ *  \brief Checks if the radix sort sorts the elements of a type.
+ *
+ *  \param elem_type type of the elements (ELEM_* of const.h)
+ *
+ *  \return 1 if the elements have an integer key, 0 otherwise
+ */
+int radix_supports(int elem_type);
+
+/**
+ *  \brief Computes the auxiliary memory used by the radix sort of an array.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *
+ *  \return number of bytes allocated by the sort besides the array
+ */
+size_t radix_memory(steal_pool_t *pool, int size, int elem_type);
+
+/**
+ *  \brief Allocates the root task of the radix sort of an array.
+ *
+ *  The auxiliary buffer (as large as the array), the histograms and the write-combining buffers are allocated here,
+ *  and freed by the last task of the sort.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (any)
+ *  \param elem_type type of the elements of the array (radix_supports must hold)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the sort
+ */
+steal_task_t *new_radix_job(steal_pool_t *pool, void *arr, int size, int elem_type, int direction);
+
+#endif /* RADIX_H */
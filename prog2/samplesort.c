@@ -0,0 +1,335 @@
+/**
+ *  \file samplesort.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the parallel sample sort.
+ *
+ *  Each phase forks one task per chunk of the array (or per bucket) and continues with the next phase, so the worker
+ *  threads never block between phases. The state shared by the tasks of a sort lives in a single structure, freed by
+ *  the last phase.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "steal.h"
+#include "samplesort.h"
+
+/** \brief Phase of the sample sort: choose the splitters */
+#define SAMPLE_PHASE 0
+
+/** \brief Phase of the sample sort: classify the elements of a chunk */
+#define CLASSIFY_PHASE 1
+
+/** \brief Phase of the sample sort: prefix sum of the histograms of the chunks */
+#define PREFIX_PHASE 2
+
+/** \brief Phase of the sample sort: move the elements of a chunk to their buckets */
+#define SCATTER_PHASE 3
+
+/** \brief Phase of the sample sort: fork the sort of each bucket */
+#define BUCKETS_PHASE 4
+
+/** \brief Phase of the sample sort: sort a bucket (unless it is an equality bucket) and copy it back to the array */
+#define SORT_BUCKET_PHASE 5
+
+/** \brief Phase of the sample sort: free the state of the sort */
+#define FINISH_PHASE 6
+
+/** \brief Phase of the sample sort: sort an array of up to SAMPLE_BUCKET_SIZE elements in place, as a single bucket */
+#define SORT_ALL_PHASE 7
+
+/** \brief State shared by the tasks of a sample sort */
+typedef struct {
+    const kernel_ops_t *ops;
+    char *arr;
+    char *aux;
+    int size;
+    int direction;
+    int n_chunks;
+    int chunk;
+    int n_buckets;
+    int log_buckets;
+    char *tree;
+    uint8_t *equal;
+    int has_equal;
+    uint16_t *bucket_ids;
+    int *histograms;
+    int *bucket_starts;
+} samplesort_t;
+
+static void run_samplesort_job(steal_pool_t *pool, steal_task_t *header);
+
+/**
+ *  \brief Generates the next pseudo-random number (xorshift64).
+ *
+ *  \param state state of the generator (not 0)
+ *
+ *  \return pseudo-random 64-bit number
+ */
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/**
+ *  \brief Chooses the splitters of the buckets and lays them out as an implicit binary search tree.
+ *
+ *  SAMPLE_OVERSAMPLING elements per bucket are sampled at random and sorted, and every SAMPLE_OVERSAMPLING-th sample
+ *  becomes a splitter. Node j at depth d of the tree (2^d <= j < 2^(d+1)) holds the median of its subtree, the splitter
+ *  (2 (j - 2^d) + 1) n_buckets / 2^(d+1) - 1. The splitters are also stored in order after the tree, as the upper
+ *  splitter of each bucket, and the buckets whose upper splitter is repeated (frequent keys) are flagged, so the
+ *  elements equal to it go to an equality bucket instead of all landing, unsorted, in a single bucket.
+ *
+ *  \param sort state of the sort
+ *
+ *  \return EXIT_SUCCESS if the splitters were chosen, EXIT_FAILURE if there is no memory for the sample
+ */
+static int choose_splitters(samplesort_t *sort) {
+    size_t elem_size = sort->ops->elem_size;
+    int n_samples = SAMPLE_OVERSAMPLING * sort->n_buckets;
+    char *samples = (char *) malloc(n_samples * elem_size);
+    if (samples == NULL) {
+        return EXIT_FAILURE;
+    }
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ (uint64_t) sort->size;
+    for (int i = 0; i < n_samples; i++) {
+        size_t index = next_random(&state) % (uint64_t) sort->size;
+        memcpy(samples + i * elem_size, sort->arr + index * elem_size, elem_size);
+    }
+    sort->ops->sort(samples, 0, n_samples, ASCENDING);
+    for (int depth = 0; depth < sort->log_buckets; depth++) {
+        for (int node = 1 << depth; node < 2 << depth; node++) {
+            int splitter = (2 * (node - (1 << depth)) + 1) * (sort->n_buckets >> (depth + 1)) - 1;
+            memcpy(sort->tree + node * elem_size, samples + (size_t) (splitter + 1) * SAMPLE_OVERSAMPLING * elem_size,
+                   elem_size);
+        }
+    }
+    char *uppers = sort->tree + (size_t) sort->n_buckets * elem_size;
+    for (int bucket = 0; bucket < sort->n_buckets - 1; bucket++) {
+        memcpy(uppers + bucket * elem_size, samples + (size_t) (bucket + 1) * SAMPLE_OVERSAMPLING * elem_size,
+               elem_size);
+    }
+    for (int bucket = 0; bucket + 1 < sort->n_buckets - 1; bucket++) {
+        sort->equal[bucket] = !sort->ops->less(uppers + bucket * elem_size, uppers + (bucket + 1) * elem_size);
+        sort->has_equal |= sort->equal[bucket];
+    }
+    free(samples);
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Moves the elements of a range of an array to their buckets.
+ *
+ *  Inlined with a constant element size, so the copy of each element is a single load and store.
+ *
+ *  \param aux buffer where the buckets are
+ *  \param arr array
+ *  \param bucket_ids bucket of each element of the array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param positions next write position in each bucket, incremented
+ *  \param elem_size number of bytes of an element
+ */
+static inline void scatter_elems(char *aux, const char *arr, const uint16_t *bucket_ids, int low_index, int count,
+                                 int *positions, size_t elem_size) {
+    for (int i = low_index; i < low_index + count; i++) {
+        memcpy(aux + (size_t) positions[bucket_ids[i]]++ * elem_size, arr + (size_t) i * elem_size, elem_size);
+    }
+}
+
+/**
+ *  \brief Computes the write positions of each chunk in each bucket, and the start of each bucket.
+ *
+ *  The histograms of the chunks are replaced, in place, by the position where each chunk writes its first element of
+ *  each bucket: the start of the bucket plus the elements of the bucket in the previous chunks.
+ *
+ *  \param sort state of the sort
+ */
+static void prefix_sum(samplesort_t *sort) {
+    int position = 0;
+    for (int bucket = 0; bucket < sort->n_buckets; bucket++) {
+        sort->bucket_starts[bucket] = position;
+        for (int chunk = 0; chunk < sort->n_chunks; chunk++) {
+            int *count = &sort->histograms[chunk * sort->n_buckets + bucket];
+            int n = *count;
+            *count = position;
+            position += n;
+        }
+    }
+    sort->bucket_starts[sort->n_buckets] = position;
+}
+
+/**
+ *  \brief Executes a fork/join task of a sample sort.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param header header of the fork/join task
+ */
+static void run_samplesort_job(steal_pool_t *pool, steal_task_t *header) {
+    steal_phase_t *job = (steal_phase_t *) header;
+    samplesort_t *sort = (samplesort_t *) job->state;
+    size_t elem_size = sort->ops->elem_size;
+    // the last chunks may be short or empty: n_chunks chunks of chunk elements can overshoot the array
+    int low_index = job->index * sort->chunk < sort->size ? job->index * sort->chunk : sort->size;
+    int count = sort->size - low_index < sort->chunk ? sort->size - low_index : sort->chunk;
+
+    if (job->phase == SAMPLE_PHASE) {
+        if (choose_splitters(sort) != EXIT_SUCCESS) {
+            fprintf(stderr, "[LIB] Could not allocate memory for the sample\n");
+            exit(EXIT_FAILURE);
+        }
+        steal_fork_phase(pool, header, CLASSIFY_PHASE, sort->n_chunks, PREFIX_PHASE);
+    } else if (job->phase == CLASSIFY_PHASE) {
+        sort->ops->classify(sort->arr, low_index, count, sort->tree, sort->has_equal ? sort->equal : NULL,
+                            sort->log_buckets, sort->direction, sort->bucket_ids,
+                            sort->histograms + job->index * sort->n_buckets);
+        steal_done(pool, header);
+    } else if (job->phase == PREFIX_PHASE) {
+        prefix_sum(sort);
+        steal_fork_phase(pool, header, SCATTER_PHASE, sort->n_chunks, BUCKETS_PHASE);
+    } else if (job->phase == SCATTER_PHASE) {
+        int *positions = sort->histograms + job->index * sort->n_buckets;
+        if (elem_size == 4) {
+            scatter_elems(sort->aux, sort->arr, sort->bucket_ids, low_index, count, positions, 4);
+        } else if (elem_size == 8) {
+            scatter_elems(sort->aux, sort->arr, sort->bucket_ids, low_index, count, positions, 8);
+        } else {
+            scatter_elems(sort->aux, sort->arr, sort->bucket_ids, low_index, count, positions, elem_size);
+        }
+        steal_done(pool, header);
+    } else if (job->phase == BUCKETS_PHASE) {
+        steal_fork_phase(pool, header, SORT_BUCKET_PHASE, sort->n_buckets, FINISH_PHASE);
+    } else if (job->phase == SORT_BUCKET_PHASE) {
+        int start = sort->bucket_starts[job->index];
+        int n = sort->bucket_starts[job->index + 1] - start;
+        // an equality bucket follows a bucket whose upper splitter is repeated, in ascending order; the scatter keeps
+        // the order of the array, so a bucket of a sorted stretch (e.g. the packed words of equal keys of an argsort)
+        // is already sorted, which the check finds in a single pass (and stops at the first break otherwise)
+        int bucket = sort->direction == ASCENDING ? job->index : sort->n_buckets - 1 - job->index;
+        if ((bucket == 0 || !sort->equal[bucket - 1])
+            && sort->ops->check(sort->aux + start * elem_size, n, sort->direction) != -1) {
+            sort->ops->sort(sort->aux, start, n, sort->direction);
+        }
+        memcpy(sort->arr + start * elem_size, sort->aux + start * elem_size, n * elem_size);
+        steal_done(pool, header);
+    } else if (job->phase == SORT_ALL_PHASE) {
+        sort->ops->sort(sort->arr, 0, sort->size, sort->direction);
+        free(sort);
+        steal_done(pool, header);
+    } else {
+        // finish phase
+        free(sort->aux);
+        free(sort->tree);
+        free(sort->equal);
+        free(sort->bucket_ids);
+        free(sort->histograms);
+        free(sort->bucket_starts);
+        free(sort);
+        steal_done(pool, header);
+    }
+    free(header);
+}
+
+/**
+ *  \brief Computes the number of buckets of a sample sort.
+ *
+ *  The number of buckets is the power of 2 that gives buckets of about SAMPLE_BUCKET_SIZE elements, with at least 4
+ *  buckets per worker thread (for load balance) and at most SAMPLE_MAX_BUCKETS.
+ *
+ *  \param pool pointer to the pool of worker threads
+ *  \param size number of elements in the array (more than SAMPLE_BUCKET_SIZE)
+ *
+ *  \return base 2 logarithm of the number of buckets
+ */
+static int log_bucket_count(steal_pool_t *pool, int size) {
+    int log_buckets = 1;
+    while ((1 << log_buckets) < SAMPLE_MAX_BUCKETS
+           && ((1 << log_buckets) < 4 * pool->n_workers || (size >> log_buckets) > SAMPLE_BUCKET_SIZE)) {
+        log_buckets++;
+    }
+    return log_buckets;
+}
+
+/**
+ *  \brief Computes the auxiliary memory used by the sample sort of an array.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *
+ *  \return number of bytes allocated by the sort besides the array
+ */
+size_t samplesort_memory(steal_pool_t *pool, int size, int elem_type) {
+    if (size <= SAMPLE_BUCKET_SIZE) {
+        return 0;
+    }
+    size_t elem_size = kernel_ops(elem_type)->elem_size;
+    size_t n_buckets = (size_t) 1 << log_bucket_count(pool, size);
+    size_t n_chunks = steal_chunk_count(pool, size);
+    return (size_t) size * (elem_size + sizeof(uint16_t)) + 2 * n_buckets * elem_size + n_buckets * sizeof(uint8_t)
+           + n_chunks * n_buckets * sizeof(int) + (n_buckets + 1) * sizeof(int);
+}
+
+/**
+ *  \brief Allocates the root task of the sample sort of an array.
+ *
+ *  Arrays of up to SAMPLE_BUCKET_SIZE elements are sorted in place by a single task.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (any)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the sort
+ */
+steal_task_t *new_samplesort_job(steal_pool_t *pool, void *arr, int size, int elem_type, int direction) {
+    samplesort_t *sort = (samplesort_t *) calloc(1, sizeof(samplesort_t));
+    if (sort == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the sample sort\n");
+        return NULL;
+    }
+    sort->ops = kernel_ops(elem_type);
+    sort->arr = (char *) arr;
+    sort->size = size;
+    sort->direction = direction;
+    if (size <= SAMPLE_BUCKET_SIZE) {
+        return steal_phase_job(run_samplesort_job, sort, SORT_ALL_PHASE, 0);
+    }
+    sort->log_buckets = log_bucket_count(pool, size);
+    sort->n_buckets = 1 << sort->log_buckets;
+    sort->n_chunks = steal_chunk_count(pool, size);
+    sort->chunk = (size + sort->n_chunks - 1) / sort->n_chunks;
+
+    size_t elem_size = sort->ops->elem_size;
+    sort->aux = (char *) malloc(size * elem_size);
+    sort->tree = (char *) malloc(2 * sort->n_buckets * elem_size);
+    sort->equal = (uint8_t *) calloc(sort->n_buckets, sizeof(uint8_t));
+    sort->bucket_ids = (uint16_t *) malloc(size * sizeof(uint16_t));
+    sort->histograms = (int *) calloc((size_t) sort->n_chunks * sort->n_buckets, sizeof(int));
+    sort->bucket_starts = (int *) malloc((sort->n_buckets + 1) * sizeof(int));
+    if (sort->aux == NULL || sort->tree == NULL || sort->equal == NULL || sort->bucket_ids == NULL
+        || sort->histograms == NULL || sort->bucket_starts == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the sample sort\n");
+        free(sort->aux);
+        free(sort->tree);
+        free(sort->equal);
+        free(sort->bucket_ids);
+        free(sort->histograms);
+        free(sort->bucket_starts);
+        free(sort);
+        return NULL;
+    }
+    return steal_phase_job(run_samplesort_job, sort, SAMPLE_PHASE, 0);
+}
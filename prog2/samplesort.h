@@ -0,0 +1,58 @@
+/**
+ *  \file samplesort.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the parallel sample sort, an alternative to the bitonic sort that moves each
+ *  element across memory a constant number of times instead of once per merge level.
+ *
+ *  The sort is a chain of fork/join tasks of the work-stealing scheduler:
+ *  - sample: chooses the splitters of the buckets from a sorted random sample of the array
+ *  - classify: each chunk of the array computes the bucket of its elements and its own histogram of the buckets
+ *  - prefix: a prefix sum of the histograms gives each chunk its own write position in each bucket
+ *  - scatter: each chunk moves its elements to their buckets in an auxiliary buffer, without locks
+ *  - buckets: each bucket is sorted by the bitonic kernels and copied back to the array
+ *
+ *  A key more frequent than about one in n_buckets elements is sampled as several equal splitters: its elements are
+ *  classified into their own equality bucket, which is copied back without being sorted, so arrays of few distinct
+ *  keys (or a single one) are not sorted by a single thread.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef SAMPLESORT_H
+#define SAMPLESORT_H
+
+#include <stddef.h>
+
+#include "steal.h"
+
+/**
+ *  \brief Computes the auxiliary memory used by the sample sort of an array.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param size number of elements in the array
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *
+ *  \return number of bytes allocated by the sort besides the array
+ */
+size_t samplesort_memory(steal_pool_t *pool, int size, int elem_type);
+
+/**
+ *  \brief Allocates the root task of the sample sort of an array.
+ *
+ *  The auxiliary buffer (as large as the array) and the bucket of each element are allocated here, and freed by the
+ *  last task of the sort.
+ *
+ *  \param pool pointer to the pool of worker threads that will run the sort
+ *  \param arr array to be sorted
+ *  \param size number of elements in the array (any)
+ *  \param elem_type type of the elements of the array (ELEM_* of const.h)
+ *  \param direction DESCENDING or ASCENDING
+ *
+ *  \return pointer to the root task, NULL if there is no memory for the sort
+ */
+steal_task_t *new_samplesort_job(steal_pool_t *pool, void *arr, int size, int elem_type, int direction);
+
+#endif /* SAMPLESORT_H */
@@ -10,13 +10,23 @@
  *  A distributor thread assigns tasks to each worker thread and waits for them to finish doing them. It is also
  *  responsible for controlling the number of tasks that need to be executed before assigning new ones.
  *
- *  A worker thread can perform 3 types of tasks:
+ *  A worker thread can perform 7 types of tasks:
  *  - sort (bitonic sort)
- *  - merge (bitonic merge of two sorted arrays)
+ *  - merge (bitonic merge of two sorted arrays, from a given stride)
+ *  - merge level (slice of one level of a bitonic merge that is split among the worker threads)
+ *  - load (fault in a partition of the input array)
+ *  - top-K (select the K largest elements of a partition of the input array, see topk.h)
+ *  - top-K merge (merge the top-K lists of two worker threads)
  *  - termination (terminates the worker thread)
  *
+ *  The tasks are handed over in one of two synchronization modes:
+ *  - cond: through the mutex-protected list of tasks, with condition variables to signal new and finished tasks
+ *  - spin: through a cache-line-padded slot per worker thread, with a sense-reversing barrier between the distributor
+ *    and the worker threads at the start and at the end of each phase, that spins before parking on a futex
+ *
  *  Main thread operations:
  *  - init_shared: initializes the shared area
+ *  - init_sync: selects the synchronization mode
  *
  *  Distributor thread operations:
  *  - set_tasks: assigns tasks to each worker thread
@@ -30,41 +40,14 @@
  */
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
-/** \brief Structure that represents a task to be executed by a worker thread */
-typedef struct {
-    int type;
-    int *arr;
-    int low_index;
-    int count;
-    int direction;
-} task_t;
-
-/** \brief Structure that represents the configuration of the program */
-typedef struct {
-    char *file_path;
-    int *arr;
-    int size;
-    int direction;
-    int n_workers;
-} config_t;
-
-/** \brief Structure that represents the mechanism to assign tasks to each worker thread */
-typedef struct {
-    task_t *list;
-    int size;
-    int *is_thread_done;
-    int done;
-    pthread_cond_t tasks_ready;
-    pthread_cond_t tasks_done;
-} tasks_t;
-
-/** \brief Structure that represents the shared area */
-typedef struct {
-    pthread_mutex_t mutex;
-    config_t config;
-    tasks_t tasks;
-} shared_t;
+#include "const.h"
+#include "shared.h"
 
 /**
  * \brief Initializes the configuration of the program.
@@ -73,11 +56,20 @@ typedef struct {
  *
  * \param config pointer to the configuration of the program
  * \param file_path path to the file with the array to be sorted
+ * \param out_path path to the file where the sorted array is written (NULL for none)
+ * \param mem_flags ARRAY_HUGE and/or ARRAY_INTERLEAVE to read the array into anonymous memory (0 to map the file)
+ * \param pipelined whether the worker threads sort their parts while the rest of the array is read
+ * \param top_k number of largest elements to be selected instead of sorting the array (0 to sort it)
  * \param direction direction of the bitonic sort
  * \param n_workers number of worker threads
  */
-void init_config(config_t *config, char *file_path, int direction, int n_workers) {
+void init_config(config_t *config, char *file_path, char *out_path, int mem_flags, int pipelined, int top_k,
+                 int direction, int n_workers) {
     config->file_path = file_path;
+    config->out_path = out_path;
+    config->mem_flags = mem_flags;
+    config->pipelined = pipelined;
+    config->top_k = top_k;
     config->direction = direction;
     config->n_workers = n_workers;
 }
@@ -90,10 +82,16 @@ void init_config(config_t *config, char *file_path, int direction, int n_workers
  * \param config pointer to the configuration of the program
  * \param arr pointer to the array to be sorted
  * \param size size of the array to be sorted
+ * \param elem_type type of the elements of the array
+ * \param map pointer to the memory mapping of the input file that contains the array (NULL if it was allocated)
+ * \param map_size size of the memory mapping
  */
-void init_arr(config_t *config, int *arr, int size) {
+void init_arr(config_t *config, void *arr, int size, int elem_type, void *map, size_t map_size) {
     config->arr = arr;
     config->size = size;
+    config->elem_type = elem_type;
+    config->map = map;
+    config->map_size = map_size;
 }
 
 /**
@@ -110,7 +108,11 @@ void init_tasks(tasks_t *tasks, task_t *list, int size, int *is_thread_done) {
     tasks->list = list;
     tasks->size = size;
     tasks->is_thread_done = is_thread_done;
-    tasks->done = 0;
+    // no task has been assigned yet: every worker thread is done, so it waits in get_task for the first set_tasks
+    for (int i = 0; i < size; i++) {
+        is_thread_done[i] = 1;
+    }
+    tasks->done = size;
     pthread_cond_init(&tasks->tasks_ready, NULL);
     pthread_cond_init(&tasks->tasks_done, NULL);
 }
@@ -129,6 +131,127 @@ void init_shared(shared_t *shared, config_t *config, tasks_t *tasks) {
     pthread_mutex_init(&shared->mutex, NULL);
     shared->config = *config;
     shared->tasks = *tasks;
+    shared->sync_mode = SYNC_COND;
+    shared->stats = NULL;
+    shared->pipeline = NULL;
+    shared->top = NULL;
+    shared->top_length = 0;
+    shared->checksums = NULL;
+}
+
+/**
+ * \brief Parks the calling thread while a futex word has the expected value.
+ *
+ * \param word futex word
+ * \param expected value of the word for which the thread parks
+ */
+static void futex_wait(atomic_int *word, int expected) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+/**
+ * \brief Wakes up all the threads parked on a futex word.
+ *
+ * \param word futex word
+ */
+static void futex_wake_all(atomic_int *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * \brief Tells the CPU that the calling thread is spinning, so that it yields its resources to the other hardware
+ * thread of the core (pause on x86, yield on ARM, only a compiler barrier elsewhere).
+ */
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/**
+ * \brief Waits at a sense-reversing barrier until all the threads have arrived.
+ *
+ * The last thread to arrive resets the count and flips the sense of the barrier. The other threads spin on the sense
+ * for a while, and then park on it as a futex word.
+ *
+ * \param barrier pointer to the barrier
+ * \param local_sense pointer to the sense of the calling thread
+ */
+static void barrier_wait(spin_barrier_t *barrier, int *local_sense) {
+    int sense = !*local_sense;
+    *local_sense = sense;
+    if (atomic_fetch_sub_explicit(&barrier->count, 1, memory_order_acq_rel) == 1) {
+        atomic_store_explicit(&barrier->count, barrier->n_threads, memory_order_relaxed);
+        atomic_store(&barrier->sense, sense);
+        if (atomic_load(&barrier->n_parked) > 0) {
+            futex_wake_all(&barrier->sense);
+        }
+        return;
+    }
+    for (int i = 0; atomic_load_explicit(&barrier->sense, memory_order_acquire) != sense; i++) {
+        if (i < barrier->n_spins) {
+            cpu_relax();
+        } else {
+            atomic_fetch_add(&barrier->n_parked, 1);
+            futex_wait(&barrier->sense, !sense);
+            atomic_fetch_sub(&barrier->n_parked, 1);
+        }
+    }
+}
+
+/**
+ * \brief Selects the synchronization mode used to hand over the tasks.
+ *
+ * Should be called by the main thread after init_shared and before creating the distributor and worker threads.
+ * In spin mode, every worker thread takes part in every phase (set_tasks is always called with one task per worker
+ * thread).
+ *
+ * \param shared pointer to the shared area
+ * \param sync_mode SYNC_COND or SYNC_SPIN
+ * \param slots pointer to the task slots, one per worker thread (only used in spin mode)
+ */
+void init_sync(shared_t *shared, int sync_mode, task_slot_t *slots) {
+    shared->sync_mode = sync_mode;
+    shared->slots = slots;
+    shared->sense = 0;
+    shared->phase_open = 0;
+    // the distributor and the worker threads meet at the barrier
+    shared->barrier.n_threads = shared->config.n_workers + 1;
+    atomic_init(&shared->barrier.count, shared->barrier.n_threads);
+    atomic_init(&shared->barrier.sense, 0);
+    atomic_init(&shared->barrier.n_parked, 0);
+    // spinning only pays off if every thread has a CPU, otherwise it delays the threads the others are waiting for
+    shared->barrier.n_spins = sysconf(_SC_NPROCESSORS_ONLN) >= shared->barrier.n_threads ? BARRIER_SPINS : 0;
+    for (int i = 0; sync_mode == SYNC_SPIN && i < shared->config.n_workers; i++) {
+        slots[i].sense = 0;
+    }
+}
+
+/**
+ * \brief Waits until the worker threads are done with the tasks assigned to them.
+ *
+ * Should be called by the distributor thread to wait for the current tasks without assigning new ones.
+ *
+ * \param shared pointer to the shared area
+ */
+void wait_tasks(shared_t *shared) {
+    if (shared->sync_mode == SYNC_SPIN) {
+        // end barrier of the current phase
+        if (shared->phase_open) {
+            barrier_wait(&shared->barrier, &shared->sense);
+            shared->phase_open = 0;
+        }
+        return;
+    }
+    pthread_mutex_lock(&shared->mutex);
+    while (shared->tasks.done < shared->tasks.size) {
+        pthread_cond_wait(&shared->tasks.tasks_done, &shared->mutex);
+    }
+    pthread_mutex_unlock(&shared->mutex);
 }
 
 /**
@@ -142,6 +265,16 @@ void init_shared(shared_t *shared, config_t *config, tasks_t *tasks) {
  * \param size size of the list of tasks
  */
 void set_tasks(shared_t *shared, task_t *list, int size) {
+    if (shared->sync_mode == SYNC_SPIN) {
+        wait_tasks(shared);
+        for (int i = 0; i < size; i++) {
+            shared->slots[i].task = list[i];
+        }
+        // start barrier of the new phase, the worker threads read their slots after it
+        barrier_wait(&shared->barrier, &shared->sense);
+        shared->phase_open = 1;
+        return;
+    }
     pthread_mutex_lock(&shared->mutex);
     while (shared->tasks.done < shared->tasks.size) {
         pthread_cond_wait(&shared->tasks.tasks_done, &shared->mutex);
@@ -168,6 +301,10 @@ void set_tasks(shared_t *shared, task_t *list, int size) {
  */
 task_t get_task(shared_t *shared, int index) {
     task_t task;
+    if (shared->sync_mode == SYNC_SPIN) {
+        barrier_wait(&shared->barrier, &shared->slots[index].sense);
+        return shared->slots[index].task;
+    }
     pthread_mutex_lock(&shared->mutex);
     while (shared->tasks.is_thread_done[index] == 1 || shared->tasks.size == 0) {
         pthread_cond_wait(&shared->tasks.tasks_ready, &shared->mutex);
@@ -182,11 +319,16 @@ task_t get_task(shared_t *shared, int index) {
  *
  * Should be called by a worker thread after finishing its task.
  * Decrements the number of tasks to be executed and signals the distributor thread if all tasks are done.
+ * In spin mode, waits at the end barrier of the phase instead.
  *
  * \param shared pointer to the shared area
  * \param index index of the worker thread
  */
 void task_done(shared_t *shared, int index) {
+    if (shared->sync_mode == SYNC_SPIN) {
+        barrier_wait(&shared->barrier, &shared->slots[index].sense);
+        return;
+    }
     pthread_mutex_lock(&shared->mutex);
     shared->tasks.is_thread_done[index] = 1;
     shared->tasks.done++;
@@ -1,5 +1,5 @@
 /**
- *  \file shared.c (interface file)
+ *  \file shared.h (interface file)
  *
  *  \brief Assignment 1.2: multithreaded bitonic sort.
  *
@@ -10,13 +10,29 @@
  *  A distributor thread assigns tasks to each worker thread and waits for them to finish doing them. It is also
  *  responsible for controlling the number of tasks that need to be executed before assigning new ones.
  *
- *  A worker thread can perform 3 types of tasks:
+ *  A worker thread can perform 7 types of tasks:
  *  - sort (bitonic sort)
- *  - merge (bitonic merge of two sorted arrays)
+ *  - merge (bitonic merge of two sorted arrays, from a given stride)
+ *  - merge level (slice of one level of a bitonic merge that is split among the worker threads)
+ *  - load (fault in a partition of the input array, and fold its checksum with the parallel verification)
+ *  - top-K (select the K largest elements of a partition of the input array, see topk.h)
+ *  - top-K merge (merge the top-K lists of two worker threads)
  *  - termination (terminates the worker thread)
  *
+ *  The tasks are handed over in one of two synchronization modes:
+ *  - cond: through the mutex-protected list of tasks, with condition variables to signal new and finished tasks
+ *  - spin: through a cache-line-padded slot per worker thread, with a sense-reversing barrier between the distributor
+ *    and the worker threads at the start and at the end of each phase, that spins before parking on a futex
+ *
  *  Main thread operations:
  *  - init_shared: initializes the shared area
+ *  - init_sync: selects the synchronization mode
+ *
+ *  If the shared area has statistics (stats.h), the distributor and worker threads record the phases and tasks in
+ *  them. If it has a pipelined load (pipeline.h), the worker threads wait for their part to be read before sorting it.
+ *  In top-K mode, the worker threads keep their top-K lists in the top buffers of the shared area, of 2 * top_length
+ *  elements each. With the parallel verification, each worker thread folds the checksum of the input elements it loads
+ *  (see verify.h) into its own checksum of the shared area.
  *
  *  Distributor thread operations:
  *  - set_tasks: assigns tasks to each worker thread
@@ -33,23 +49,33 @@
 #define SHARED_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 
 /** \brief Structure that represents a task to be executed by a worker thread */
 typedef struct {
     int type;
-    int *arr;
+    void *arr;
     int low_index;
     int count;
     int direction;
+    int half;
+    int elem_type;
 } task_t;
 
 /** \brief Structure that represents the configuration of the program */
 typedef struct {
     char *file_path;
-    int *arr;
+    char *out_path;
+    int mem_flags;
+    int pipelined;
+    int top_k;
+    void *arr;
     int size;
+    int elem_type;
     int direction;
     int n_workers;
+    void *map;
+    size_t map_size;
 } config_t;
 
 /** \brief Structure that represents the mechanism to assign tasks to each worker thread */
@@ -62,11 +88,36 @@ typedef struct {
     pthread_cond_t tasks_done;
 } tasks_t;
 
+/** \brief Task of a worker thread, padded to a cache line so that the worker threads do not share lines */
+typedef struct {
+    _Alignas(64) task_t task;
+    int sense;
+} task_slot_t;
+
+/** \brief Structure that represents a sense-reversing barrier that spins and then parks on a futex */
+typedef struct {
+    _Alignas(64) atomic_int count;
+    atomic_int sense;
+    atomic_int n_parked;
+    int n_threads;
+    int n_spins;
+} spin_barrier_t;
+
 /** \brief Structure that represents the shared area */
 typedef struct {
     pthread_mutex_t mutex;
     config_t config;
     tasks_t tasks;
+    int sync_mode;
+    task_slot_t *slots;
+    int sense;
+    int phase_open;
+    spin_barrier_t barrier;
+    struct stats *stats;
+    struct pipeline *pipeline;
+    void *top;
+    int top_length;
+    struct checksum *checksums;
 } shared_t;
 
 /**
@@ -76,10 +127,15 @@ typedef struct {
  *
  * \param config pointer to the configuration of the program
  * \param file_path path to the file with the array to be sorted
+ * \param out_path path to the file where the sorted array is written (NULL for none)
+ * \param mem_flags ARRAY_HUGE and/or ARRAY_INTERLEAVE to read the array into anonymous memory (0 to map the file)
+ * \param pipelined whether the worker threads sort their parts while the rest of the array is read
+ * \param top_k number of largest elements to be selected instead of sorting the array (0 to sort it)
  * \param direction direction of the bitonic sort
  * \param n_workers number of worker threads
  */
-void init_config(config_t *config, char *file_path, int direction, int n_workers);
+void init_config(config_t *config, char *file_path, char *out_path, int mem_flags, int pipelined, int top_k,
+                 int direction, int n_workers);
 
 /**
  * \brief Initializes the array to be sorted.
@@ -89,8 +145,11 @@ void init_config(config_t *config, char *file_path, int direction, int n_workers
  * \param config pointer to the configuration of the program
  * \param arr pointer to the array to be sorted
  * \param size size of the array to be sorted
+ * \param elem_type type of the elements of the array
+ * \param map pointer to the memory mapping of the input file that contains the array (NULL if it was allocated)
+ * \param map_size size of the memory mapping
  */
-void init_arr(config_t *config, int *arr, int size);
+void init_arr(config_t *config, void *arr, int size, int elem_type, void *map, size_t map_size);
 
 /**
  * \brief Initializes the tasks mechanism.
@@ -116,6 +175,28 @@ void init_tasks(tasks_t *tasks, task_t *list, int size, int *is_thread_done);
  */
 void init_shared(shared_t *shared, config_t *config, tasks_t *tasks);
 
+/**
+ * \brief Selects the synchronization mode used to hand over the tasks.
+ *
+ * Should be called by the main thread after init_shared and before creating the distributor and worker threads.
+ * In spin mode, every worker thread takes part in every phase (set_tasks is always called with one task per worker
+ * thread).
+ *
+ * \param shared pointer to the shared area
+ * \param sync_mode SYNC_COND or SYNC_SPIN
+ * \param slots pointer to the task slots, one per worker thread (only used in spin mode)
+ */
+void init_sync(shared_t *shared, int sync_mode, task_slot_t *slots);
+
+/**
+ * \brief Waits until the worker threads are done with the tasks assigned to them.
+ *
+ * Should be called by the distributor thread to wait for the current tasks without assigning new ones.
+ *
+ * \param shared pointer to the shared area
+ */
+void wait_tasks(shared_t *shared);
+
 /**
  * \brief Assigns tasks to each worker thread.
  *
@@ -145,6 +226,7 @@ task_t get_task(shared_t *shared, int index);
  *
  * Should be called by a worker thread after finishing its task.
  * Decrements the number of tasks to be executed and signals the distributor thread if all tasks are done.
+ * In spin mode, waits at the end barrier of the phase instead.
  *
  * \param shared pointer to the shared area
  * \param index index of the worker thread
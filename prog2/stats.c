@@ -0,0 +1,306 @@
+/**
+ *  \file stats.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the statistics of the lockstep scheduler.
+ *
+ *  The distributor thread records each phase (the tasks handed over by one call to set_tasks) and the time it waited
+ *  in set_tasks for the previous phase to finish. Each worker thread records, for each phase, the time it waited in
+ *  get_task for its task and the time it spent executing it. The phase of a task is the number of tasks the worker
+ *  thread got before it, since every worker thread gets one task per phase. The NUMA node each task ran on is recorded
+ *  too, to tell, at the end, how many of the pages of the tasks are on the node of their worker thread.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "kernels.h"
+#include "memory.h"
+#include "stats.h"
+
+/** \brief Names of the task types, indexed by the *_TASK constants of const.h */
+static const char *task_names[] = {"sort", "merge", "end", "load", "level", "level pair", "quarters", "top-k",
+                                    "top-k merge"};
+
+/**
+ *  \brief Creates the statistics of a number of worker threads.
+ *
+ *  The phases beyond STATS_MAX_PHASES are not recorded.
+ *
+ *  \param n_workers number of worker threads
+ *
+ *  \return pointer to the statistics, NULL if there is no memory
+ */
+stats_t *stats_create(int n_workers) {
+    stats_t *stats = (stats_t *) malloc(sizeof(stats_t));
+    if (stats == NULL) {
+        return NULL;
+    }
+    stats->phases = (stats_phase_t *) calloc(STATS_MAX_PHASES, sizeof(stats_phase_t));
+    stats->tasks = (stats_task_t *) calloc((size_t) STATS_MAX_PHASES * n_workers, sizeof(stats_task_t));
+    if (stats->phases == NULL || stats->tasks == NULL) {
+        stats_destroy(stats);
+        return NULL;
+    }
+    stats->n_workers = n_workers;
+    stats->max_phases = STATS_MAX_PHASES;
+    stats->n_phases = 0;
+    stats->origin = stats_now();
+    return stats;
+}
+
+/**
+ *  \brief Reads the clock of the statistics.
+ *
+ *  \return monotonic time in nanoseconds
+ */
+uint64_t stats_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + (uint64_t) t.tv_nsec;
+}
+
+/**
+ *  \brief Records a phase.
+ *
+ *  Should be called by the distributor thread after each call to set_tasks.
+ *
+ *  \param stats pointer to the statistics
+ *  \param type type of the tasks of the phase
+ *  \param block number of elements of the blocks sorted or merged in the phase
+ *  \param half distance between the compared elements of the first level of the phase (0 for the sort and load)
+ *  \param wait_begin time when the distributor thread called set_tasks
+ *  \param wait_end time when set_tasks returned
+ */
+void stats_phase(stats_t *stats, int type, int block, int half, uint64_t wait_begin, uint64_t wait_end) {
+    if (stats->n_phases < stats->max_phases) {
+        stats->phases[stats->n_phases++] = (stats_phase_t) {type, block, half, wait_begin, wait_end};
+    }
+}
+
+/**
+ *  \brief Records the task of a worker thread in a phase.
+ *
+ *  \param stats pointer to the statistics
+ *  \param phase index of the phase
+ *  \param index index of the worker thread
+ *  \param task task executed
+ *  \param wait_begin time when the worker thread called get_task
+ *  \param begin time when get_task returned
+ *  \param end time when the task was finished
+ */
+void stats_task(stats_t *stats, int phase, int index, const task_t *task, uint64_t wait_begin, uint64_t begin,
+                uint64_t end) {
+    if (phase < stats->max_phases) {
+        int elem_size = kernel_ops(task->elem_type)->elem_size;
+        stats->tasks[(size_t) phase * stats->n_workers + index] =
+                (stats_task_t) {task->type, task->low_index, task->count, current_node(),
+                                (const char *) task->arr + (size_t) task->low_index * elem_size,
+                                (size_t) task->count * elem_size, wait_begin, begin, end};
+    }
+}
+
+/**
+ *  \brief Converts a duration from nanoseconds to milliseconds.
+ *
+ *  \param ns duration in nanoseconds
+ *
+ *  \return duration in milliseconds
+ */
+static double to_ms(uint64_t ns) {
+    return ns / 1.0e6;
+}
+
+/**
+ *  \brief Counts the sampled pages of a task that are on the NUMA node the task ran on and on other nodes.
+ *
+ *  \param task pointer to the task
+ *  \param local where the number of pages on the node of the task is added
+ *  \param remote where the number of pages on other nodes is added
+ *
+ *  \return 0 if the nodes of the pages were read, -1 otherwise
+ */
+static int count_pages(const stats_task_t *task, long *local, long *remote) {
+    void *pages[STATS_NUMA_SAMPLES];
+    int nodes[STATS_NUMA_SAMPLES];
+    if (task->bytes == 0 || task->node < 0) {
+        return 0;
+    }
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t n_pages = (task->bytes + page_size - 1) / page_size;
+    int n = n_pages < STATS_NUMA_SAMPLES ? (int) n_pages : STATS_NUMA_SAMPLES;
+    for (int i = 0; i < n; i++) {
+        pages[i] = (void *) (((uintptr_t) task->addr + (size_t) i * task->bytes / n) & ~(uintptr_t) (page_size - 1));
+    }
+    if (page_nodes(pages, n, nodes) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (nodes[i] == task->node) {
+            (*local)++;
+        } else if (nodes[i] >= 0) {
+            (*remote)++;
+        }
+    }
+    return 0;
+}
+
+/**
+ *  \brief Prints the summary table of the phases and of the worker threads.
+ *
+ *  For each phase: its duration (from the first task that started to the last one that finished), the fraction of that
+ *  time the worker threads were busy, the time they were idle (summed over the worker threads), the handoff since the
+ *  last task of the previous phase finished, the longest wait of a worker thread in get_task and the wait of the
+ *  distributor thread in the set_tasks that handed the phase over (for the previous phase to finish).
+ *
+ *  For each worker thread: its busy time, its wait in get_task, its number of tasks, and the fraction of the sampled
+ *  pages of its tasks that are on the NUMA node the tasks ran on (local) or on another node (remote), if the system
+ *  reports the nodes of the pages. Only the placement is sampled (STATS_NUMA_SAMPLES pages per task, after the sort),
+ *  not the accesses of the tasks.
+ *
+ *  Should be called after the distributor and worker threads have finished.
+ *
+ *  \param stats pointer to the statistics
+ *  \param stream stream where the table is printed
+ */
+void stats_print(const stats_t *stats, FILE *stream) {
+    int n_workers = stats->n_workers;
+    uint64_t total_time = 0, total_idle = 0, merge_idle = 0, total_handoff = 0, total_set = 0, prev_end = 0;
+    fprintf(stream, "[STAT] %5s %-10s %10s %10s %10s %8s %10s %11s %12s %13s\n", "Phase", "Type", "Block", "Half",
+            "Time(ms)", "Busy(%)", "Idle(ms)", "Handoff(ms)", "Get_task(ms)", "Set_tasks(ms)");
+    for (int p = 0; p < stats->n_phases; p++) {
+        const stats_phase_t *phase = &stats->phases[p];
+        const stats_task_t *tasks = &stats->tasks[(size_t) p * n_workers];
+        uint64_t start = UINT64_MAX, end = 0, busy = 0, max_wait = 0;
+        for (int i = 0; i < n_workers; i++) {
+            start = tasks[i].begin < start ? tasks[i].begin : start;
+            end = tasks[i].end > end ? tasks[i].end : end;
+            busy += tasks[i].end - tasks[i].begin;
+            uint64_t wait = tasks[i].begin - tasks[i].wait_begin;
+            max_wait = wait > max_wait ? wait : max_wait;
+        }
+        uint64_t time = end - start;
+        uint64_t idle = time * n_workers - busy;
+        uint64_t handoff = p > 0 && start > prev_end ? start - prev_end : 0;
+        uint64_t set = phase->wait_end - phase->wait_begin;
+        fprintf(stream, "[STAT] %5d %-10s %10d %10d %10.3f %8.1f %10.3f %11.3f %12.3f %13.3f\n", p,
+                task_names[phase->type], phase->block, phase->half, to_ms(time),
+                time > 0 ? 100.0 * busy / ((double) time * n_workers) : 100.0, to_ms(idle), to_ms(handoff),
+                to_ms(max_wait), to_ms(set));
+        total_time += time;
+        total_idle += idle;
+        if (phase->type == MERGE_TASK || phase->type == MERGE_LEVEL_TASK) {
+            merge_idle += idle;
+        }
+        total_handoff += handoff;
+        total_set += set;
+        prev_end = end;
+    }
+    fprintf(stream, "[STAT] Phases: %d; time in phases: %.3f ms; idle: %.3f ms (merge phases: %.3f ms); "
+                    "handoff: %.3f ms; set_tasks: %.3f ms\n", stats->n_phases, to_ms(total_time), to_ms(total_idle),
+            to_ms(merge_idle), to_ms(total_handoff), to_ms(total_set));
+
+    // totals of each worker thread
+    fprintf(stream, "[STAT] %6s %10s %12s %6s %9s %10s\n", "Worker", "Busy(ms)", "Get_task(ms)", "Tasks", "Local(%)",
+            "Remote(%)");
+    int numa = 1;
+    for (int i = 0; i < n_workers; i++) {
+        uint64_t busy = 0, wait = 0;
+        int n_tasks = 0;
+        long local = 0, remote = 0;
+        for (int p = 0; p < stats->n_phases; p++) {
+            const stats_task_t *task = &stats->tasks[(size_t) p * n_workers + i];
+            busy += task->end - task->begin;
+            wait += task->begin - task->wait_begin;
+            n_tasks += task->count > 0;
+            if (numa && count_pages(task, &local, &remote) != 0) {
+                numa = 0;
+            }
+        }
+        long sampled = local + remote;
+        double local_pct = numa && sampled > 0 ? 100.0 * local / sampled : 0.0;
+        double remote_pct = numa && sampled > 0 ? 100.0 * remote / sampled : 0.0;
+        fprintf(stream, "[STAT] %6d %10.3f %12.3f %6d %9.1f %10.1f\n", i, to_ms(busy), to_ms(wait), n_tasks, local_pct,
+                remote_pct);
+    }
+    if (!numa) {
+        fprintf(stream, "[STAT] The system does not report the NUMA nodes of the pages\n");
+    }
+}
+
+/**
+ *  \brief Writes a complete event of the Chrome trace event format.
+ *
+ *  \param file trace file
+ *  \param stats pointer to the statistics
+ *  \param name name of the event
+ *  \param tid thread of the event (0 for the distributor thread, 1 + index for the worker threads)
+ *  \param begin time when the event began
+ *  \param end time when the event ended
+ *  \param phase index of the phase of the event
+ */
+static void write_event(FILE *file, const stats_t *stats, const char *name, int tid, uint64_t begin, uint64_t end,
+                        int phase) {
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                  "\"args\":{\"phase\":%d", name, tid, (begin - stats->origin) / 1.0e3, (end - begin) / 1.0e3, phase);
+}
+
+/**
+ *  \brief Writes the timeline in the Chrome trace event format.
+ *
+ *  The distributor thread is thread 0, with an event for each wait in set_tasks. Worker thread i is thread i + 1, with
+ *  an event for each wait in get_task and for each task.
+ *
+ *  Should be called after the distributor and worker threads have finished.
+ *
+ *  \param stats pointer to the statistics
+ *  \param path path to the trace file
+ *
+ *  \return EXIT_SUCCESS if the file was written, EXIT_FAILURE otherwise
+ */
+int stats_write_trace(const stats_t *stats, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return EXIT_FAILURE;
+    }
+    fprintf(file, "{\"traceEvents\":[\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+                  "\"args\":{\"name\":\"distributor\"}}");
+    for (int i = 0; i < stats->n_workers; i++) {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"name\":\"worker %d\"}}", i + 1, i);
+    }
+    for (int p = 0; p < stats->n_phases; p++) {
+        const stats_phase_t *phase = &stats->phases[p];
+        write_event(file, stats, "set_tasks", 0, phase->wait_begin, phase->wait_end, p);
+        fprintf(file, ",\"type\":\"%s\",\"block\":%d,\"half\":%d}}", task_names[phase->type], phase->block,
+                phase->half);
+        for (int i = 0; i < stats->n_workers; i++) {
+            const stats_task_t *task = &stats->tasks[(size_t) p * stats->n_workers + i];
+            write_event(file, stats, "get_task", i + 1, task->wait_begin, task->begin, p);
+            fprintf(file, "}}");
+            write_event(file, stats, task_names[task->type], i + 1, task->begin, task->end, p);
+            fprintf(file, ",\"low_index\":%d,\"count\":%d,\"node\":%d}}", task->low_index, task->count, task->node);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ *  \brief Frees the statistics.
+ *
+ *  \param stats pointer to the statistics
+ */
+void stats_destroy(stats_t *stats) {
+    free(stats->phases);
+    free(stats->tasks);
+    free(stats);
+}
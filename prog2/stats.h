@@ -0,0 +1,146 @@
+/**
+ *  \file stats.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the statistics of the lockstep scheduler.
+ *
+ *  The distributor thread records each phase (the tasks handed over by one call to set_tasks) and the time it waited
+ *  in set_tasks for the previous phase to finish. Each worker thread records, for each phase, the time it waited in
+ *  get_task for its task and the time it spent executing it. The phase of a task is the number of tasks the worker
+ *  thread got before it, since every worker thread gets one task per phase. The NUMA node each task ran on is recorded
+ *  too, to tell, at the end, how many of the pages of the tasks are on the node of their worker thread.
+ *
+ *  Operations:
+ *  - stats_create: creates the statistics of a number of worker threads
+ *  - stats_now: reads the clock of the statistics
+ *  - stats_phase: records a phase (distributor thread)
+ *  - stats_task: records the task of a worker thread in a phase (worker threads)
+ *  - stats_print: prints the summary table of the phases and of the worker threads
+ *  - stats_write_trace: writes the timeline in the Chrome trace event format (chrome://tracing, Perfetto)
+ *  - stats_destroy: frees the statistics
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "shared.h"
+
+/** \brief Task of a worker thread in a phase (times in nanoseconds) */
+typedef struct {
+    int type;
+    int low_index;
+    int count;
+    int node;
+    const char *addr;
+    size_t bytes;
+    uint64_t wait_begin;
+    uint64_t begin;
+    uint64_t end;
+} stats_task_t;
+
+/** \brief Phase handed over by the distributor thread (times in nanoseconds) */
+typedef struct {
+    int type;
+    int block;
+    int half;
+    uint64_t wait_begin;
+    uint64_t wait_end;
+} stats_phase_t;
+
+/** \brief Statistics of the lockstep scheduler */
+typedef struct stats {
+    int n_workers;
+    int max_phases;
+    int n_phases;
+    uint64_t origin;
+    stats_phase_t *phases;
+    stats_task_t *tasks;
+} stats_t;
+
+/**
+ *  \brief Creates the statistics of a number of worker threads.
+ *
+ *  The phases beyond STATS_MAX_PHASES are not recorded.
+ *
+ *  \param n_workers number of worker threads
+ *
+ *  \return pointer to the statistics, NULL if there is no memory
+ */
+stats_t *stats_create(int n_workers);
+
+/**
+ *  \brief Reads the clock of the statistics.
+ *
+ *  \return monotonic time in nanoseconds
+ */
+uint64_t stats_now(void);
+
+/**
+ *  \brief Records a phase.
+ *
+ *  Should be called by the distributor thread after each call to set_tasks.
+ *
+ *  \param stats pointer to the statistics
+ *  \param type type of the tasks of the phase
+ *  \param block number of elements of the blocks sorted or merged in the phase
+ *  \param half distance between the compared elements of the first level of the phase (0 for the sort and load)
+ *  \param wait_begin time when the distributor thread called set_tasks
+ *  \param wait_end time when set_tasks returned
+ */
+void stats_phase(stats_t *stats, int type, int block, int half, uint64_t wait_begin, uint64_t wait_end);
+
+/**
+ *  \brief Records the task of a worker thread in a phase.
+ *
+ *  \param stats pointer to the statistics
+ *  \param phase index of the phase
+ *  \param index index of the worker thread
+ *  \param task task executed
+ *  \param wait_begin time when the worker thread called get_task
+ *  \param begin time when get_task returned
+ *  \param end time when the task was finished
+ */
+void stats_task(stats_t *stats, int phase, int index, const task_t *task, uint64_t wait_begin, uint64_t begin,
+                uint64_t end);
+
+/**
+ *  \brief Prints the summary table of the phases and of the worker threads.
+ *
+ *  The table of the worker threads includes the fraction of the sampled pages of their tasks that are on the NUMA node
+ *  the tasks ran on (local) or on another node (remote), if the system reports the nodes of the pages. Only the
+ *  placement is sampled (STATS_NUMA_SAMPLES pages per task, after the sort), not the accesses of the tasks.
+ *
+ *  Should be called after the distributor and worker threads have finished.
+ *
+ *  \param stats pointer to the statistics
+ *  \param stream stream where the table is printed
+ */
+void stats_print(const stats_t *stats, FILE *stream);
+
+/**
+ *  \brief Writes the timeline in the Chrome trace event format.
+ *
+ *  Should be called after the distributor and worker threads have finished.
+ *
+ *  \param stats pointer to the statistics
+ *  \param path path to the trace file
+ *
+ *  \return EXIT_SUCCESS if the file was written, EXIT_FAILURE otherwise
+ */
+int stats_write_trace(const stats_t *stats, const char *path);
+
+/**
+ *  \brief Frees the statistics.
+ *
+ *  \param stats pointer to the statistics
+ */
+void stats_destroy(stats_t *stats);
+
+#endif /* STATS_H */
@@ -0,0 +1,574 @@
+/**
+ *  \file steal.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the work-stealing scheduler.
+ *
+ *  The deques follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al., 2013): the owner
+ *  synchronizes with the thieves only when they race for the last task of the deque. Full deques are doubled, and the
+ *  old arrays are kept until the pool is destroyed, since a thief may still be reading them.
+ *
+ *  Tasks pushed by threads that are not worker threads of the pool go to a mutex-protected injection queue.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#include "steal.h"
+
+/** \brief Initial number of tasks of a deque */
+#define DEQUE_INITIAL_SIZE 256
+
+/** \brief Number of rounds of steal attempts before an idle worker thread goes to sleep */
+#define IDLE_ROUNDS 64
+
+/** \brief Deque of the worker thread that is running (NULL if it is not a worker thread) */
+static __thread steal_deque_t *current_deque = NULL;
+
+/**
+ *  \brief Allocates the circular array of a deque.
+ *
+ *  \param size number of tasks of the array (power of 2)
+ *
+ *  \return pointer to the array, NULL if it could not be allocated
+ */
+static steal_array_t *array_alloc(int64_t size) {
+    steal_array_t *array = (steal_array_t *) malloc(sizeof(steal_array_t) + size * sizeof(steal_task_t *));
+    if (array != NULL) {
+        array->size = size;
+        array->retired = NULL;
+    }
+    return array;
+}
+
+/**
+ *  \brief Pushes a task at the bottom of the deque of the calling worker thread.
+ *
+ *  \param deque deque of the calling worker thread
+ *  \param task task to push
+ */
+static void deque_push(steal_deque_t *deque, steal_task_t *task) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    steal_array_t *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    if (bottom - top > array->size - 1) {
+        // full deque: double it, keeping the old array for the thieves that may still read it
+        steal_array_t *bigger = array_alloc(2 * array->size);
+        if (bigger == NULL) {
+            fprintf(stderr, "[STEAL] Could not allocate memory for a deque\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int64_t i = top; i < bottom; i++) {
+            atomic_store_explicit(&bigger->buffer[i & (bigger->size - 1)],
+                                  atomic_load_explicit(&array->buffer[i & (array->size - 1)], memory_order_relaxed),
+                                  memory_order_relaxed);
+        }
+        bigger->retired = array;
+        atomic_store_explicit(&deque->array, bigger, memory_order_release);
+        array = bigger;
+    }
+    atomic_store_explicit(&array->buffer[bottom & (array->size - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+/**
+ *  \brief Takes the task at the bottom of the deque of the calling worker thread.
+ *
+ *  \param deque deque of the calling worker thread
+ *
+ *  \return task, NULL if the deque is empty
+ */
+static steal_task_t *deque_take(steal_deque_t *deque) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    steal_array_t *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    steal_task_t *task = NULL;
+    if (top <= bottom) {
+        task = atomic_load_explicit(&array->buffer[bottom & (array->size - 1)], memory_order_relaxed);
+        if (top == bottom) {
+            // last task: race against the thieves
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed)) {
+                task = NULL;
+            }
+            atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/**
+ *  \brief Steals the task at the top of a deque.
+ *
+ *  \param deque deque of another worker thread
+ *
+ *  \return task, NULL if the deque is empty or another thread won the race for the task
+ */
+static steal_task_t *deque_steal(steal_deque_t *deque) {
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NULL;
+    }
+    steal_array_t *array = atomic_load_explicit(&deque->array, memory_order_acquire);
+    steal_task_t *task = atomic_load_explicit(&array->buffer[top & (array->size - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+/**
+ *  \brief Checks if there is a task in any deque or in the injection queue.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return 1 if there is a task, 0 otherwise
+ */
+static int has_work(steal_pool_t *pool) {
+    if (atomic_load(&pool->n_injected) > 0) {
+        return 1;
+    }
+    for (int i = 0; i < pool->n_workers; i++) {
+        if (atomic_load(&pool->deques[i].top) < atomic_load(&pool->deques[i].bottom)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ *  \brief Wakes up a sleeping worker thread, if there is one.
+ *
+ *  \param pool pointer to the pool
+ */
+static void wake_worker(steal_pool_t *pool) {
+    // pairs with the increment of n_sleeping before a worker thread checks for work and goes to sleep
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->n_sleeping, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_signal(&pool->work_ready);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+/**
+ *  \brief Pushes a task that is ready to run.
+ *
+ *  Worker threads of the pool push it to their own deque, other threads to the injection queue.
+ *
+ *  \param pool pointer to the pool
+ *  \param task task to push
+ */
+static void push_task(steal_pool_t *pool, steal_task_t *task) {
+    if (current_deque != NULL && current_deque->pool == pool) {
+        deque_push(current_deque, task);
+    } else {
+        pthread_mutex_lock(&pool->mutex);
+        task->next = NULL;
+        if (pool->injected_tail == NULL) {
+            pool->injected_head = task;
+        } else {
+            pool->injected_tail->next = task;
+        }
+        pool->injected_tail = task;
+        atomic_fetch_add(&pool->n_injected, 1);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    wake_worker(pool);
+}
+
+/**
+ *  \brief Pops a task from the injection queue.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return task, NULL if the queue is empty
+ */
+static steal_task_t *pop_injected(steal_pool_t *pool) {
+    if (atomic_load(&pool->n_injected) == 0) {
+        return NULL;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    steal_task_t *task = pool->injected_head;
+    if (task != NULL) {
+        pool->injected_head = task->next;
+        if (pool->injected_head == NULL) {
+            pool->injected_tail = NULL;
+        }
+        atomic_fetch_sub(&pool->n_injected, 1);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return task;
+}
+
+/**
+ *  \brief Finds a task for a worker thread: from its own deque, from another deque, or from the injection queue.
+ *
+ *  \param deque deque of the worker thread
+ *
+ *  \return task, NULL if none was found
+ */
+static steal_task_t *find_task(steal_deque_t *deque) {
+    steal_pool_t *pool = deque->pool;
+    steal_task_t *task = deque_take(deque);
+    if (task != NULL) {
+        return task;
+    }
+    // try the other deques, starting at a random victim
+    int start = (int) (rand_r(&deque->seed) % pool->n_workers);
+    for (int i = 0; i < pool->n_workers; i++) {
+        int victim = (start + i) % pool->n_workers;
+        if (victim != deque->index && (task = deque_steal(&pool->deques[victim])) != NULL) {
+            deque->n_steals++;
+            return task;
+        }
+    }
+    return pop_injected(pool);
+}
+
+/**
+ *  \brief Worker thread function that runs tasks until the pool is destroyed.
+ *
+ *  \param arg pointer to the deque of the worker thread
+ */
+static void *steal_worker(void *arg) {
+    steal_deque_t *deque = (steal_deque_t *) arg;
+    steal_pool_t *pool = deque->pool;
+    current_deque = deque;
+
+    int idle_rounds = 0;
+    while (!atomic_load(&pool->stop)) {
+        steal_task_t *task = find_task(deque);
+        if (task != NULL) {
+            task->run(pool, task);
+            idle_rounds = 0;
+        } else if (++idle_rounds < IDLE_ROUNDS) {
+            sched_yield();
+        } else {
+            // no work: sleep until a task is pushed (checked after announcing the sleep, so no wake-up is lost)
+            pthread_mutex_lock(&pool->mutex);
+            atomic_fetch_add(&pool->n_sleeping, 1);
+            if (!atomic_load(&pool->stop) && !has_work(pool)) {
+                pthread_cond_wait(&pool->work_ready, &pool->mutex);
+            }
+            atomic_fetch_sub(&pool->n_sleeping, 1);
+            pthread_mutex_unlock(&pool->mutex);
+            idle_rounds = 0;
+        }
+    }
+    return (void *) EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Creates the worker threads of a pool.
+ *
+ *  \param pool pointer to the pool
+ *  \param n_workers number of worker threads
+ *
+ *  \return EXIT_SUCCESS if the pool was created, EXIT_FAILURE otherwise
+ */
+int steal_init(steal_pool_t *pool, int n_workers) {
+    pool->n_workers = n_workers;
+    pool->threads = (pthread_t *) malloc(n_workers * sizeof(pthread_t));
+    pool->deques = (steal_deque_t *) aligned_alloc(_Alignof(steal_deque_t), n_workers * sizeof(steal_deque_t));
+    if (pool->threads == NULL || pool->deques == NULL) {
+        fprintf(stderr, "[STEAL] Could not allocate memory for the worker threads\n");
+        free(pool->threads);
+        free(pool->deques);
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->run_done, NULL);
+    atomic_init(&pool->n_sleeping, 0);
+    atomic_init(&pool->n_injected, 0);
+    atomic_init(&pool->stop, 0);
+    pool->injected_head = NULL;
+    pool->injected_tail = NULL;
+
+    for (int i = 0; i < n_workers; i++) {
+        steal_deque_t *deque = &pool->deques[i];
+        atomic_init(&deque->top, 0);
+        atomic_init(&deque->bottom, 0);
+        steal_array_t *array = array_alloc(DEQUE_INITIAL_SIZE);
+        if (array == NULL) {
+            fprintf(stderr, "[STEAL] Could not allocate memory for a deque\n");
+            exit(EXIT_FAILURE);
+        }
+        atomic_init(&deque->array, array);
+        deque->n_steals = 0;
+        deque->seed = (unsigned int) i + 1;
+        deque->index = i;
+        deque->pool = pool;
+    }
+    for (int i = 0; i < n_workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, steal_worker, &pool->deques[i]) != 0) {
+            fprintf(stderr, "[STEAL] Could not create worker thread %d\n", i + 1);
+            // stop the worker threads already created
+            for (int j = i; j < n_workers; j++) {
+                free(atomic_load(&pool->deques[j].array));
+            }
+            pool->n_workers = i;
+            steal_destroy(pool);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Signals the completion of the tasks of a latch to the threads that wait for it.
+ *
+ *  \param pool pointer to the pool
+ *  \param task latch
+ */
+static void release_latch(steal_pool_t *pool, steal_task_t *task) {
+    steal_latch_t *latch = (steal_latch_t *) task;
+    pthread_mutex_lock(&pool->mutex);
+    // the latch may be freed as soon as done is set, so it is not accessed afterwards
+    atomic_store(&latch->done, 1);
+    pthread_cond_broadcast(&pool->run_done);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ *  \brief Submits tasks to a pool without waiting for them.
+ *
+ *  Can be called by any thread. The latch is done when all the tasks and their descendants complete, and must stay
+ *  valid until then.
+ *
+ *  \param pool pointer to the pool
+ *  \param tasks tasks to submit
+ *  \param n_tasks number of tasks (0 makes the latch done immediately)
+ *  \param latch latch that signals the completion of the tasks
+ */
+void steal_submit(steal_pool_t *pool, steal_task_t **tasks, int n_tasks, steal_latch_t *latch) {
+    latch->task.run = release_latch;
+    latch->task.parent = NULL;
+    atomic_init(&latch->task.pending, n_tasks);
+    atomic_init(&latch->done, n_tasks == 0);
+    for (int i = 0; i < n_tasks; i++) {
+        tasks[i]->parent = &latch->task;
+        push_task(pool, tasks[i]);
+    }
+}
+
+/**
+ *  \brief Checks if the tasks of a latch are complete, without blocking.
+ *
+ *  \param latch latch of the tasks
+ *
+ *  \return 1 if the tasks are complete, 0 otherwise
+ */
+int steal_latch_done(steal_latch_t *latch) {
+    return atomic_load(&latch->done);
+}
+
+/**
+ *  \brief Waits for the tasks of a latch to complete.
+ *
+ *  Should be called by a thread that is not a worker thread of the pool.
+ *
+ *  \param pool pointer to the pool
+ *  \param latch latch of the tasks
+ */
+void steal_wait(steal_pool_t *pool, steal_latch_t *latch) {
+    if (atomic_load(&latch->done)) {
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    while (!atomic_load(&latch->done)) {
+        pthread_cond_wait(&pool->run_done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ *  \brief Runs a task and its descendants on a pool, and waits for them to complete.
+ *
+ *  Should be called by a thread that is not a worker thread of the pool.
+ *
+ *  \param pool pointer to the pool
+ *  \param task task to run
+ */
+void steal_run(steal_pool_t *pool, steal_task_t *task) {
+    steal_latch_t latch;
+    steal_submit(pool, &task, 1, &latch);
+    steal_wait(pool, &latch);
+}
+
+/**
+ *  \brief Forks children of a task, which completes the task.
+ *
+ *  With a continuation, the continuation runs after all the children complete and takes the place of the task for
+ *  its parent. Without one, the children take the place of the task for its parent (tail fork).
+ *
+ *  \param pool pointer to the pool
+ *  \param task task that forks the children
+ *  \param continuation task that runs after the children complete (NULL for a tail fork)
+ *  \param children children to fork
+ *  \param n_children number of children (at least 1)
+ */
+void steal_fork(steal_pool_t *pool, steal_task_t *task, steal_task_t *continuation, steal_task_t **children,
+                int n_children) {
+    steal_task_t *parent = task->parent;
+    if (continuation != NULL) {
+        continuation->parent = parent;
+        atomic_store_explicit(&continuation->pending, n_children, memory_order_relaxed);
+        parent = continuation;
+    } else if (parent != NULL) {
+        // the parent now waits for the children instead of the task
+        atomic_fetch_add(&parent->pending, n_children - 1);
+    }
+    for (int i = 0; i < n_children; i++) {
+        children[i]->parent = parent;
+        push_task(pool, children[i]);
+    }
+}
+
+/**
+ *  \brief Completes a task that did not fork, which may make the continuation of its parent ready.
+ *
+ *  \param pool pointer to the pool
+ *  \param task task that completes
+ */
+void steal_done(steal_pool_t *pool, steal_task_t *task) {
+    steal_task_t *parent = task->parent;
+    if (parent != NULL && atomic_fetch_sub_explicit(&parent->pending, 1, memory_order_acq_rel) == 1) {
+        // last child: the continuation is ready
+        if (parent->run == release_latch) {
+            release_latch(pool, parent);
+        } else {
+            push_task(pool, parent);
+        }
+    }
+}
+
+/**
+ *  \brief Allocates a phase task of a multi-phase job.
+ *
+ *  Exits the program if there is no memory for the task, like the allocations of the tasks inside a running job.
+ *
+ *  \param run function that executes the tasks of the job (it frees each task with free)
+ *  \param state state shared by the tasks of the job
+ *  \param phase phase of the task
+ *  \param index chunk, run or bucket of the task
+ *
+ *  \return pointer to the task
+ */
+steal_task_t *steal_phase_job(steal_fn_t run, void *state, int phase, int index) {
+    steal_phase_t *job = (steal_phase_t *) malloc(sizeof(steal_phase_t));
+    if (job == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for a task\n");
+        exit(EXIT_FAILURE);
+    }
+    job->header.run = run;
+    job->phase = phase;
+    job->index = index;
+    job->state = state;
+    return &job->header;
+}
+
+/**
+ *  \brief Forks one task of a phase per chunk, run or bucket of a multi-phase job, and continues with another phase.
+ *
+ *  The children and the continuation have the function and the state of the task that forks them.
+ *
+ *  \param pool pointer to the pool
+ *  \param task phase task that forks (a steal_phase_t)
+ *  \param phase phase of the children
+ *  \param n_children number of children (at least 1), with indexes 0 to n_children - 1
+ *  \param next_phase phase of the continuation (index 0)
+ */
+void steal_fork_phase(steal_pool_t *pool, steal_task_t *task, int phase, int n_children, int next_phase) {
+    steal_phase_t *job = (steal_phase_t *) task;
+    steal_task_t **children = (steal_task_t **) malloc(n_children * sizeof(steal_task_t *));
+    if (children == NULL) {
+        fprintf(stderr, "[LIB] Could not allocate memory for the tasks\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n_children; i++) {
+        children[i] = steal_phase_job(task->run, job->state, phase, i);
+    }
+    steal_fork(pool, task, steal_phase_job(task->run, job->state, next_phase, 0), children, n_children);
+    free(children);
+}
+
+/**
+ *  \brief Computes the number of chunks of the phases of a job that split an array among the worker threads.
+ *
+ *  \param pool pointer to the pool
+ *  \param size number of elements in the array
+ *
+ *  \return number of chunks: 4 per worker thread (for load balance), or 1 for arrays of up to that many elements
+ */
+int steal_chunk_count(steal_pool_t *pool, int size) {
+    return 4 * pool->n_workers < size ? 4 * pool->n_workers : 1;
+}
+
+/**
+ *  \brief Gets the index of the worker thread of a pool that runs the calling task.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return index of the worker thread (0 to n_workers - 1), -1 if the caller is not a worker thread of the pool
+ */
+int steal_worker_index(steal_pool_t *pool) {
+    return current_deque != NULL && current_deque->pool == pool ? current_deque->index : -1;
+}
+
+/**
+ *  \brief Gets the number of tasks stolen by the worker threads of a pool.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return number of tasks stolen since the pool was created
+ */
+long steal_count(steal_pool_t *pool) {
+    long n_steals = 0;
+    for (int i = 0; i < pool->n_workers; i++) {
+        n_steals += pool->deques[i].n_steals;
+    }
+    return n_steals;
+}
+
+/**
+ *  \brief Terminates the worker threads of a pool and frees its resources.
+ *
+ *  \param pool pointer to the pool
+ */
+void steal_destroy(steal_pool_t *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->n_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->n_workers; i++) {
+        steal_array_t *array = atomic_load(&pool->deques[i].array);
+        while (array != NULL) {
+            steal_array_t *retired = array->retired;
+            free(array);
+            array = retired;
+        }
+    }
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->run_done);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+    free(pool->deques);
+}
@@ -0,0 +1,251 @@
+/**
+ *  \file steal.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the work-stealing scheduler.
+ *
+ *  Each worker thread owns a Chase-Lev deque of tasks: it pushes and takes tasks at the bottom of its own deque
+ *  (LIFO, so it works on the most recently forked, cache-hot task), and steals tasks at the top of the deques of the
+ *  other worker threads (FIFO, so it steals the largest pending tasks) when its own deque is empty. Worker threads
+ *  that find no work sleep until a task is pushed.
+ *
+ *  Tasks follow a continuation-passing fork/join model: a task that forks children does not wait for them, it hands
+ *  a continuation task that runs when the last child completes. No thread ever blocks on a join.
+ *
+ *  Operations:
+ *  - steal_init: creates the worker threads of a pool
+ *  - steal_submit: submits tasks to a pool without waiting for them, their completion is signaled by a latch
+ *  - steal_latch_done: checks if the tasks of a latch are complete
+ *  - steal_wait: waits for the tasks of a latch to complete
+ *  - steal_run: runs a task and its descendants on a pool, and waits for them to complete
+ *  - steal_fork: forks children of a task (called by a task)
+ *  - steal_done: completes a task that did not fork (called by a task)
+ *  - steal_phase_job: allocates a phase task of a multi-phase job
+ *  - steal_fork_phase: forks one task of a phase per chunk of a job, and continues with the next phase
+ *  - steal_chunk_count: computes the number of chunks of the phases of a job
+ *  - steal_worker_index: gets the index of the worker thread that runs the calling task
+ *  - steal_destroy: terminates the worker threads of a pool
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef STEAL_H
+#define STEAL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+typedef struct steal_pool steal_pool_t;
+typedef struct steal_task steal_task_t;
+
+/**
+ *  \brief Function that executes a task.
+ *
+ *  It must finish the task with exactly one call to steal_done or steal_fork, after which the task belongs to the
+ *  function again (it may be freed or reused).
+ */
+typedef void (*steal_fn_t)(steal_pool_t *pool, steal_task_t *task);
+
+/** \brief Header of a task of the work-stealing scheduler, embedded as the first member of the actual task */
+struct steal_task {
+    steal_fn_t run;
+    steal_task_t *parent;
+    atomic_int pending;
+    steal_task_t *next;
+};
+
+/**
+ *  \brief Task of a phase of a multi-phase job (the sorts of the library), on a chunk, run or bucket.
+ *
+ *  The tasks of a job share its function and its state, and the function dispatches on the phase: each phase forks
+ *  one task per chunk and continues with the next phase (steal_fork_phase).
+ */
+typedef struct {
+    steal_task_t header;
+    int phase;
+    int index;
+    void *state;
+} steal_phase_t;
+
+/** \brief Completion of submitted tasks: done when the tasks and all their descendants complete */
+typedef struct {
+    steal_task_t task;
+    atomic_int done;
+} steal_latch_t;
+
+/** \brief Circular array of a Chase-Lev deque */
+typedef struct steal_array {
+    int64_t size;
+    struct steal_array *retired;
+    _Atomic(steal_task_t *) buffer[];
+} steal_array_t;
+
+/** \brief Chase-Lev deque of a worker thread, aligned to a cache line to avoid false sharing */
+typedef struct {
+    _Alignas(64) atomic_int_fast64_t top;
+    _Alignas(64) atomic_int_fast64_t bottom;
+    _Atomic(steal_array_t *) array;
+    long n_steals;
+    unsigned int seed;
+    int index;
+    steal_pool_t *pool;
+} steal_deque_t;
+
+/** \brief Pool of worker threads of the work-stealing scheduler */
+struct steal_pool {
+    int n_workers;
+    pthread_t *threads;
+    steal_deque_t *deques;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t run_done;
+    atomic_int n_sleeping;
+    atomic_int n_injected;
+    atomic_int stop;
+    steal_task_t *injected_head;
+    steal_task_t *injected_tail;
+};
+
+/**
+ *  \brief Creates the worker threads of a pool.
+ *
+ *  \param pool pointer to the pool
+ *  \param n_workers number of worker threads
+ *
+ *  \return EXIT_SUCCESS if the pool was created, EXIT_FAILURE otherwise
+ */
+int steal_init(steal_pool_t *pool, int n_workers);
+
+/**
+ *  \brief Submits tasks to a pool without waiting for them.
+ *
+ *  Can be called by any thread. The latch is done when all the tasks and their descendants complete, and must stay
+ *  valid until then.
+ *
+ *  \param pool pointer to the pool
+ *  \param tasks tasks to submit
+ *  \param n_tasks number of tasks (0 makes the latch done immediately)
+ *  \param latch latch that signals the completion of the tasks
+ */
+void steal_submit(steal_pool_t *pool, steal_task_t **tasks, int n_tasks, steal_latch_t *latch);
+
+/**
+ *  \brief Checks if the tasks of a latch are complete, without blocking.
+ *
+ *  \param latch latch of the tasks
+ *
+ *  \return 1 if the tasks are complete, 0 otherwise
+ */
+int steal_latch_done(steal_latch_t *latch);
+
+/**
+ *  \brief Waits for the tasks of a latch to complete.
+ *
+ *  Should be called by a thread that is not a worker thread of the pool.
+ *
+ *  \param pool pointer to the pool
+ *  \param latch latch of the tasks
+ */
+void steal_wait(steal_pool_t *pool, steal_latch_t *latch);
+
+/**
+ *  \brief Runs a task and its descendants on a pool, and waits for them to complete.
+ *
+ *  Should be called by a thread that is not a worker thread of the pool.
+ *
+ *  \param pool pointer to the pool
+ *  \param task task to run
+ */
+void steal_run(steal_pool_t *pool, steal_task_t *task);
+
+/**
+ *  \brief Forks children of a task, which completes the task.
+ *
+ *  With a continuation, the continuation runs after all the children complete and takes the place of the task for
+ *  its parent. Without one, the children take the place of the task for its parent (tail fork).
+ *
+ *  \param pool pointer to the pool
+ *  \param task task that forks the children
+ *  \param continuation task that runs after the children complete (NULL for a tail fork)
+ *  \param children children to fork
+ *  \param n_children number of children (at least 1)
+ */
+void steal_fork(steal_pool_t *pool, steal_task_t *task, steal_task_t *continuation, steal_task_t **children,
+                int n_children);
+
+/**
+ *  \brief Completes a task that did not fork, which may make the continuation of its parent ready.
+ *
+ *  \param pool pointer to the pool
+ *  \param task task that completes
+ */
+void steal_done(steal_pool_t *pool, steal_task_t *task);
+
+/**
+ *  \brief Allocates a phase task of a multi-phase job.
+ *
+ *  Exits the program if there is no memory for the task, like the allocations of the tasks inside a running job.
+ *
+ *  \param run function that executes the tasks of the job (it frees each task with free)
+ *  \param state state shared by the tasks of the job
+ *  \param phase phase of the task
+ *  \param index chunk, run or bucket of the task
+ *
+ *  \return pointer to the task
+ */
+steal_task_t *steal_phase_job(steal_fn_t run, void *state, int phase, int index);
+
+/**
+ *  \brief Forks one task of a phase per chunk, run or bucket of a multi-phase job, and continues with another phase.
+ *
+ *  The children and the continuation have the function and the state of the task that forks them.
+ *
+ *  \param pool pointer to the pool
+ *  \param task phase task that forks (a steal_phase_t)
+ *  \param phase phase of the children
+ *  \param n_children number of children (at least 1), with indexes 0 to n_children - 1
+ *  \param next_phase phase of the continuation (index 0)
+ */
+void steal_fork_phase(steal_pool_t *pool, steal_task_t *task, int phase, int n_children, int next_phase);
+
+/**
+ *  \brief Computes the number of chunks of the phases of a job that split an array among the worker threads.
+ *
+ *  \param pool pointer to the pool
+ *  \param size number of elements in the array
+ *
+ *  \return number of chunks: 4 per worker thread (for load balance), or 1 for arrays of up to that many elements
+ */
+int steal_chunk_count(steal_pool_t *pool, int size);
+
+/**
+ *  \brief Gets the index of the worker thread of a pool that runs the calling task.
+ *
+ *  A worker thread runs one task at a time, so per-worker scratch memory indexed by it is never shared by two tasks.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return index of the worker thread (0 to n_workers - 1), -1 if the caller is not a worker thread of the pool
+ */
+int steal_worker_index(steal_pool_t *pool);
+
+/**
+ *  \brief Gets the number of tasks stolen by the worker threads of a pool.
+ *
+ *  \param pool pointer to the pool
+ *
+ *  \return number of tasks stolen since the pool was created
+ */
+long steal_count(steal_pool_t *pool);
+
+/**
+ *  \brief Terminates the worker threads of a pool and frees its resources.
+ *
+ *  \param pool pointer to the pool
+ */
+void steal_destroy(steal_pool_t *pool);
+
+#endif /* STEAL_H */
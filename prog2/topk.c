@@ -0,0 +1,109 @@
+/**
+ *  \file topk.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the top-K kernels, that select the K largest elements of an array instead
+ *  of sorting all of it.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <string.h>
+
+#include "const.h"
+#include "topk.h"
+
+/**
+ *  \brief Keeps the k largest elements of a bitonic buffer of 2 * k elements, in descending order, in its first half.
+ *
+ *  Only the top half of the bitonic merge is done: after the first level, the first half has the k largest elements
+ *  and is bitonic, so the second half is left as it is.
+ *
+ *  \param ops kernels of the element type
+ *  \param top bitonic buffer of 2 * k elements
+ *  \param low_index index of the first element of the buffer
+ *  \param k number of elements of the list (power of 2)
+ */
+static void keep_top_half(const kernel_ops_t *ops, void *top, int low_index, int k) {
+    ops->level_slice(top, low_index, k, k, DESCENDING);
+    if (k > 1) {
+        ops->merge_levels(top, low_index, k, k / 2, DESCENDING);
+    }
+}
+
+/**
+ *  \brief Selects the top-K list of a partition of an array.
+ *
+ *  If the partition has fewer than k elements, the list is the whole partition, sorted in descending order.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param low_index index of the first element of the partition
+ *  \param count number of elements in the partition
+ *  \param top buffer of 2 * k elements where the list will be stored (in its first half)
+ *  \param k number of elements of the list (power of 2)
+ *
+ *  \return number of elements of the list (the smaller of count and k)
+ */
+int topk_scan(const kernel_ops_t *ops, const void *arr, int low_index, int count, void *top, int k) {
+    int elem_size = ops->elem_size;
+    const char *elems = (const char *) arr + (size_t) low_index * elem_size;
+    int length = count < k ? count : k;
+    memcpy(top, elems, (size_t) length * elem_size);
+    ops->sort(top, 0, length, DESCENDING);
+    if (length < k) {
+        return length;
+    }
+
+    // gather the elements larger than the smallest one of the list in the second half of the buffer
+    char *last = (char *) top + (size_t) (k - 1) * elem_size;
+    char *candidates = (char *) top + (size_t) k * elem_size;
+    int n_candidates = 0;
+    for (int i = ops->find_greater(elems, k, count - k, last); i < count;
+         i = ops->find_greater(elems, i + 1, count - i - 1, last)) {
+        memcpy(candidates + (size_t) n_candidates * elem_size, elems + (size_t) i * elem_size, elem_size);
+        if (++n_candidates == k) {
+            // the list and the ascending candidates form a bitonic buffer
+            ops->sort(top, k, k, ASCENDING);
+            keep_top_half(ops, top, 0, k);
+            n_candidates = 0;
+        }
+    }
+    // the last candidates are too few for a bitonic merge
+    if (n_candidates > 0) {
+        ops->sort(top, 0, k + n_candidates, DESCENDING);
+    }
+    return k;
+}
+
+/**
+ *  \brief Merges two top-K lists of the same number of elements into the first one.
+ *
+ *  The merged list has all the elements of both lists if they fit in k elements, and the k largest ones otherwise.
+ *
+ *  \param ops kernels of the element type
+ *  \param top buffers of the lists
+ *  \param low_index index of the first list, at the start of a buffer of 2 * k elements
+ *  \param other_index index of the second list
+ *  \param length number of elements of each list (power of 2, at most k)
+ *  \param k maximum number of elements of a list (power of 2)
+ *
+ *  \return number of elements of the merged list
+ */
+int topk_merge(const kernel_ops_t *ops, void *top, int low_index, int other_index, int length, int k) {
+    int elem_size = ops->elem_size;
+    char *dst = (char *) top + (size_t) (low_index + length) * elem_size;
+    const char *src = (const char *) top + (size_t) other_index * elem_size;
+    // append the second list reversed, so that the buffer is bitonic
+    for (int i = 0; i < length; i++) {
+        memcpy(dst + (size_t) i * elem_size, src + (size_t) (length - 1 - i) * elem_size, elem_size);
+    }
+    if (2 * length <= k) {
+        ops->merge_levels(top, low_index, 2 * length, length, DESCENDING);
+        return 2 * length;
+    }
+    keep_top_half(ops, top, low_index, k);
+    return k;
+}
@@ -0,0 +1,63 @@
+/**
+ *  \file topk.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the top-K kernels, that select the K largest elements of an array instead of
+ *  sorting all of it.
+ *
+ *  Each worker thread selects the top-K list of its partition, a descending list of k elements (k is a power of 2) kept
+ *  in the first half of a buffer of 2 * k elements. The elements of the partition larger than the last one of the list
+ *  are gathered in the second half of the buffer; when it is full, it is sorted in ascending order, so that the whole
+ *  buffer is bitonic, and only the top half of the bitonic merge is done: one level of compare-exchanges keeps the
+ *  larger element of each pair in the first half, which is then merged on its own. The work is O(n) compares plus
+ *  O(k log^2 k) per block of k elements that are not filtered out, instead of O(n log^2 n) for the sort.
+ *
+ *  The lists of the worker threads are then merged in pairs, in a tree reduction, in the same way.
+ *
+ *  Operations:
+ *  - topk_scan: selects the top-K list of a partition of an array
+ *  - topk_merge: merges two top-K lists
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef TOPK_H
+#define TOPK_H
+
+#include "kernels.h"
+
+/**
+ *  \brief Selects the top-K list of a partition of an array.
+ *
+ *  If the partition has fewer than k elements, the list is the whole partition, sorted in descending order.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param low_index index of the first element of the partition
+ *  \param count number of elements in the partition
+ *  \param top buffer of 2 * k elements where the list will be stored (in its first half)
+ *  \param k number of elements of the list (power of 2)
+ *
+ *  \return number of elements of the list (the smaller of count and k)
+ */
+int topk_scan(const kernel_ops_t *ops, const void *arr, int low_index, int count, void *top, int k);
+
+/**
+ *  \brief Merges two top-K lists of the same number of elements into the first one.
+ *
+ *  The merged list has all the elements of both lists if they fit in k elements, and the k largest ones otherwise.
+ *
+ *  \param ops kernels of the element type
+ *  \param top buffers of the lists
+ *  \param low_index index of the first list, at the start of a buffer of 2 * k elements
+ *  \param other_index index of the second list
+ *  \param length number of elements of each list (power of 2, at most k)
+ *  \param k maximum number of elements of a list (power of 2)
+ *
+ *  \return number of elements of the merged list
+ */
+int topk_merge(const kernel_ops_t *ops, void *top, int low_index, int other_index, int length, int k);
+
+#endif /* TOPK_H */
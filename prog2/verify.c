@@ -0,0 +1,224 @@
+/**
+ *  \file verify.c (implementation file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the implementation of the parallel verification of the sorted array.
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "verify.h"
+
+/** \brief Range of an array verified by a thread */
+typedef struct {
+    const kernel_ops_t *ops;
+    const char *arr;
+    int size;
+    int low_index;
+    int count;
+    int direction;
+    int check_order;
+    int fold;
+    int error;
+    checksum_t checksum;
+} verify_range_t;
+
+/**
+ *  \brief Mixes the bits of a 64-bit word (finalizer of MurmurHash3), so that close elements get unrelated hashes.
+ *
+ *  \param x word
+ *
+ *  \return mixed word
+ */
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ *  \brief Folds the elements of a range of an array into a checksum.
+ *
+ *  Inlined with a constant element size, so the hash of each element of 4 or 8 bytes is a single load and mix.
+ *
+ *  \param elems first element of the range
+ *  \param count number of elements in the range
+ *  \param checksum checksum the elements are folded into
+ *  \param elem_size number of bytes of an element
+ */
+static inline void fold_elems(const char *elems, int count, checksum_t *checksum, size_t elem_size) {
+    uint64_t sum = checksum->sum;
+    uint64_t xor_sum = checksum->xor_sum;
+    for (int i = 0; i < count; i++, elems += elem_size) {
+        uint64_t hash = 0;
+        for (size_t offset = 0; offset < elem_size; offset += sizeof(uint64_t)) {
+            uint64_t word = 0;
+            size_t n = elem_size - offset < sizeof(uint64_t) ? elem_size - offset : sizeof(uint64_t);
+            memcpy(&word, elems + offset, n);
+            hash = mix64(hash ^ word);
+        }
+        sum += hash;
+        xor_sum ^= hash;
+    }
+    checksum->sum = sum;
+    checksum->xor_sum = xor_sum;
+}
+
+/**
+ *  \brief Folds the elements of a range of an array into a checksum.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param checksum checksum the elements are folded into
+ */
+void checksum_fold(const kernel_ops_t *ops, const void *arr, int low_index, int count, checksum_t *checksum) {
+    size_t elem_size = ops->elem_size;
+    const char *elems = (const char *) arr + (size_t) low_index * elem_size;
+    if (elem_size == 4) {
+        fold_elems(elems, count, checksum, 4);
+    } else if (elem_size == 8) {
+        fold_elems(elems, count, checksum, 8);
+    } else {
+        fold_elems(elems, count, checksum, elem_size);
+    }
+}
+
+/**
+ *  \brief Combines a checksum into another one.
+ *
+ *  \param checksum checksum the other one is combined into
+ *  \param other checksum to be combined
+ */
+void checksum_combine(checksum_t *checksum, const checksum_t *other) {
+    checksum->sum += other->sum;
+    checksum->xor_sum ^= other->xor_sum;
+}
+
+/**
+ *  \brief Thread function that verifies a range of an array.
+ *
+ *  The order is checked up to the first element of the next range, so that the boundaries between the ranges are
+ *  checked too.
+ *
+ *  \param arg pointer to the range
+ *
+ *  \return NULL
+ */
+static void *verify_range(void *arg) {
+    verify_range_t *range = (verify_range_t *) arg;
+    range->error = -1;
+    if (range->check_order && range->count > 0) {
+        int n = range->low_index + range->count < range->size ? range->count + 1 : range->count;
+        int i = range->ops->check(range->arr + (size_t) range->low_index * range->ops->elem_size, n, range->direction);
+        range->error = i != -1 ? range->low_index + i : -1;
+    }
+    if (range->fold) {
+        checksum_fold(range->ops, range->arr, range->low_index, range->count, &range->checksum);
+    }
+    return NULL;
+}
+
+/**
+ *  \brief Verifies an array, split among several threads.
+ *
+ *  If there is no memory for the threads, the array is verified by the calling thread.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param size number of elements in the array
+ *  \param direction DESCENDING or ASCENDING
+ *  \param n_threads number of threads
+ *  \param check_order whether the order of the array is checked
+ *  \param checksum where the checksum of the array will be stored (NULL for none)
+ *
+ *  \return index of the first element out of order with the next one, -1 if the array is sorted (or not checked)
+ */
+static int verify_ranges(const kernel_ops_t *ops, const void *arr, int size, int direction, int n_threads,
+                         int check_order, checksum_t *checksum) {
+    int fold = checksum != NULL;
+    if (n_threads > size) {
+        n_threads = size > 0 ? size : 1;
+    }
+    verify_range_t *ranges = (verify_range_t *) malloc(n_threads * sizeof(verify_range_t));
+    pthread_t *threads = (pthread_t *) malloc(n_threads * sizeof(pthread_t));
+    if (ranges == NULL || threads == NULL) {
+        free(ranges);
+        free(threads);
+        verify_range_t all = {ops, (const char *) arr, size, 0, size, direction, check_order, fold, -1, {0, 0}};
+        verify_range(&all);
+        if (fold) {
+            *checksum = all.checksum;
+        }
+        return all.error;
+    }
+    int range = (int) (((long long) size + n_threads - 1) / n_threads);
+    for (int i = 0; i < n_threads; i++) {
+        int low_index = i * range < size ? i * range : size;
+        int count = size - low_index < range ? size - low_index : range;
+        ranges[i] = (verify_range_t) {ops, (const char *) arr, size, low_index, count, direction, check_order, fold,
+                                      -1, {0, 0}};
+        if (pthread_create(&threads[i], NULL, verify_range, &ranges[i]) != 0) {
+            fprintf(stderr, "[MAIN] Could not create verifier thread %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    // the first error in the array is the first one of the first range with an error
+    int error = -1;
+    if (fold) {
+        *checksum = (checksum_t) {0, 0};
+    }
+    for (int i = 0; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+        if (error == -1) {
+            error = ranges[i].error;
+        }
+        if (fold) {
+            checksum_combine(checksum, &ranges[i].checksum);
+        }
+    }
+    free(ranges);
+    free(threads);
+    return error;
+}
+
+/**
+ *  \brief Computes the checksum of an array, split among several threads.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param size number of elements in the array
+ *  \param n_threads number of threads
+ *  \param checksum where the checksum of the array will be stored
+ */
+void checksum_parallel(const kernel_ops_t *ops, const void *arr, int size, int n_threads, checksum_t *checksum) {
+    verify_ranges(ops, arr, size, 0, n_threads, 0, checksum);
+}
+
+/**
+ *  \brief Checks the order of an array and computes its checksum, split among several threads.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param size number of elements in the array
+ *  \param direction DESCENDING or ASCENDING
+ *  \param n_threads number of threads
+ *  \param checksum where the checksum of the array will be stored (NULL to only check the order)
+ *
+ *  \return index of the first element out of order with the next one, -1 if the array is sorted
+ */
+int verify_parallel(const kernel_ops_t *ops, const void *arr, int size, int direction, int n_threads,
+                    checksum_t *checksum) {
+    return verify_ranges(ops, arr, size, direction, n_threads, 1, checksum);
+}
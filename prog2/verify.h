@@ -0,0 +1,84 @@
+/**
+ *  \file verify.h (interface file)
+ *
+ *  \brief Assignment 1.2: multithreaded bitonic sort.
+ *
+ *  This file contains the definition of the parallel verification of the sorted array.
+ *
+ *  Checking that the output is in order does not catch a sort that loses or duplicates elements, so the input and the
+ *  output also get an order-independent checksum of their multiset of elements: each element is hashed (its bytes
+ *  through a 64-bit mixer) and the hashes are added and xored together. The checksum of a range is folded by the
+ *  thread that reads it, and the checksums of the ranges are combined in any order.
+ *
+ *  The verification splits the array in one range per thread: each thread checks the order of its range, and of its
+ *  last element with the first one of the next range, and folds the checksum of the range.
+ *
+ *  Operations:
+ *  - checksum_fold: folds the elements of a range of an array into a checksum
+ *  - checksum_combine: combines two checksums
+ *  - checksum_parallel: computes the checksum of an array, split among several threads
+ *  - verify_parallel: checks the order of an array and computes its checksum, split among several threads
+ *
+ *  \author João Fonseca - March 2024
+ *  \author Rafael Gonçalves - March 2024
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdint.h>
+
+#include "kernels.h"
+
+/** \brief Order-independent checksum of a multiset of elements */
+typedef struct checksum {
+    uint64_t sum;
+    uint64_t xor_sum;
+} checksum_t;
+
+/**
+ *  \brief Folds the elements of a range of an array into a checksum.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param low_index index of the first element of the range
+ *  \param count number of elements in the range
+ *  \param checksum checksum the elements are folded into
+ */
+void checksum_fold(const kernel_ops_t *ops, const void *arr, int low_index, int count, checksum_t *checksum);
+
+/**
+ *  \brief Combines a checksum into another one.
+ *
+ *  \param checksum checksum the other one is combined into
+ *  \param other checksum to be combined
+ */
+void checksum_combine(checksum_t *checksum, const checksum_t *other);
+
+/**
+ *  \brief Computes the checksum of an array, split among several threads.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param size number of elements in the array
+ *  \param n_threads number of threads
+ *  \param checksum where the checksum of the array will be stored
+ */
+void checksum_parallel(const kernel_ops_t *ops, const void *arr, int size, int n_threads, checksum_t *checksum);
+
+/**
+ *  \brief Checks the order of an array and computes its checksum, split among several threads.
+ *
+ *  \param ops kernels of the element type
+ *  \param arr array
+ *  \param size number of elements in the array
+ *  \param direction DESCENDING or ASCENDING
+ *  \param n_threads number of threads
+ *  \param checksum where the checksum of the array will be stored (NULL to only check the order)
+ *
+ *  \return index of the first element out of order with the next one, -1 if the array is sorted
+ */
+int verify_parallel(const kernel_ops_t *ops, const void *arr, int size, int direction, int n_threads,
+                    checksum_t *checksum);
+
+#endif /* VERIFY_H */